@@ -0,0 +1,177 @@
+#include "batch.h"
+
+#include <string.h>
+
+#include "compress.h"
+
+namespace batch
+{
+
+ThreadPool::ThreadPool(unsigned threads) :
+queued(0), pending(0), next(0), stopping(false)
+{
+  if (threads == 0)
+    threads = std::thread::hardware_concurrency();
+  if (threads == 0)
+    threads = 1;
+
+  for (unsigned i = 0; i < threads; ++i)
+    queues.emplace_back(new Queue());
+  for (unsigned i = 0; i < threads; ++i)
+    workers.emplace_back(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+  wait();
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (std::thread& worker : workers)
+    worker.join();
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+  ++pending;
+  // counted before it is published, so a thief taking it can't count it off first and wrap queued,
+  // and under the lock, so a worker can't miss it between looking for work and sleeping
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    ++queued;
+  }
+  Queue& queue = *queues[next++ % queues.size()];
+  {
+    std::lock_guard<std::mutex> guard(queue.lock);
+    queue.tasks.push_back(std::move(task));
+  }
+  wake.notify_one();
+}
+
+void ThreadPool::wait()
+{
+  std::unique_lock<std::mutex> guard(lock);
+  idle.wait(guard, [this] { return pending == 0; });
+}
+
+bool ThreadPool::take(const unsigned worker, std::function<void()>& task)
+{
+  // newest first from our own queue, while its tasks' data is likely still in cache
+  {
+    Queue& own = *queues[worker];
+    std::lock_guard<std::mutex> guard(own.lock);
+    if (!own.tasks.empty())
+    {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      --queued;
+      return true;
+    }
+  }
+
+  // oldest first from the others, starting with the next worker so thieves spread out
+  for (size_t i = 1; i < queues.size(); ++i)
+  {
+    Queue& other = *queues[(worker + i) % queues.size()];
+    std::lock_guard<std::mutex> guard(other.lock);
+    if (!other.tasks.empty())
+    {
+      task = std::move(other.tasks.front());
+      other.tasks.pop_front();
+      --queued;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::run(const unsigned worker)
+{
+  for (;;)
+  {
+    std::function<void()> task;
+    if (take(worker, task))
+    {
+      task();
+      if (--pending == 0)
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        idle.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> guard(lock);
+    wake.wait(guard, [this] { return stopping || queued > 0; });
+    if (stopping && queued == 0)
+      return;
+  }
+}
+
+std::vector<uint8_t> render(CommandBufferInterface& buffer, const EPDLite& epd)
+{
+  const int16_t stride = (epd.width + 7) / 8;
+  std::vector<uint8_t> image(static_cast<size_t>(stride) * epd.height);
+
+  buffer.prepare(epd);
+
+  // repeated rows leave the previous row in place
+  std::vector<uint8_t> row(stride, 0xff);
+  for (int16_t y = 0; y < epd.height; ++y)
+  {
+    const CommandBufferInterface::RowState state = buffer.render_row(row.data(), y, stride, true, epd);
+    if (state == CommandBufferInterface::BLANK_ROW)
+      memset(&image[static_cast<size_t>(y) * stride], 0xff, stride);
+    else
+      memcpy(&image[static_cast<size_t>(y) * stride], row.data(), stride);
+  }
+  return image;
+}
+
+void render_bands(CommandBufferInterface& buffer, const EPDLite& epd, uint8_t* const ring, const int16_t rows, const uint8_t slots, ThreadPool* const helpers, const Sink& sink)
+{
+  BandRenderer bands(buffer, epd, ring, rows, slots);
+  if (helpers && bands.concurrent())
+  {
+    for (unsigned i = 0; i < helpers->size(); ++i)
+      helpers->submit([&bands] { bands.help(); });
+  }
+
+  int16_t y, count;
+  for (const uint8_t* data = bands.next(y, count); data; data = bands.next(y, count))
+  {
+    sink(y, data, count);
+    bands.release();
+  }
+
+  // the helpers use the bands until they finish
+  if (helpers)
+    helpers->wait();
+}
+
+std::vector<std::vector<uint8_t>> Renderer::render(const size_t count, const Build& build, const Format format)
+{
+  std::vector<std::vector<uint8_t>> images(count);
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    pool.submit([this, i, &build, &images, format] {
+      // too big for a worker's stack to hold comfortably
+      std::unique_ptr<Scene> scene(new Scene());
+      EPDLite epd(width, height);
+      build(i, *scene, epd);
+
+      std::vector<uint8_t> image = batch::render(*scene, epd);
+      if (format == COMPRESSED)
+        image = compress::encode(image.data(), (width + 7) / 8, height);
+      images[i] = std::move(image);
+    });
+  }
+  pool.wait();
+
+  return images;
+}
+
+}
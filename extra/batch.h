@@ -0,0 +1,183 @@
+#ifndef BATCH_H_INCLUDE
+#define BATCH_H_INCLUDE
+
+// Host side batch renderer, draws many command buffer scenes into 1bpp images in parallel
+//
+// Built into libepdlite.a with the library's commands, see the Makefile. Each scene is built and rendered on one
+// worker thread with its own CommandBuffer and EPDLite, so commands are never shared between threads. Anything a
+// scene's commands point to (text, vertices) must be safe to read from several threads at once, or be made by the
+// scene's build function. Fragments of groups are prepared as they are drawn, so can't be shared between scenes.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "stub.h"
+#include "../src/EPDLite/bands.h"
+#include "../src/EPDLite/commandbuffer.h"
+
+namespace batch
+{
+
+/**
+ * @brief A pool of worker threads which steal work from each other
+ * @details Each worker has its own queue. Tasks are spread over the queues as they are submitted, workers take the newest task from their own queue and steal the oldest from the others when theirs is empty, so uneven tasks still keep every worker busy.
+ */
+class ThreadPool
+{
+public:
+  /**
+   * @brief Starts the workers
+   *
+   * @param threads The number of workers, 0 for one per hardware thread
+   */
+  explicit ThreadPool(unsigned threads = 0);
+
+  /**
+   * @brief Finishes the submitted tasks and stops the workers
+   */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   * @brief Queues a task to run on a worker
+   */
+  void submit(std::function<void()> task);
+
+  /**
+   * @brief Waits until every submitted task has finished
+   */
+  void wait();
+
+  /**
+   * @brief The number of workers
+   */
+  unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+private:
+  struct Queue
+  {
+    std::mutex lock;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  /**
+   * @brief Takes a task from worker's own queue, or steals one from another
+   */
+  bool take(const unsigned worker, std::function<void()>& task);
+
+  void run(const unsigned worker);
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+
+  std::mutex lock;
+  std::condition_variable wake; // a task was queued, or the pool is stopping
+  std::condition_variable idle; // every task has finished
+  std::atomic<size_t> queued;   // tasks being queued or waiting in the queues
+  std::atomic<size_t> pending;  // tasks submitted but not finished
+  std::atomic<unsigned> next;   // the queue for the next task
+  bool stopping;
+};
+
+/**
+ * @brief How rendered images are output
+ */
+enum Format
+{
+  RAW,       ///< Row major display data, `stride * height` bytes, as for `render(buffer)` or an SD card file
+  COMPRESSED ///< Compressed with compress::encode, as for CompressedImage
+};
+
+/**
+ * @brief The buffer each scene is built in
+ * @details Large enough for a busy screen of any commands, with room for formatted text. Bounds and colours are kept, as RAM is plentiful on a host.
+ */
+typedef CommandBuffer<256, CommandBufferInterface::max_size_all(), 4096, BUFFER_BOUNDS | BUFFER_COLOUR> Scene;
+
+/**
+ * @brief Builds a scene
+ *
+ * @param index The scene being built, from 0
+ * @param scene An empty buffer to push the scene's commands into
+ * @param epd The display the scene is rendered for, its orientation can be set
+ */
+typedef std::function<void(const size_t index, Scene& scene, EPDLite& epd)> Build;
+
+/**
+ * @brief Renders the commands in a buffer to an image
+ * @details Rows are rendered as they are on a display, so repeated and blank rows are skipped in the same way.
+ *
+ * @return `stride * height` bytes of display data
+ */
+std::vector<uint8_t> render(CommandBufferInterface& buffer, const EPDLite& epd);
+
+/**
+ * @brief Receives the bands of a frame, @see render_bands
+ *
+ * @param y The first row of the band
+ * @param data The band, `count` rows of display data
+ * @param count The number of rows in the band
+ */
+typedef std::function<void(const int16_t y, const uint8_t* const data, const int16_t count)> Sink;
+
+/**
+ * @brief Renders the commands in a buffer in bands, on several threads at once
+ * @details The host side of `EPDLite::render(buffer, ring, rows, slots)`, for measuring how the time to a whole frame falls as threads are added. This thread passes the bands to sink in order, rendering while it waits for them, and the pool's workers render bands ahead of it.
+ *
+ * @param buffer The commands to render
+ * @param epd The display to render for
+ * @param ring The band buffers, at least `slots * rows * stride` bytes
+ * @param rows The number of rows in a band
+ * @param slots The number of band buffers, @see BandRenderer
+ * @param helpers Workers to render on as well, which must have nothing else to do, or nullptr to render on this thread alone
+ * @param sink Called with each band, as the display would be sent it
+ */
+void render_bands(CommandBufferInterface& buffer, const EPDLite& epd, uint8_t* const ring, const int16_t rows, const uint8_t slots, ThreadPool* const helpers, const Sink& sink);
+
+/**
+ * @brief Renders scenes for a display in parallel
+ */
+class Renderer
+{
+public:
+  /**
+   * @brief A renderer for a display size
+   *
+   * @param width Width of the display in pixels, at most 2040 for compressed output
+   * @param height Height of the display in pixels
+   * @param pool The workers to render on
+   */
+  Renderer(const int16_t width, const int16_t height, ThreadPool& pool) :
+  width(width), height(height), pool(pool)
+  {}
+
+  /**
+   * @brief Builds and renders a number of scenes
+   * @details Each scene is built and rendered as a single task, in whichever order the workers take them.
+   *
+   * @param count The number of scenes
+   * @param build Called on a worker to build each scene, must be safe to call from several threads at once
+   * @param format How each image is output
+   * @return The images, in the order of their index
+   */
+  std::vector<std::vector<uint8_t>> render(const size_t count, const Build& build, const Format format = RAW);
+
+private:
+  const int16_t width, height;
+  ThreadPool& pool;
+};
+
+}
+
+#endif
@@ -0,0 +1,220 @@
+// Benchmarks the batch renderer, reporting scenes per second as the number of threads grows
+//
+// usage: batchbench [scenes] [max threads] [bus MHz]
+//
+// Each scene is a personalised status screen: a name, readings, gauges and bars which vary with the scene's index.
+// The images are checked to be the same whatever the number of threads.
+//
+// Then the time to render a single frame in bands is reported as the number of threads grows, as a dual core board
+// renders with EPDLite::render(buffer, ring, rows, slots), both alone and while sending the bands over a simulated
+// bus which keeps the sending thread busy for as long as the display's SPI bus would.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "batch.h"
+#include "../src/EPDLite/fonts/font5x7.h"
+#include "../src/EPDLite/fonts/numerals16.h"
+#include "../src/EPDLite/fonts/stroke.h"
+
+static const int16_t WIDTH = 152;
+static const int16_t HEIGHT = 296;
+
+static const Vertex arrow[] = {{0, 0}, {12, 8}, {4, 8}, {4, 20}, {-4, 20}, {-4, 8}, {-12, 8}};
+static const char* const names[] = {"ADA", "GRACE", "ALAN", "EDSGER", "BARBARA", "KEN", "DENNIS", "MARGARET"};
+
+static void build(const size_t index, batch::Scene& scene, EPDLite& epd)
+{
+  (void)epd;
+
+  const int32_t value = static_cast<int32_t>(index * 7919 % 1000);
+
+  // header
+  scene.push(RectCommand(0, 0, WIDTH, 28, true, Style(DRAW_SET, PATTERN_GRAY50)));
+  scene.push(StrokeTextCommand(6, 6, names[index % 8], stroke, 16, 2));
+  scene.push(TextCommand(110, 10, scene.format_int(static_cast<int32_t>(index)), font5x7, 1));
+
+  // readings
+  scene.push(TextCommand(8, 40, scene.format_fixed(value - 200, 1, "\xc2\xb0" "C"), numerals16));
+  scene.push(TextCommand(8, 60, scene.format_fixed(value * 3 % 1000, 1, "%"), numerals16));
+  scene.push(PolygonCommand(130, 40, arrow, false, Style(value % 2 ? DRAW_SET : DRAW_XOR)));
+
+  // gauges
+  for (int16_t i = 0; i < 2; ++i)
+  {
+    const int16_t cx = 40 + i * 72;
+    const int16_t fill = static_cast<int16_t>((value + i * 300) % 1000 * 240 / 1000);
+    scene.push(ArcCommand(cx, 130, 26, 30, -30, 210));
+    scene.push(ArcCommand(cx, 130, 20, 30, 210 - fill, 210));
+    scene.push(CircleCommand(cx, 130, 4, true));
+  }
+
+  // a week of bars
+  for (int16_t day = 0; day < 7; ++day)
+  {
+    const int16_t h = static_cast<int16_t>(10 + (value * (day + 3)) % 60);
+    scene.push(RectCommand(10 + day * 19, 250 - h, 14, h, true, Style(DRAW_SET, day % 2 ? PATTERN_DIAGONAL : PATTERN_GRAY25)));
+  }
+  scene.push(LineCommand(4, 251, 147, 251));
+
+  // footer
+  scene.push(TextCommand(6, 270, "updated 12:34", font5x7, 1));
+  scene.push(RectCommand(0, 264, WIDTH, 20, true, Style(DRAW_INVERT)));
+}
+
+static const int16_t BAND_ROWS = 8;
+
+/**
+ * @brief Keeps the thread busy for as long as a bus at mhz takes to send bytes
+ */
+static void send(const size_t bytes, const double mhz)
+{
+  if (mhz <= 0)
+    return;
+
+  const auto until = std::chrono::steady_clock::now() + std::chrono::duration<double, std::micro>(bytes * 8 / mhz);
+  while (std::chrono::steady_clock::now() < until)
+  {
+  }
+}
+
+/**
+ * @brief Renders every scene in bands, checking each frame against the reference
+ * @return The mean time to a frame in seconds, or a negative time if a frame differs
+ */
+static double frames(std::vector<std::unique_ptr<batch::Scene>>& scenes, const std::vector<std::vector<uint8_t>>& reference, const unsigned threads, const double mhz)
+{
+  const int16_t stride = (WIDTH + 7) / 8;
+  // a buffer for each thread to render into, and one being sent
+  const uint8_t slots = threads + 1 < BAND_SLOTS ? threads + 1 : BAND_SLOTS;
+  std::vector<uint8_t> ring(static_cast<size_t>(slots) * BAND_ROWS * stride);
+  std::unique_ptr<batch::ThreadPool> helpers(threads > 1 ? new batch::ThreadPool(threads - 1) : nullptr);
+  EPDLite epd(WIDTH, HEIGHT);
+
+  std::vector<uint8_t> image(static_cast<size_t>(stride) * HEIGHT);
+  const batch::Sink sink = [&image, stride, mhz](const int16_t y, const uint8_t* const data, const int16_t count) {
+    memcpy(&image[static_cast<size_t>(y) * stride], data, static_cast<size_t>(count) * stride);
+    send(static_cast<size_t>(count) * stride, mhz);
+  };
+
+  double total = 0;
+  for (size_t i = 0; i < scenes.size(); ++i)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    batch::render_bands(*scenes[i], epd, ring.data(), BAND_ROWS, slots, helpers.get(), sink);
+    total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (image != reference[i])
+      return -1;
+  }
+  return scenes.empty() ? 0 : total / scenes.size();
+}
+
+static uint32_t checksum(const std::vector<std::vector<uint8_t>>& images)
+{
+  uint32_t sum = 2166136261u;
+  for (const std::vector<uint8_t>& image : images)
+  {
+    for (const uint8_t byte : image)
+      sum = (sum ^ byte) * 16777619u;
+  }
+  return sum;
+}
+
+int main(int argc, char** argv)
+{
+  const size_t scenes = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000;
+  unsigned most = argc > 2 ? static_cast<unsigned>(atoi(argv[2])) : std::thread::hardware_concurrency();
+  if (most == 0)
+    most = 1;
+  const double mhz = argc > 3 ? atof(argv[3]) : 20;
+
+  std::vector<unsigned> counts;
+  for (unsigned threads = 1; threads < most; threads *= 2)
+    counts.push_back(threads);
+  counts.push_back(most);
+
+  printf("%zu scenes of %dx%d, %u hardware threads\n", scenes, WIDTH, HEIGHT, std::thread::hardware_concurrency());
+  printf("%8s %8s %12s %8s %12s %10s\n", "threads", "format", "scenes/s", "speedup", "bytes/scene", "checksum");
+
+  const batch::Format formats[] = {batch::RAW, batch::COMPRESSED};
+  for (const batch::Format format : formats)
+  {
+    double single = 0;
+    uint32_t expected = 0;
+    for (const unsigned threads : counts)
+    {
+      batch::ThreadPool pool(threads);
+      batch::Renderer renderer(WIDTH, HEIGHT, pool);
+
+      // warm up the workers and caches
+      renderer.render(threads * 4, build, format);
+
+      const auto start = std::chrono::steady_clock::now();
+      const std::vector<std::vector<uint8_t>> images = renderer.render(scenes, build, format);
+      const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      size_t bytes = 0;
+      for (const std::vector<uint8_t>& image : images)
+        bytes += image.size();
+
+      const double rate = scenes / seconds;
+      const uint32_t sum = checksum(images);
+      if (threads == 1)
+      {
+        single = rate;
+        expected = sum;
+      }
+
+      printf("%8u %8s %12.0f %7.2fx %12zu   %08x\n", threads, format == batch::RAW ? "raw" : "compress", rate, rate / single, scenes ? bytes / scenes : 0, sum);
+      if (sum != expected)
+      {
+        fprintf(stderr, "images differ from a single thread\n");
+        return 1;
+      }
+    }
+  }
+
+  // single frames are much quicker than a batch, so fewer will do
+  const size_t count = scenes < 200 ? scenes : 200;
+  std::vector<std::unique_ptr<batch::Scene>> built;
+  std::vector<std::vector<uint8_t>> reference;
+  for (size_t i = 0; i < count; ++i)
+  {
+    built.emplace_back(new batch::Scene());
+    EPDLite epd(WIDTH, HEIGHT);
+    build(i, *built.back(), epd);
+    reference.push_back(batch::render(*built.back(), epd));
+  }
+
+  const double bus = static_cast<double>((WIDTH + 7) / 8) * HEIGHT * 8 / mhz / 1000;
+  printf("\n%zu frames in bands of %d rows, bus at %.1f MHz takes %.3f ms a frame\n", count, BAND_ROWS, mhz, bus);
+  printf("%8s %12s %8s %12s\n", "threads", "render ms", "speedup", "with bus ms");
+
+  double single = 0;
+  for (const unsigned threads : counts)
+  {
+    // warm up the workers and caches
+    frames(built, reference, threads, 0);
+
+    const double alone = frames(built, reference, threads, 0);
+    const double sending = frames(built, reference, threads, mhz);
+    if (alone < 0 || sending < 0)
+    {
+      fprintf(stderr, "frames rendered in bands differ from a single thread\n");
+      return 1;
+    }
+    if (threads == 1)
+      single = alone;
+
+    printf("%8u %12.3f %7.2fx %12.3f\n", threads, alone * 1000, single / alone, sending * 1000);
+  }
+
+  return 0;
+}
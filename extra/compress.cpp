@@ -0,0 +1,65 @@
+// Compresses a raw image for use with CompressedImage
+//
+// usage: compress <name> <width> <height> < image.raw > image.h
+//
+// The raw image is in the display's format: row major, MSB first, 0 is black, each row padded to a whole byte.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "stub.h"
+#include "compress.h"
+#include "../src/EPDLite/compressed.h"
+
+int main(int argc, char** argv)
+{
+  if (argc != 4)
+  {
+    fprintf(stderr, "usage: %s <name> <width> <height> < image.raw > image.h\n", argv[0]);
+    return 1;
+  }
+
+  const char* const name = argv[1];
+  const int width = atoi(argv[2]);
+  const int height = atoi(argv[3]);
+  const size_t stride = (width + 7) / 8;
+  if (width <= 0 || height <= 0 || stride > 255)
+  {
+    fprintf(stderr, "invalid size %dx%d\n", width, height);
+    return 1;
+  }
+
+  std::vector<uint8_t> image(stride * height);
+  if (fread(image.data(), 1, image.size(), stdin) != image.size())
+  {
+    fprintf(stderr, "expected %zu bytes of image data\n", image.size());
+    return 1;
+  }
+
+  const std::vector<uint8_t> data = compress::encode(image.data(), stride, height);
+
+  // check it decodes with the library's decoder
+  std::vector<uint8_t> row(stride);
+  ImageDecoder decoder(data.data(), false);
+  for (int y = 0; y < height; ++y)
+  {
+    decoder.next(row.data(), stride);
+    if (!std::equal(row.begin(), row.end(), image.begin() + y * stride))
+    {
+      fprintf(stderr, "round trip failed at row %d\n", y);
+      return 1;
+    }
+  }
+
+  printf("// %dx%d image, %zu bytes compressed to %zu bytes\n", width, height, image.size(), data.size());
+  printf("const uint8_t %s_data[%zu] PROGMEM = {", name, data.size());
+  for (size_t i = 0; i < data.size(); ++i)
+    printf("%s0x%02x,", i % 16 ? " " : "\n  ", data[i]);
+  printf("\n};\n\n");
+  printf("const CompressedImage %s = {%s_data, %d, %d};\n", name, name, width, height);
+
+  return 0;
+}
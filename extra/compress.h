@@ -0,0 +1,129 @@
+#ifndef COMPRESS_H_INCLUDE
+#define COMPRESS_H_INCLUDE
+
+// Host side encoder for the compressed image format described in src/EPDLite/compressed.h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace compress
+{
+
+const size_t MAX_RUN = 64;
+
+const uint8_t LITERAL = 0x00;
+const uint8_t WHITE = 0x40;
+const uint8_t BLACK = 0x80;
+const uint8_t COPY = 0xc0;
+
+/**
+ * @brief Compresses an image
+ *
+ * @param image Row major image in the display's format, `stride * height` bytes
+ * @param stride Bytes per row of the image, at most 255
+ * @param height Rows in the image
+ * @return The compressed data
+ */
+inline std::vector<uint8_t> encode(const uint8_t* const image, const size_t stride, const size_t height)
+{
+  const size_t size = stride * height;
+  std::vector<uint8_t> out;
+
+  size_t literal = 0; // index in out of the pending literal token, if any
+  size_t literals = 0;
+
+  for (size_t i = 0; i < size;)
+  {
+    const size_t limit = size - i < MAX_RUN ? size - i : MAX_RUN;
+
+    // run of white or black
+    size_t run = 0;
+    if (image[i] == 0xff || image[i] == 0x00)
+    {
+      while (run < limit && image[i + run] == image[i])
+        ++run;
+    }
+
+    // back reference, at most a row back
+    size_t copy = 0;
+    size_t distance = 0;
+    const size_t furthest = i < stride ? i : stride;
+    for (size_t d = 1; d <= furthest; ++d)
+    {
+      size_t n = 0;
+      while (n < limit && image[i + n] == image[i + n - d])
+        ++n;
+      if (n > copy)
+      {
+        copy = n;
+        distance = d;
+      }
+    }
+
+    // a run costs one byte and a copy two, anything short is cheaper added to a literal
+    if (run >= 2 && run + 1 >= copy)
+    {
+      out.push_back((image[i] ? WHITE : BLACK) | static_cast<uint8_t>(run - 1));
+      i += run;
+      literals = 0;
+    }
+    else if (copy >= 3)
+    {
+      out.push_back(COPY | static_cast<uint8_t>(copy - 1));
+      out.push_back(static_cast<uint8_t>(distance));
+      i += copy;
+      literals = 0;
+    }
+    else
+    {
+      if (literals == 0 || literals == MAX_RUN)
+      {
+        literal = out.size();
+        literals = 0;
+        out.push_back(LITERAL);
+      }
+      out[literal] = LITERAL | static_cast<uint8_t>(literals);
+      out.push_back(image[i]);
+      ++literals;
+      ++i;
+    }
+  }
+
+  return out;
+}
+
+/**
+ * @brief Decompresses an image, for checking the output of `encode`
+ *
+ * @param data The compressed data
+ * @param size Bytes in the decompressed image
+ * @return The decompressed image
+ */
+inline std::vector<uint8_t> decode(const std::vector<uint8_t>& data, const size_t size)
+{
+  std::vector<uint8_t> out;
+  for (size_t i = 0; i < data.size() && out.size() < size;)
+  {
+    const uint8_t type = data[i] & 0xc0;
+    const size_t n = (data[i++] & 0x3f) + 1;
+
+    if (type == COPY)
+    {
+      const size_t distance = data[i++];
+      for (size_t j = 0; j < n; ++j)
+        out.push_back(out[out.size() - distance]);
+    }
+    else
+    {
+      for (size_t j = 0; j < n; ++j)
+        out.push_back(type == LITERAL ? data[i++] : type == WHITE ? 0xff : 0x00);
+    }
+  }
+  return out;
+}
+
+}
+
+#endif
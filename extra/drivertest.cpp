@@ -0,0 +1,480 @@
+// Checks the display driver against a model of the controller on the host
+//
+// usage: drivertest
+//
+// The driver is built against mock Arduino and SPI headers, and each byte it sends is fed to a model of the controller
+// which keeps its RAMs, address counter and window, and what the panel shows after each update. Each check is printed,
+// and the exit status is the number of checks which failed.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "EPDLite.h"
+
+namespace mock
+{
+uint8_t pins[128];
+unsigned long now = 0;
+void (*receive)(uint8_t value) = nullptr;
+}
+
+SPIClass SPI;
+
+static const int16_t WIDTH = 48;
+static const int16_t HEIGHT = 16;
+static const int16_t STRIDE = WIDTH / 8;
+static const size_t SIZE = STRIDE * HEIGHT;
+static const pin_t CS = 1, DC = 2, BUSY = 3, RESET = 4;
+static const uint8_t WAVEFORM[4] PROGMEM = {1, 2, 3, 4};
+
+/**
+ * @brief As much of the controller as the driver uses
+ */
+struct Controller
+{
+  uint8_t ram[2][SIZE];   // 0x24, and 0x26 which holds the red plane or the previous image
+  uint8_t shown[2][SIZE]; // what the panel shows, black and red
+  uint8_t command;
+  int args;
+  int x0, x1, y0, y1; // the window, in bytes and rows
+  int x, y;           // the address counter
+  uint8_t sequence;
+  uint8_t lut[sizeof(WAVEFORM)];
+  int stray; // bytes written outside the panel
+  std::string trace; // each RAM written, B for 0x24 and R for 0x26, each LUT loaded and each update, F for full, f for fast and d for differential
+};
+
+/**
+ * @brief A stream of bytes held in memory, which runs out at the end
+ */
+class MemoryStream : public Stream
+{
+public:
+  MemoryStream(const std::string& bytes) : bytes(bytes), at(0) {}
+
+  virtual int read() override { return at < bytes.size() ? static_cast<uint8_t>(bytes[at++]) : -1; }
+
+  size_t remaining() const { return bytes.size() - at; }
+
+private:
+  std::string bytes;
+  size_t at;
+};
+
+static Controller panel;
+static int failed = 0;
+
+static void receive(const uint8_t value)
+{
+  Controller& p = panel;
+  if (!mock::pins[DC])
+  {
+    p.command = value;
+    p.args = 0;
+    switch (value)
+    {
+      case 0x24:
+        p.trace += 'B';
+        break;
+      case 0x26:
+        p.trace += 'R';
+        break;
+      case 0x32:
+        p.trace += 'L';
+        break;
+      case 0x20:
+        if (p.sequence == 0xcf)
+        {
+          // only the pixels which differ from the previous image change, the rest stay as they are shown
+          p.trace += 'd';
+          for (size_t i = 0; i < SIZE; ++i)
+          {
+            const uint8_t changed = p.ram[0][i] ^ p.ram[1][i];
+            p.shown[0][i] = (p.ram[0][i] & changed) | (p.shown[0][i] & ~changed);
+          }
+        }
+        else
+        {
+          p.trace += p.sequence == 0xc7 ? 'f' : 'F';
+          memcpy(p.shown, p.ram, sizeof(p.shown));
+        }
+        break;
+    }
+    return;
+  }
+
+  switch (p.command)
+  {
+    case 0x22:
+      p.sequence = value;
+      break;
+    case 0x32:
+      if (p.args < static_cast<int>(sizeof(p.lut)))
+        p.lut[p.args] = value;
+      break;
+    case 0x44:
+      (p.args ? p.x1 : p.x0) = value;
+      break;
+    case 0x45:
+      if (p.args < 2)
+        p.y0 = p.args ? p.y0 | value << 8 : value;
+      else
+        p.y1 = p.args == 3 ? p.y1 | value << 8 : value;
+      break;
+    case 0x4e:
+      p.x = value;
+      break;
+    case 0x4f:
+      p.y = p.args ? p.y | value << 8 : value;
+      break;
+    case 0x24:
+    case 0x26:
+      if (p.x < STRIDE && p.y < HEIGHT)
+        p.ram[p.command == 0x26][p.y * STRIDE + p.x] = value;
+      else
+        ++p.stray;
+      // rows of the window in turn, x then y increasing
+      if (++p.x > p.x1)
+      {
+        p.x = p.x0;
+        ++p.y;
+      }
+      break;
+  }
+  ++p.args;
+}
+
+static void report(const char* const name, const int wrong)
+{
+  printf("%-48s %s", name, wrong ? "FAIL" : "ok");
+  if (wrong)
+    printf(", %d wrong", wrong);
+  printf("\n");
+  failed += wrong != 0;
+}
+
+static int differences(const uint8_t* const a, const uint8_t* const b, const size_t size)
+{
+  int n = 0;
+  for (size_t i = 0; i < size; ++i)
+    n += a[i] != b[i];
+  return n;
+}
+
+// a panel fresh from init, with both RAMs and the screen holding value
+static void start(EPDLite& epd, const uint8_t value = 0xff)
+{
+  panel = Controller();
+  panel.sequence = 0xf7;
+  epd.init();
+  memset(panel.ram, value, sizeof(panel.ram));
+  memset(panel.shown, value, sizeof(panel.shown));
+  panel.trace.clear();
+}
+
+// after an update the panel shows the image RAM, and the previous image RAM holds it for the next differential update
+static int in_step()
+{
+  return differences(panel.shown[0], panel.ram[0], SIZE) + differences(panel.ram[1], panel.ram[0], SIZE);
+}
+
+// windows against a byte at a time reference, at and past each edge of the panel
+static void check_windows()
+{
+  static const struct
+  {
+    int16_t x, y, w, h, stride;
+    bool drawn;
+  } WINDOWS[] = {
+    {0, 0, 16, 4, 2, true},
+    {8, 5, 20, 3, 3, true},
+    // past the right edge, with a stride for the whole window or only the part on the panel
+    {WIDTH - 8, 2, 24, 3, 3, true},
+    {WIDTH - 8, 2, 24, 3, 1, true},
+    // past the left, top and bottom edges, and every edge at once
+    {-8, 2, 24, 3, 3, true},
+    {-16, 2, 24, 3, 1, true},
+    {-16, 2, 24, 3, 3, true},
+    {0, -2, 16, 4, 2, true},
+    {0, HEIGHT - 1, 16, 4, 2, true},
+    {-8, -2, WIDTH + 16, HEIGHT + 4, STRIDE + 2, true},
+    // off the panel entirely, not on a byte or with too short a stride
+    {WIDTH, 0, 8, 1, 1, false},
+    {-16, 0, 16, 1, 2, false},
+    {0, HEIGHT, 8, 1, 1, false},
+    {0, -4, 8, 4, 1, false},
+    {4, 0, 8, 1, 1, false},
+    {0, 0, 17, 1, 2, false},
+    {0, 0, 8, 0, 1, false},
+    {0, 0, 8, 1, 0, false},
+  };
+
+  uint8_t image[512];
+  for (uint8_t& v : image)
+    v = rand();
+
+  EPDLite epd(WIDTH, HEIGHT, CS, DC, BUSY, RESET);
+  int wrong = 0;
+  for (const auto& w : WINDOWS)
+  {
+    start(epd, 0xaa);
+    // the window is whole bytes wide
+    const int16_t right = w.x + (w.w + 7) / 8 * 8;
+    wrong += epd.render(image + 2, w.x, w.y, w.w, w.h, w.stride) != w.drawn;
+    for (int16_t y = 0; y < HEIGHT; ++y)
+      for (int16_t b = 0; b < STRIDE; ++b)
+      {
+        const bool inside = w.drawn && y >= w.y && y < w.y + w.h && b * 8 >= w.x && b * 8 < right;
+        wrong += panel.ram[0][y * STRIDE + b] != (inside ? image[2 + (y - w.y) * w.stride + b - w.x / 8] : 0xaa);
+      }
+    // the whole panel is the window again afterwards, and nothing is sent for a window which isn't drawn
+    wrong += panel.stray + (panel.x0 != 0) + (panel.x1 != STRIDE - 1) + (panel.y0 != 0) + (panel.y1 < HEIGHT - 1);
+    wrong += panel.trace != (w.drawn ? "BF" : "");
+  }
+  report("windows, at and past the edges", wrong);
+
+  // converted from 1 for black, LSB first, as it's written
+  wrong = 0;
+  start(epd);
+  wrong += !epd.render_P(image, 8, 1, 16, 2, 3, IMAGE_INVERT | IMAGE_LSB_FIRST);
+  for (int16_t y = 1; y < 3; ++y)
+    for (int16_t b = 1; b < 3; ++b)
+    {
+      uint8_t v = image[(y - 1) * 3 + b - 1], reversed = 0;
+      for (int k = 0; k < 8; ++k)
+        reversed |= (v >> k & 1) << (7 - k);
+      wrong += panel.ram[0][y * STRIDE + b] != static_cast<uint8_t>(~reversed);
+    }
+  report("windows, converted", wrong);
+
+  // the red plane is blanked within the window, and left as it was around it
+  wrong = 0;
+  epd.setColour(true);
+  start(epd, 0x55);
+  wrong += !epd.render(image, 8, 4, 16, 3, 2);
+  for (int16_t y = 0; y < HEIGHT; ++y)
+    for (int16_t b = 0; b < STRIDE; ++b)
+    {
+      const bool inside = y >= 4 && y < 7 && b >= 1 && b < 3;
+      wrong += panel.ram[1][y * STRIDE + b] != (inside ? 0x00 : 0x55);
+    }
+  wrong += panel.trace != "BRF";
+  epd.setColour(false);
+  report("windows, red plane", wrong);
+
+  // with differential updates the previous image RAM follows the screen through windows
+  wrong = 0;
+  start(epd);
+  epd.setFastRefresh(WAVEFORM, sizeof(WAVEFORM), 3, 0, true);
+  uint8_t screen[SIZE];
+  memset(screen, 0xf0, sizeof(screen));
+  // until a whole screen is rendered, the rest of the previous image RAM is unknown and each window is a full refresh
+  epd.render(image, 0, 0, 16, 2, 2);
+  epd.render(image, 8, 4, 16, 2, 2);
+  wrong += panel.trace != "BRFBRF";
+  panel.trace.clear();
+  epd.render(screen);
+  wrong += in_step();
+  // fast until the limit, and a window in the full refresh which follows keeps the previous image RAM in step
+  for (int i = 0; i < 5; ++i)
+  {
+    epd.render(image + i, 8 * (i % 3), i, 8 + 8 * i, 3, 6);
+    wrong += in_step();
+  }
+  wrong += panel.trace != "BRF" "BLdR" "BdR" "BdR" "BRF" "BLdR";
+  report("windows, previous image kept in step", wrong);
+}
+
+// the update for each mode of refresh, and when a full refresh falls due
+static void check_refresh()
+{
+  static const char* const SCREENS = "\x0f\xf0\x3c\xc3\x5a\xa5\x00\x81";
+  uint8_t screen[SIZE];
+  EPDLite epd(WIDTH, HEIGHT, CS, DC, BUSY, RESET);
+
+  // the display's own sequence for every update
+  int wrong = 0;
+  start(epd);
+  for (int i = 0; i < 3; ++i)
+  {
+    memset(screen, SCREENS[i], sizeof(screen));
+    epd.render(screen);
+    wrong += differences(panel.shown[0], screen, SIZE);
+  }
+  wrong += panel.trace != "BFBFBF";
+  report("refresh, full", wrong);
+
+  // fast until the limit, with the waveform loaded after each full refresh, and a full refresh asked for
+  wrong = 0;
+  start(epd);
+  epd.setFastRefresh(WAVEFORM, sizeof(WAVEFORM), 3);
+  static const uint16_t COUNTS[] = {1, 2, 3, 0, 1, 2, 3, 0};
+  for (int i = 0; i < 8; ++i)
+  {
+    memset(screen, SCREENS[i], sizeof(screen));
+    epd.render(screen);
+    wrong += differences(panel.shown[0], screen, SIZE);
+    wrong += epd.getUpdateCount() != COUNTS[i];
+  }
+  wrong += panel.trace != "BLfBfBfBF" "BLfBfBfBF";
+  wrong += memcmp(panel.lut, WAVEFORM, sizeof(WAVEFORM)) != 0;
+  panel.trace.clear();
+  epd.render(screen);
+  epd.fullRefresh();
+  wrong += epd.getUpdateCount() != 0;
+  epd.render(screen);
+  epd.setFullRefresh();
+  epd.render(screen);
+  wrong += panel.trace != "BLfFBLfBF";
+  report("refresh, fast to a limit", wrong);
+
+  // fast until the interval from the last full refresh has passed, checked as each image is rendered
+  wrong = 0;
+  start(epd);
+  epd.setFastRefresh(WAVEFORM, sizeof(WAVEFORM), 0, 1000);
+  static const unsigned long TIMES[] = {0, 500, 999, 1000, 1500, 1999, 2000};
+  for (const unsigned long t : TIMES)
+  {
+    mock::now = t;
+    epd.render(screen);
+  }
+  mock::now = 0;
+  wrong += panel.trace != "BLfBfBfBF" "BLfBfBF";
+  report("refresh, fast for an interval", wrong);
+
+  // with differential updates each screen is written to the previous image RAM, before a full refresh and after a
+  // fast one, and only the pixels which change are updated
+  wrong = 0;
+  start(epd);
+  epd.setFastRefresh(WAVEFORM, sizeof(WAVEFORM), 2, 0, true);
+  for (int i = 0; i < 5; ++i)
+  {
+    memset(screen, SCREENS[i], sizeof(screen));
+    epd.render(screen);
+    wrong += in_step() + differences(panel.shown[0], screen, SIZE);
+  }
+  wrong += panel.trace != "BRF" "BLdR" "BdR" "BRF" "BLdR";
+  report("refresh, differential", wrong);
+}
+
+// a PBM image of w by h pixels from the noise, with the header given
+static std::string pbm(const char* const header, const int16_t w, const int16_t h, const uint8_t* const noise)
+{
+  return std::string(header) + std::string(reinterpret_cast<const char*>(noise), static_cast<size_t>((w + 7) / 8) * h);
+}
+
+// how many bytes of the image RAM aren't the PBM image of w by h pixels, cropped to the panel and padded with white
+static int pbm_differences(const int16_t w, const int16_t h, const uint8_t* const noise)
+{
+  const int16_t source = (w + 7) / 8;
+  int wrong = 0;
+  for (int16_t y = 0; y < HEIGHT; ++y)
+    for (int16_t b = 0; b < STRIDE; ++b)
+    {
+      uint8_t expected = 0xff;
+      for (int16_t k = 0; k < 8; ++k)
+      {
+        const int16_t x = b * 8 + k;
+        if (x < w && y < h && noise[y * source + x / 8] & (0x80 >> (x & 7)))
+          expected &= ~(0x80 >> k);
+      }
+      wrong += panel.ram[0][y * STRIDE + b] != expected;
+    }
+  return wrong;
+}
+
+// images read from a stream, raw and with a PBM header, and streams which are cut short or aren't PBM images
+static void check_streams()
+{
+  uint8_t noise[1024];
+  for (uint8_t& v : noise)
+    v = rand();
+  EPDLite epd(WIDTH, HEIGHT, CS, DC, BUSY, RESET);
+
+  // each row is written as it is read
+  const std::string rows = std::string(HEIGHT, 'B') + "F";
+
+  // the raw display data, whole and cut short, which leaves the rest white
+  int wrong = 0;
+  start(epd, 0xaa);
+  MemoryStream raw(std::string(reinterpret_cast<const char*>(noise), SIZE));
+  wrong += !epd.render(raw) + differences(panel.ram[0], noise, SIZE) + (panel.trace != rows);
+  start(epd, 0xaa);
+  MemoryStream half(std::string(reinterpret_cast<const char*>(noise), SIZE / 2 + 3));
+  wrong += epd.render(half) + differences(panel.ram[0], noise, SIZE / 2 + 3) + (panel.trace != rows);
+  for (size_t i = SIZE / 2 + 3; i < SIZE; ++i)
+    wrong += panel.ram[0][i] != 0xff;
+  report("streams, raw", wrong);
+
+  // headers with comments and every kind of whitespace
+  static const char* const HEADERS[] = {
+    "P4\n48 16\n",
+    "P4 48 16 ",
+    "P4\n# made by hand\n#\n48\t16\r",
+    "P4#comment\n 48#between\n16\n",
+    "P4\r\n\r\n  48\r\n16\n",
+  };
+  wrong = 0;
+  for (const char* const header : HEADERS)
+  {
+    start(epd, 0xaa);
+    MemoryStream stream(pbm(header, WIDTH, HEIGHT, noise));
+    wrong += !epd.render(stream, true) + pbm_differences(WIDTH, HEIGHT, noise) + (panel.trace != rows);
+    wrong += stream.remaining() != 0;
+  }
+  report("streams, PBM headers", wrong);
+
+  // narrower and shorter images are padded with white, wider and taller ones cropped, and the rows of the stream are
+  // read whole
+  static const struct
+  {
+    int16_t w, h;
+  } SIZES[] = {{20, 10}, {41, 16}, {8, 1}, {49, 17}, {70, 40}, {200, 3}};
+  wrong = 0;
+  for (const auto& size : SIZES)
+  {
+    start(epd, 0xaa);
+    char header[32];
+    snprintf(header, sizeof(header), "P4\n%d %d\n", size.w, size.h);
+    MemoryStream stream(pbm(header, size.w, size.h, noise));
+    wrong += !epd.render(stream, true) + pbm_differences(size.w, size.h, noise);
+    // only the rows on the panel are read
+    const size_t left = size.h > HEIGHT ? size.h - HEIGHT : 0;
+    wrong += stream.remaining() != left * ((size.w + 7) / 8);
+  }
+  report("streams, PBM cropped and padded", wrong);
+
+  // a header which isn't whole or isn't a P4 image renders nothing, while image data cut short leaves the rest white
+  static const char* const BROKEN[] = {
+    "", "P", "P5\n48 16\n", "p4\n48 16\n", "P4", "P4\n48", "P4\n48 ", "P4\n# no end to the comment",
+    "P4\n0 16\n", "P4\n48 0\n", "P4\nx 16\n", "P4\n-48 16\n", "P4\n40000 16\n", "P4\n48 16#",
+  };
+  wrong = 0;
+  for (const char* const header : BROKEN)
+  {
+    start(epd, 0xaa);
+    MemoryStream stream(header);
+    wrong += epd.render(stream, true) + (panel.trace != "");
+  }
+  start(epd, 0xaa);
+  MemoryStream cut(pbm("P4\n48 16\n", WIDTH, HEIGHT, noise).substr(0, 9 + 5 * STRIDE + 2));
+  wrong += epd.render(cut, true) + (panel.trace != rows);
+  for (size_t i = 0; i < SIZE; ++i)
+    wrong += panel.ram[0][i] != (i < 5 * STRIDE + 2 ? static_cast<uint8_t>(~noise[i]) : 0xff);
+  report("streams, PBM broken and cut short", wrong);
+}
+
+int main()
+{
+  mock::receive = receive;
+  srand(1);
+
+  check_windows();
+  check_refresh();
+  check_streams();
+
+  return failed;
+}
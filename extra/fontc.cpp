@@ -0,0 +1,453 @@
+// Compiles BDF or text glyph files into packed fonts for use with EPDLite
+//
+// usage: fontc [options] <font.bdf|font.txt>
+//   -n <name>       name of the generated font (default: from the file name)
+//   -r <first-last> range of characters to include (default: every character in the file)
+//   -s              always store a sorted table of the characters in the font, rather than only when it's smaller
+//   -i <header>     header to include for PackedFont (default: EPDLite.h)
+//   -p <text>       preview some text on stderr, drawn by the library's renderer
+//   -o <file>       write to a file rather than stdout
+//
+// Text glyph files hold a height, followed by each glyph as a `char` line and one line per row, `#` is ink and anything else is blank:
+//
+//   # comment
+//   height 7
+//   char 'A' advance 6
+//   .###.
+//   #...#
+//   ...
+//
+// Characters are given as a quoted UTF-8 character, a decimal number or U+XXXX. The advance is optional, and defaults to the glyph width plus one.
+//
+// Fonts with gaps between their characters, such as ASCII plus a few symbols, store a sorted table of their characters instead of an
+// entry for every character in the range, whichever is smaller.
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "stub.h"
+#include "../src/EPDLite/canvas.h"
+#include "../src/EPDLite/packedfont.h"
+
+struct SourceGlyph
+{
+  int width;
+  int advance;
+  std::vector<std::string> rows; // '#' is ink
+};
+
+struct SourceFont
+{
+  int height;
+  std::map<unsigned long, SourceGlyph> glyphs;
+};
+
+static bool parse_char(const std::string& token, unsigned long& c)
+{
+  if (token.size() >= 3 && token[0] == '\'' && token[token.size() - 1] == '\'')
+  {
+    const char* p = token.c_str() + 1;
+    c = utf8_next(p);
+    return p == token.c_str() + token.size() - 1;
+  }
+  else if (token.compare(0, 2, "U+") == 0 || token.compare(0, 2, "u+") == 0)
+    c = strtoul(token.c_str() + 2, nullptr, 16);
+  else if (!token.empty() && isdigit(static_cast<unsigned char>(token[0])))
+    c = strtoul(token.c_str(), nullptr, 0);
+  else
+    return false;
+  return true;
+}
+
+static bool read_text(std::istream& in, SourceFont& font)
+{
+  font.height = 0;
+  std::string line;
+  int number = 0;
+  while (std::getline(in, line))
+  {
+    ++number;
+    std::istringstream words(line);
+    std::string keyword;
+    if (!(words >> keyword) || keyword[0] == '#')
+      continue;
+
+    if (keyword == "height")
+      words >> font.height;
+    else if (keyword == "char")
+    {
+      // a quoted space would be split by >>, so take the character straight from the line
+      std::string token;
+      const size_t quote = line.find('\'');
+      const size_t close = quote == std::string::npos ? quote : line.find('\'', quote + 2);
+      if (close != std::string::npos)
+      {
+        token = line.substr(quote, close - quote + 1);
+        words.str(line.substr(close + 1));
+        words.clear();
+      }
+      else
+        words >> token;
+
+      unsigned long c;
+      if (font.height <= 0 || !parse_char(token, c))
+      {
+        fprintf(stderr, "line %d: expected a height before a character\n", number);
+        return false;
+      }
+
+      SourceGlyph glyph = {0, -1, {}};
+      std::string option;
+      while (words >> option)
+      {
+        if (option == "advance")
+          words >> glyph.advance;
+      }
+
+      for (int r = 0; r < font.height; ++r)
+      {
+        if (!std::getline(in, line))
+        {
+          fprintf(stderr, "line %d: glyph ends early\n", number);
+          return false;
+        }
+        ++number;
+        for (char& p : line)
+          p = p == '#' ? '#' : '.';
+        glyph.rows.push_back(line);
+        if (static_cast<int>(line.size()) > glyph.width)
+          glyph.width = line.size();
+      }
+
+      if (glyph.advance < 0)
+        glyph.advance = glyph.width + 1;
+      font.glyphs[c] = glyph;
+    }
+    else
+    {
+      fprintf(stderr, "line %d: unexpected %s\n", number, keyword.c_str());
+      return false;
+    }
+  }
+  return font.height > 0;
+}
+
+static bool read_bdf(std::istream& in, SourceFont& font)
+{
+  int ascent = -1;
+  int descent = -1;
+  int box_height = 0;
+  int box_y = 0;
+
+  std::string line;
+  long encoding = -1;
+  int advance = 0;
+  int bw = 0, bh = 0, bx = 0, by = 0;
+  while (std::getline(in, line))
+  {
+    std::istringstream words(line);
+    std::string keyword;
+    words >> keyword;
+
+    if (keyword == "FONTBOUNDINGBOX")
+    {
+      int box_width, box_x;
+      words >> box_width >> box_height >> box_x >> box_y;
+    }
+    else if (keyword == "FONT_ASCENT")
+      words >> ascent;
+    else if (keyword == "FONT_DESCENT")
+      words >> descent;
+    else if (keyword == "ENCODING")
+      words >> encoding;
+    else if (keyword == "DWIDTH")
+      words >> advance;
+    else if (keyword == "BBX")
+      words >> bw >> bh >> bx >> by;
+    else if (keyword == "BITMAP")
+    {
+      if (ascent < 0 || descent < 0)
+      {
+        ascent = box_height + box_y;
+        descent = -box_y;
+      }
+      font.height = ascent + descent;
+
+      SourceGlyph glyph;
+      glyph.width = bx + bw > 0 ? bx + bw : 0;
+      glyph.advance = advance;
+      glyph.rows.assign(font.height, std::string(glyph.width, '.'));
+
+      // the bounding box is relative to the baseline, which is ascent rows down from the top
+      const int top = ascent - by - bh;
+      for (int i = 0; i < bh && std::getline(in, line); ++i)
+      {
+        const int r = top + i;
+        for (int j = 0; j < bw; ++j)
+        {
+          const int x = bx + j;
+          const size_t digit = j / 4;
+          if (digit >= line.size() || x < 0 || r < 0 || r >= font.height)
+            continue;
+          const int nibble = strtol(line.substr(digit, 1).c_str(), nullptr, 16);
+          if (nibble & (8 >> (j % 4)))
+            glyph.rows[r][x] = '#';
+        }
+      }
+
+      if (encoding >= 0)
+        font.glyphs[encoding] = glyph;
+      encoding = -1;
+    }
+  }
+  return font.height > 0 && !font.glyphs.empty();
+}
+
+static std::string font_name(const char* const path)
+{
+  std::string name = path;
+  const size_t slash = name.find_last_of("/\\");
+  if (slash != std::string::npos)
+    name = name.substr(slash + 1);
+  const size_t dot = name.find('.');
+  if (dot != std::string::npos)
+    name = name.substr(0, dot);
+
+  for (char& c : name)
+  {
+    if (!isalnum(static_cast<unsigned char>(c)))
+      c = '_';
+  }
+  if (name.empty() || isdigit(static_cast<unsigned char>(name[0])))
+    name = "font_" + name;
+  return name;
+}
+
+static void describe(FILE* out, const unsigned long c)
+{
+  if (c >= 32 && c < 127 && c != '\\')
+    fprintf(out, " // '%c'", static_cast<char>(c));
+  else
+    fprintf(out, " // U+%04lX", c);
+}
+
+int main(int argc, char** argv)
+{
+  std::string name;
+  std::string header = "EPDLite.h";
+  const char* preview = nullptr;
+  const char* output = nullptr;
+  const char* input = nullptr;
+  long first = -1;
+  long last = -1;
+  bool sparse = false;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "-n" && has_value)
+      name = argv[++i];
+    else if (arg == "-r" && has_value)
+    {
+      char* end;
+      first = strtol(argv[++i], &end, 0);
+      last = *end == '-' ? strtol(end + 1, nullptr, 0) : first;
+    }
+    else if (arg == "-s")
+      sparse = true;
+    else if (arg == "-i" && has_value)
+      header = argv[++i];
+    else if (arg == "-p" && has_value)
+      preview = argv[++i];
+    else if (arg == "-o" && has_value)
+      output = argv[++i];
+    else if (arg[0] != '-' && !input)
+      input = argv[i];
+    else
+      input = nullptr, i = argc;
+  }
+
+  if (!input)
+  {
+    fprintf(stderr, "usage: %s [-n name] [-r first-last] [-s] [-i header] [-p text] [-o output] <font.bdf|font.txt>\n", argv[0]);
+    return 1;
+  }
+
+  if (name.empty())
+    name = font_name(input);
+
+  std::ifstream in(input);
+  std::string magic;
+  if (!in || !(in >> magic))
+  {
+    fprintf(stderr, "can't read %s\n", input);
+    return 1;
+  }
+  in.seekg(0);
+
+  SourceFont source;
+  if (!(magic == "STARTFONT" ? read_bdf(in, source) : read_text(in, source)))
+  {
+    fprintf(stderr, "%s has no glyphs\n", input);
+    return 1;
+  }
+
+  if (first < 0)
+  {
+    first = source.glyphs.begin()->first;
+    last = source.glyphs.rbegin()->first;
+  }
+  if (last < first || last > 0xffff || last - first >= 0xffff)
+  {
+    fprintf(stderr, "invalid range %ld-%ld\n", first, last);
+    return 1;
+  }
+
+  // every character in the range takes 4 bytes, a table of only the characters in the font takes 6 bytes for each
+  std::vector<unsigned long> characters;
+  for (const auto& g : source.glyphs)
+  {
+    if (static_cast<long>(g.first) >= first && static_cast<long>(g.first) <= last)
+      characters.push_back(g.first);
+  }
+  sparse = sparse || characters.size() * 6 < static_cast<size_t>(last - first + 1) * 4;
+  if (!sparse)
+  {
+    characters.clear();
+    for (long c = first; c <= last; ++c)
+      characters.push_back(c);
+  }
+
+  // pack each glyph in the display's format, blank glyphs take no space
+  std::vector<uint8_t> bitmap;
+  std::vector<Glyph> glyphs;
+  std::vector<uint16_t> codepoints;
+  for (const unsigned long c : characters)
+  {
+    codepoints.push_back(static_cast<uint16_t>(c));
+    Glyph glyph = {static_cast<uint16_t>(bitmap.size()), 0, 0};
+    const auto found = source.glyphs.find(c);
+    if (found != source.glyphs.end())
+    {
+      const SourceGlyph& g = found->second;
+      glyph.advance = static_cast<uint8_t>(g.advance);
+
+      // trailing blank columns aren't drawn
+      int width = 0;
+      for (const std::string& row : g.rows)
+      {
+        const size_t ink = row.find_last_of('#');
+        if (ink != std::string::npos && static_cast<int>(ink) + 1 > width)
+          width = ink + 1;
+      }
+      if (width > 255)
+      {
+        fprintf(stderr, "glyph %lu is wider than 255 pixels\n", c);
+        return 1;
+      }
+      glyph.width = static_cast<uint8_t>(width);
+
+      for (int r = 0; width && r < source.height; ++r)
+      {
+        for (int b = 0; b < glyph.stride(); ++b)
+        {
+          uint8_t byte = 0xff;
+          for (int bit = 0; bit < 8; ++bit)
+          {
+            const size_t x = b * 8 + bit;
+            if (x < g.rows[r].size() && g.rows[r][x] == '#')
+              byte &= ~(0x80 >> bit);
+          }
+          bitmap.push_back(byte);
+        }
+      }
+    }
+    glyphs.push_back(glyph);
+
+    if (bitmap.size() > 0xffff)
+    {
+      fprintf(stderr, "the font is larger than 64KB\n");
+      return 1;
+    }
+  }
+
+  const PackedFont font = {bitmap.data(), glyphs.data(), codepoints.front(), static_cast<uint16_t>(glyphs.size()), static_cast<int16_t>(source.height), sparse ? codepoints.data() : nullptr};
+
+  fprintf(stderr, "%s: %zu glyphs, %d pixels high, %zu bytes, %s\n", name.c_str(), glyphs.size(), source.height, bitmap.size() + glyphs.size() * (sparse ? 6 : 4), sparse ? "sorted table" : "range");
+
+  if (preview)
+  {
+    const int16_t width = font.width(preview);
+    const int16_t stride = (width + 7) / 8;
+    std::vector<uint8_t> strip(stride * source.height, 0xff);
+    Canvas canvas(strip.data(), width, 0, source.height);
+    canvas.text(0, 0, preview, font);
+    for (int y = 0; y < source.height; ++y)
+    {
+      for (int x = 0; x < width; ++x)
+        fputc(strip[y * stride + x / 8] & (0x80 >> (x % 8)) ? '.' : '#', stderr);
+      fputc('\n', stderr);
+    }
+  }
+
+  FILE* out = output ? fopen(output, "w") : stdout;
+  if (!out)
+  {
+    fprintf(stderr, "can't open %s\n", output);
+    return 1;
+  }
+
+  std::string guard = "EPDLITE_FONT_" + name + "_H_INCLUDE";
+  for (char& c : guard)
+    c = toupper(static_cast<unsigned char>(c));
+
+  fprintf(out, "// generated by fontc from %s\n\n", input);
+  fprintf(out, "#ifndef %s\n#define %s\n\n", guard.c_str(), guard.c_str());
+  fprintf(out, "#ifndef PROGMEM\n#include <avr/pgmspace.h>\n#endif\n\n");
+  fprintf(out, "#include %s\n\n", header[0] == '<' || header[0] == '"' ? header.c_str() : ("<" + header + ">").c_str());
+
+  fprintf(out, "const uint8_t %s_bitmap[%zu] PROGMEM = {", name.c_str(), bitmap.size() ? bitmap.size() : 1);
+  for (size_t i = 0; i < glyphs.size(); ++i)
+  {
+    const size_t end = i + 1 < glyphs.size() ? glyphs[i + 1].offset : bitmap.size();
+    if (glyphs[i].offset == end)
+      continue;
+    fprintf(out, "\n ");
+    for (size_t b = glyphs[i].offset; b < end; ++b)
+      fprintf(out, " 0x%02x,", bitmap[b]);
+    describe(out, codepoints[i]);
+  }
+  fprintf(out, "%s\n};\n\n", bitmap.empty() ? "0xff" : "");
+
+  fprintf(out, "const Glyph %s_glyphs[%zu] PROGMEM = {\n", name.c_str(), glyphs.size());
+  for (size_t i = 0; i < glyphs.size(); ++i)
+  {
+    fprintf(out, "  {%u, %u, %u},", glyphs[i].offset, glyphs[i].width, glyphs[i].advance);
+    describe(out, codepoints[i]);
+    fprintf(out, "\n");
+  }
+  fprintf(out, "};\n\n");
+
+  if (sparse)
+  {
+    fprintf(out, "const uint16_t %s_codepoints[%zu] PROGMEM = {", name.c_str(), codepoints.size());
+    for (size_t i = 0; i < codepoints.size(); ++i)
+      fprintf(out, "%s0x%04x,", i % 8 ? " " : "\n  ", codepoints[i]);
+    fprintf(out, "\n};\n\n");
+  }
+
+  fprintf(out, "static const PackedFont %s = {\n  %s_bitmap,\n  %s_glyphs,\n  %u,\n  %zu,\n  %d,\n  %s\n};\n\n", name.c_str(), name.c_str(), name.c_str(), codepoints.front(), glyphs.size(), source.height, sparse ? (name + "_codepoints").c_str() : "nullptr");
+  fprintf(out, "#endif\n");
+
+  if (output)
+    fclose(out);
+  return 0;
+}
@@ -0,0 +1,313 @@
+// Converts PBM/PGM images for use with EPDLite
+//
+// usage: imgconv [options] <image.pbm|image.pgm>
+//   -n <name>       name of the generated variables (default: from the file name)
+//   -f <format>     c (default): Bitmap with a row major PROGMEM array
+//                   compressed: CompressedImage with a compressed PROGMEM array
+//                   raw: binary display data, e.g., to render from an SD card with render(Stream&)
+//   -t <threshold>  grey level (0-255) below which pixels are black (default: 128)
+//   -d <dither>     none (default), floyd (Floyd-Steinberg) or bayer (ordered 4x4)
+//   -i              invert the image
+//   -o <file>       write to a file rather than stdout
+//
+// The sizes of the row major and compressed data are written to stderr, to help pick a format.
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "stub.h"
+#include "compress.h"
+#include "../src/EPDLite/compressed.h"
+
+struct Image
+{
+  int width;
+  int height;
+  std::vector<int> grey; // 0 is black, 255 is white
+};
+
+static int read_token(FILE* f)
+{
+  int c = fgetc(f);
+  while (c != EOF && (isspace(c) || c == '#'))
+  {
+    if (c == '#')
+    {
+      while (c != EOF && c != '\n')
+        c = fgetc(f);
+    }
+    c = fgetc(f);
+  }
+
+  if (c == EOF || !isdigit(c))
+    return -1;
+
+  int value = 0;
+  while (c != EOF && isdigit(c))
+  {
+    value = value * 10 + (c - '0');
+    c = fgetc(f);
+  }
+  // one whitespace character ends the token, which also separates the header from binary data
+  return value;
+}
+
+static bool read_image(const char* const path, Image& image)
+{
+  FILE* f = fopen(path, "rb");
+  if (!f)
+  {
+    fprintf(stderr, "can't open %s\n", path);
+    return false;
+  }
+
+  char magic[2];
+  if (fread(magic, 1, 2, f) != 2 || magic[0] != 'P' || magic[1] < '1' || magic[1] == '3' || magic[1] > '5')
+  {
+    fprintf(stderr, "%s is not a PBM or PGM image\n", path);
+    fclose(f);
+    return false;
+  }
+
+  const bool bitmap = magic[1] == '1' || magic[1] == '4';
+  const bool ascii = magic[1] <= '3';
+
+  image.width = read_token(f);
+  image.height = read_token(f);
+  const int maxval = bitmap ? 1 : read_token(f);
+  if (image.width <= 0 || image.height <= 0 || maxval <= 0 || maxval > 65535)
+  {
+    fprintf(stderr, "%s has an invalid header\n", path);
+    fclose(f);
+    return false;
+  }
+
+  image.grey.resize(static_cast<size_t>(image.width) * image.height);
+  bool ok = true;
+  for (int y = 0; ok && y < image.height; ++y)
+  {
+    int bits = 0;
+    int byte = 0;
+    for (int x = 0; ok && x < image.width; ++x)
+    {
+      int value;
+      if (ascii)
+        value = read_token(f);
+      else if (bitmap)
+      {
+        if (bits == 0)
+        {
+          byte = fgetc(f);
+          bits = 8;
+        }
+        value = byte < 0 ? -1 : (byte >> --bits) & 1;
+      }
+      else if (maxval > 255)
+      {
+        const int hi = fgetc(f);
+        const int lo = fgetc(f);
+        value = hi < 0 || lo < 0 ? -1 : (hi << 8) | lo;
+      }
+      else
+        value = fgetc(f);
+
+      if (value < 0)
+      {
+        fprintf(stderr, "%s ended early\n", path);
+        ok = false;
+        break;
+      }
+
+      // PBM uses 1 for black, PGM uses 0
+      image.grey[static_cast<size_t>(y) * image.width + x] = bitmap ? (value ? 0 : 255) : value * 255 / maxval;
+    }
+  }
+
+  fclose(f);
+  return ok;
+}
+
+// converts to the display's format, MSB first with 0 for black
+static std::vector<uint8_t> to_display(Image& image, const int threshold, const std::string& dither)
+{
+  static const int bayer[4][4] = {
+    { 0,  8,  2, 10},
+    {12,  4, 14,  6},
+    { 3, 11,  1,  9},
+    {15,  7, 13,  5}
+  };
+
+  const size_t stride = (image.width + 7) / 8;
+  std::vector<uint8_t> out(stride * image.height, 0xff);
+
+  for (int y = 0; y < image.height; ++y)
+  {
+    for (int x = 0; x < image.width; ++x)
+    {
+      const int grey = image.grey[static_cast<size_t>(y) * image.width + x];
+
+      // the ordered pattern moves the threshold around its set level
+      const int level = dither == "bayer" ? threshold + (bayer[y % 4][x % 4] * 2 - 15) * 8 : threshold;
+
+      const bool black = grey < level;
+      if (black)
+        out[y * stride + x / 8] &= ~(1 << (7 - x % 8));
+
+      if (dither == "floyd")
+      {
+        const int error = grey - (black ? 0 : 255);
+        const auto spread = [&](const int dx, const int dy, const int weight) {
+          const int nx = x + dx;
+          const int ny = y + dy;
+          if (nx >= 0 && nx < image.width && ny < image.height)
+            image.grey[static_cast<size_t>(ny) * image.width + nx] += error * weight / 16;
+        };
+        spread(1, 0, 7);
+        spread(-1, 1, 3);
+        spread(0, 1, 5);
+        spread(1, 1, 1);
+      }
+    }
+  }
+
+  return out;
+}
+
+static std::string variable_name(const char* const path)
+{
+  std::string name = path;
+  const size_t slash = name.find_last_of("/\\");
+  if (slash != std::string::npos)
+    name = name.substr(slash + 1);
+  const size_t dot = name.find('.');
+  if (dot != std::string::npos)
+    name = name.substr(0, dot);
+
+  for (char& c : name)
+  {
+    if (!isalnum(static_cast<unsigned char>(c)))
+      c = '_';
+  }
+  if (name.empty() || isdigit(static_cast<unsigned char>(name[0])))
+    name = "image_" + name;
+  return name;
+}
+
+static void write_array(FILE* out, const std::string& name, const std::vector<uint8_t>& data)
+{
+  fprintf(out, "const uint8_t %s_data[%zu] PROGMEM = {", name.c_str(), data.size());
+  for (size_t i = 0; i < data.size(); ++i)
+    fprintf(out, "%s0x%02x,", i % 16 ? " " : "\n  ", data[i]);
+  fprintf(out, "\n};\n\n");
+}
+
+int main(int argc, char** argv)
+{
+  std::string name;
+  std::string format = "c";
+  std::string dither = "none";
+  const char* output = nullptr;
+  const char* input = nullptr;
+  int threshold = 128;
+  bool invert = false;
+
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "-n" && has_value)
+      name = argv[++i];
+    else if (arg == "-f" && has_value)
+      format = argv[++i];
+    else if (arg == "-t" && has_value)
+      threshold = atoi(argv[++i]);
+    else if (arg == "-d" && has_value)
+      dither = argv[++i];
+    else if (arg == "-o" && has_value)
+      output = argv[++i];
+    else if (arg == "-i")
+      invert = true;
+    else if (arg[0] != '-' && !input)
+      input = argv[i];
+    else
+      input = nullptr, i = argc;
+  }
+
+  if (!input || (format != "c" && format != "compressed" && format != "raw") || (dither != "none" && dither != "floyd" && dither != "bayer"))
+  {
+    fprintf(stderr, "usage: %s [-n name] [-f c|compressed|raw] [-t threshold] [-d none|floyd|bayer] [-i] [-o output] <image.pbm|image.pgm>\n", argv[0]);
+    return 1;
+  }
+
+  if (name.empty())
+    name = variable_name(input);
+
+  Image image;
+  if (!read_image(input, image))
+    return 1;
+
+  if (invert)
+  {
+    for (int& grey : image.grey)
+      grey = 255 - grey;
+  }
+
+  const size_t stride = (image.width + 7) / 8;
+  const std::vector<uint8_t> display = to_display(image, threshold, dither);
+  const std::vector<uint8_t> compressed = stride <= 255 ? compress::encode(display.data(), stride, image.height) : std::vector<uint8_t>();
+
+  // check it decodes with the library's decoder
+  std::vector<uint8_t> row(stride);
+  ImageDecoder decoder(compressed.data(), false);
+  for (int y = 0; !compressed.empty() && y < image.height; ++y)
+  {
+    decoder.next(row.data(), stride);
+    if (!std::equal(row.begin(), row.end(), display.begin() + y * stride))
+    {
+      fprintf(stderr, "compression round trip failed at row %d\n", y);
+      return 1;
+    }
+  }
+
+  fprintf(stderr, "%s: %dx%d, row major %zu bytes, compressed %zu bytes\n", name.c_str(), image.width, image.height, display.size(), compressed.size());
+
+  if (format == "compressed" && stride > 255)
+  {
+    fprintf(stderr, "images wider than 2040 pixels can't be compressed\n");
+    return 1;
+  }
+
+  FILE* out = output ? fopen(output, format == "raw" ? "wb" : "w") : stdout;
+  if (!out)
+  {
+    fprintf(stderr, "can't open %s\n", output);
+    return 1;
+  }
+
+  if (format == "raw")
+    fwrite(display.data(), 1, display.size(), out);
+  else
+  {
+    fprintf(out, "// generated by imgconv from %s\n", input);
+    fprintf(out, "#include <EPDLite.h>\n\n");
+    if (format == "compressed")
+    {
+      write_array(out, name, compressed);
+      fprintf(out, "const CompressedImage %s = {%s_data, %d, %d};\n", name.c_str(), name.c_str(), image.width, image.height);
+    }
+    else
+    {
+      write_array(out, name, display);
+      fprintf(out, "const Bitmap %s = {%s_data, %d, %d};\n", name.c_str(), name.c_str(), image.width, image.height);
+    }
+  }
+
+  if (output)
+    fclose(out);
+  return 0;
+}
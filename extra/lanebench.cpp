@@ -0,0 +1,140 @@
+// Benchmarks the span rasterizers, reporting the speedup of each lane width over drawing a byte at a time
+//
+// usage: lanebench [spans]
+//
+// Spans are drawn as the command buffer draws them, within a chunk of a row, and as page mode draws them, across a
+// whole row. The rows drawn are checked to be the same for every lane.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "stub.h"
+#include "../src/EPDLite/raster.h"
+
+static const int16_t WIDTH = 800;
+static const int16_t STRIDE = WIDTH / 8;
+static const int16_t CHUNK = 64; // pixels in a chunk of a row, as CommandBufferInterface renders it
+
+struct Span
+{
+  int16_t x0, x1; // the pixels which can be drawn
+  int16_t x;      // where a bitmap starts
+  int16_t y;
+};
+
+static uint8_t bitmap[STRIDE];
+
+template <typename TLane>
+struct Fill
+{
+  static void draw(uint8_t* const row, const Span& s) { fill_span<TLane>(row, s.x0, s.x1, s.y, Style(DRAW_XOR, PATTERN_GRAY50)); }
+};
+
+template <typename TLane>
+struct Solid
+{
+  static void draw(uint8_t* const row, const Span& s) { fill_span<TLane>(row, s.x0, s.x1, s.y, Style()); }
+};
+
+template <typename TLane>
+struct Glyph
+{
+  static void draw(uint8_t* const row, const Span& s) { blit_span<TLane>(row, s.x0, s.x1, s.x, bitmap, 12, false); }
+};
+
+template <typename TLane>
+struct Blit
+{
+  static void draw(uint8_t* const row, const Span& s) { blit_span<TLane>(row, s.x0, s.x1, s.x, bitmap, 200, false); }
+};
+
+/**
+ * @brief Draws every span into a row, a lane at a time
+ * @return Nanoseconds a span
+ */
+template <template <typename> class TDraw, typename TLane>
+static double measure(const std::vector<Span>& spans, uint8_t* const row)
+{
+  memset(row, 0xff, STRIDE);
+  const auto start = std::chrono::steady_clock::now();
+  for (const Span& s : spans)
+    TDraw<TLane>::draw(row, s);
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return spans.empty() ? 0 : seconds * 1e9 / spans.size();
+}
+
+/**
+ * @brief Reports one kind of span for every lane
+ * @return false if the lanes drew differently
+ */
+template <template <typename> class TDraw>
+static bool report(const char* const name, const std::vector<Span>& spans)
+{
+  // 8 byte aligned, as the command buffer's row buffers are on a host
+  alignas(8) uint8_t rows[3][STRIDE];
+
+  // warm up the caches
+  measure<TDraw, uint8_t>(spans, rows[0]);
+
+  const double bytes = measure<TDraw, uint8_t>(spans, rows[0]);
+  const double words = measure<TDraw, uint32_t>(spans, rows[1]);
+  const double wide = measure<TDraw, uint64_t>(spans, rows[2]);
+  printf("%-12s %10.2f %10.2f %7.2fx %10.2f %7.2fx\n", name, bytes, words, bytes / words, wide, bytes / wide);
+
+  return !memcmp(rows[0], rows[1], STRIDE) && !memcmp(rows[0], rows[2], STRIDE);
+}
+
+int main(int argc, char** argv)
+{
+  const size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000000;
+
+  srand(1);
+  for (uint8_t& b : bitmap)
+    b = rand();
+
+  // within a chunk, random ends
+  std::vector<Span> chunks(count);
+  for (Span& s : chunks)
+  {
+    const int16_t base = rand() % (WIDTH / CHUNK) * CHUNK;
+    int16_t a = base + rand() % CHUNK;
+    int16_t b = base + rand() % CHUNK;
+    if (a > b)
+    {
+      const int16_t t = a;
+      a = b;
+      b = t;
+    }
+    s = {a, b, static_cast<int16_t>(base + rand() % CHUNK - 8), static_cast<int16_t>(rand() % 8)};
+  }
+
+  // across most of a row
+  std::vector<Span> rows(count / 8);
+  for (Span& s : rows)
+  {
+    const int16_t a = rand() % 64;
+    s = {a, static_cast<int16_t>(WIDTH - 1 - rand() % 64), static_cast<int16_t>(rand() % (WIDTH - 200)), static_cast<int16_t>(rand() % 8)};
+  }
+
+  printf("%zu spans in chunks of %d pixels, %zu across a %d pixel row, ns a span\n", chunks.size(), CHUNK, rows.size(), WIDTH);
+  printf("%-12s %10s %10s %8s %10s %8s\n", "span", "8 bit", "32 bit", "speedup", "64 bit", "speedup");
+
+  bool same = true;
+  same &= report<Solid>("chunk solid", chunks);
+  same &= report<Fill>("chunk xor", chunks);
+  same &= report<Glyph>("chunk glyph", chunks);
+  same &= report<Solid>("row solid", rows);
+  same &= report<Fill>("row xor", rows);
+  same &= report<Blit>("row bitmap", rows);
+
+  if (!same)
+  {
+    fprintf(stderr, "lanes drew differently\n");
+    return 1;
+  }
+  return 0;
+}
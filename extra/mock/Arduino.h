@@ -0,0 +1,62 @@
+// Just enough of the Arduino core to run the display driver on the host, @see drivertest.cpp
+
+#ifndef MOCK_ARDUINO_H_INCLUDE
+#define MOCK_ARDUINO_H_INCLUDE
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define OUTPUT 1
+#define INPUT 0
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+inline uint8_t pgm_read_byte(const void* p) { return *static_cast<const uint8_t*>(p); }
+inline uint16_t pgm_read_word(const void* p) { return *static_cast<const uint16_t*>(p); }
+
+namespace mock
+{
+/**
+ * @brief The level last written to each pin
+ */
+extern uint8_t pins[128];
+/**
+ * @brief The milliseconds returned by millis, moved on by the test
+ */
+extern unsigned long now;
+}
+
+inline void pinMode(const int, const int) {}
+inline void digitalWrite(const int pin, const int level) { mock::pins[pin & 0x7f] = level; }
+// the display is never busy
+inline int digitalRead(const int) { return 0; }
+inline void delay(const unsigned long) {}
+inline unsigned long millis() { return mock::now; }
+
+/**
+ * @brief A source of bytes, read a byte at a time by readBytes as on the boards
+ */
+class Stream
+{
+public:
+  virtual ~Stream() {}
+
+  /**
+   * @brief The next byte, or -1 once there are none
+   */
+  virtual int read() = 0;
+
+  size_t readBytes(uint8_t* const buffer, const size_t length)
+  {
+    size_t n = 0;
+    for (int c; n < length && (c = read()) >= 0; ++n)
+      buffer[n] = c;
+    return n;
+  }
+
+  size_t readBytes(char* const buffer, const size_t length) { return readBytes(reinterpret_cast<uint8_t*>(buffer), length); }
+};
+
+#endif
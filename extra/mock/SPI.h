@@ -0,0 +1,46 @@
+// The SPI bus, passing each byte sent to the test, @see drivertest.cpp
+
+#ifndef MOCK_SPI_H_INCLUDE
+#define MOCK_SPI_H_INCLUDE
+
+#include "Arduino.h"
+
+namespace mock
+{
+/**
+ * @brief Called with each byte sent on the bus
+ */
+extern void (*receive)(uint8_t value);
+}
+
+struct SPISettings
+{
+  SPISettings() {}
+  SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+class SPIClass
+{
+public:
+  void begin() {}
+  void beginTransaction(const SPISettings&) {}
+  void endTransaction() {}
+
+  uint8_t transfer(const uint8_t value)
+  {
+    mock::receive(value);
+    return 0xff;
+  }
+
+  // the bytes read back replace those sent, as on the boards
+  void transfer(void* const buffer, const size_t length)
+  {
+    uint8_t* const bytes = static_cast<uint8_t*>(buffer);
+    for (size_t i = 0; i < length; ++i)
+      bytes[i] = transfer(bytes[i]);
+  }
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,1236 @@
+// Checks the library against simple references on the host
+//
+// usage: selftest
+//
+// Each check compares what the library draws or decodes with a slower version which is plainly right, such as every
+// command evaluated a pixel at a time or a brute force test of every pixel. Each check is printed, and the exit status
+// is the number of checks which failed.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stub.h"
+#include "compress.h"
+#include "../src/EPDLite/bands.h"
+#include "../src/EPDLite/canvas.h"
+#include "../src/EPDLite/commandbuffer.h"
+#include "../src/EPDLite/compressed.h"
+#include "../src/EPDLite/raster.h"
+#include "../src/EPDLite/fonts/font5x7.h"
+#include "../src/EPDLite/fonts/numerals16.h"
+#include "../src/EPDLite/fonts/stroke.h"
+
+static const int16_t WIDTH = 152;
+static const int16_t HEIGHT = 296;
+static const int16_t STRIDE = WIDTH / 8;
+static const double PI = 3.14159265358979323846;
+
+// without kept bounds commands are measured as they are rendered, with them as the buffer is prepared
+typedef CommandBuffer<48, CommandBufferInterface::max_size_all()> PlainBuffer;
+typedef CommandBuffer<48, CommandBufferInterface::max_size_all(), 0, BUFFER_BOUNDS> BoundsBuffer;
+typedef CommandBuffer<12, CommandBufferInterface::max_size_all()> Fragment;
+typedef CommandBuffer<8, CommandBufferInterface::max_size_all(), 0, BUFFER_COLOUR> ColourBuffer;
+typedef CommandBuffer<8, CommandBufferInterface::max_size_all(), 0, BUFFER_BOUNDS | BUFFER_COLOUR> ColourBoundsBuffer;
+
+static const Vertex STAR[] PROGMEM = {{0, -40}, {12, -12}, {40, -10}, {18, 8}, {26, 38}, {0, 20}, {-26, 38}, {-18, 8}, {-40, -10}, {-12, -12}};
+static const Vertex BOW[] = {{0, 0}, {60, 30}, {60, 0}, {0, 30}};
+static const uint8_t* const PATTERNS[] = {nullptr, PATTERN_GRAY50, PATTERN_DIAGONAL, PATTERN_HORIZONTAL};
+
+static uint8_t noise[STRIDE * HEIGHT];
+static int failed = 0;
+
+static void report(const char* const name, const int wrong)
+{
+  printf("%-48s %s", name, wrong ? "FAIL" : "ok");
+  if (wrong)
+    printf(", %d wrong", wrong);
+  printf("\n");
+  failed += wrong != 0;
+}
+
+// prints a string which isn't what was expected
+static int mismatch(const char* const got, const char* const expected)
+{
+  if (!strcmp(got, expected))
+    return 0;
+  printf("  \"%s\", expected \"%s\"\n", got, expected);
+  return 1;
+}
+
+static int differences(const uint8_t* const a, const uint8_t* const b, const size_t size)
+{
+  int n = 0;
+  for (size_t i = 0; i < size; ++i)
+    n += a[i] != b[i];
+  return n;
+}
+
+static bool pixel(const uint8_t* const image, const int16_t x, const int16_t y)
+{
+  return !(image[y * STRIDE + x / 8] & (0x80 >> (x & 7)));
+}
+
+// the pixel of the drawing under pixel (x, y) of the display, undoing its orientation
+static void logical(const int16_t x, const int16_t y, const Display& epd, int16_t& lx, int16_t& ly)
+{
+  switch (epd.getOrientation())
+  {
+    case 1: lx = y; ly = epd.width - x; break;
+    case 2: lx = epd.width - x; ly = epd.height - y; break;
+    case 3: lx = epd.height - y; ly = x; break;
+    default: lx = x; ly = y; break;
+  }
+}
+
+// point (x, y) of the drawing on the display
+static Vertex physical(const int16_t x, const int16_t y, const Display& epd)
+{
+  int16_t px = x, py = y;
+  switch (epd.getOrientation())
+  {
+    case 1: px = epd.width - y; py = x; break;
+    case 2: px = epd.width - x; py = epd.height - y; break;
+    case 3: px = y; py = epd.height - x; break;
+  }
+  return {px, py};
+}
+
+// v turned a quarter turn clockwise, as a group turns its fragment, quarters times
+static Vertex turn(Vertex v, const uint8_t quarters)
+{
+  for (uint8_t i = 0; i < quarters % 4; ++i)
+    v = {static_cast<int16_t>(-v.y), v.x};
+  return v;
+}
+
+// every command evaluated a pixel at a time
+static void reference(CommandBufferInterface& buffer, const Display& epd, uint8_t* const image)
+{
+  for (int16_t y = 0; y < epd.height; ++y)
+    for (int16_t b = 0; b < STRIDE; ++b)
+    {
+      uint8_t v = 0xff;
+      for (size_t i = 0; i < buffer.size(); ++i)
+        for (int16_t k = 0; k < 8; ++k)
+          v = buffer.process(i, v, b * 8 + k, y, epd);
+      image[y * STRIDE + b] = v;
+    }
+}
+
+// rendered a row at a time, counting the rows rendered each way
+static void rows(CommandBufferInterface& buffer, const Display& epd, uint8_t* const image, int* const states = nullptr)
+{
+  buffer.prepare(epd);
+  uint8_t row[STRIDE];
+  for (int16_t y = 0; y < epd.height; ++y)
+  {
+    const CommandBufferInterface::RowState state = buffer.render_row(row, y, STRIDE, y > 0, epd);
+    if (state == CommandBufferInterface::BLANK_ROW)
+      memset(row, 0xff, STRIDE);
+    // a repeated row leaves the row above in the buffer
+    memcpy(image + y * STRIDE, row, STRIDE);
+    if (states)
+      ++states[state];
+  }
+}
+
+// rendered a byte at a time
+static void bytes(CommandBufferInterface& buffer, const Display& epd, uint8_t* const image)
+{
+  buffer.prepare(epd);
+  for (int16_t y = 0; y < epd.height; ++y)
+    for (int16_t b = 0; b < STRIDE; ++b)
+      image[y * STRIDE + b] = buffer.render(b * 8, y, epd);
+}
+
+template <typename TBuffer>
+static void dense_scene(TBuffer& buffer)
+{
+  buffer.push(BufferCommand(noise, WIDTH, false));
+  buffer.push(RectCommand(10, 10, 40, 30, true));
+  buffer.push(RectCommand(60, 20, 20, 50, false));
+  buffer.push(LineCommand(5, 100, 120, 100));
+  buffer.push(LineCommand(70, 5, 70, 200));
+  buffer.push(CircleCommand(80, 150, 30, true));
+  buffer.push(CircleCommand(80, 150, 40, false));
+  buffer.push(PixelCommand(3, 3));
+  buffer.push(TextCommand(20, 220, "Hello, world", font5x7, 2));
+  buffer.push(RectCommand(0, 250, 152, 20, true));
+}
+
+// leaves rows blank and repeats others, so rows are rendered all three ways, moved by (dx, dy)
+template <typename TBuffer>
+static void sparse_scene(TBuffer& buffer, const int16_t dx = 0, const int16_t dy = 0)
+{
+  static TextLine centred[4], right[8], left[3];
+  buffer.push(RectCommand(10 + dx, 10 + dy, 40, 30, true));
+  buffer.push(RectCommand(60 + dx, 20 + dy, 20, 50, false));
+  buffer.push(LineCommand(5 + dx, 100 + dy, 120 + dx, 100 + dy));
+  buffer.push(LineCommand(70 + dx, 5 + dy, 70 + dx, 200 + dy));
+  buffer.push(CircleCommand(80 + dx, 150 + dy, 30, true));
+  buffer.push(TextCommand(20 + dx, 220 + dy, "Hello, world", font5x7, 2));
+  buffer.push(TextCommand(3 + dx, 30 + dy, "12:34.5%", numerals16));
+  buffer.push(TextCommand(-5 + dx, 280 + dy, "-67+890", numerals16));
+  buffer.push(TextCommand(40 + dx, 60 + dy, "21.5\xc2\xb0" "C \xff\xc2 9\xe2\x82", numerals16));
+  buffer.push(StrokeTextCommand(5 + dx, 200 + dy, "Stroke 12:34", stroke, 20, 2, 0));
+  buffer.push(StrokeTextCommand(100 + dx, 150 + dy, "UPSIDE?", stroke, 9, 3, 190));
+  buffer.push(StrokeTextCommand(-10 + dx, 120 + dy, "CLIP_ME", stroke, 40, 4, -75));
+  buffer.push(RectCommand(0 + dx, 180 + dy, 100, 40, true, Style(DRAW_SET, PATTERN_GRAY25)));
+  buffer.push(RectCommand(10 + dx, 215 + dy, 120, 20, true, Style(DRAW_INVERT)));
+  buffer.push(RectCommand(3 + dx, 3 + dy, 140, 290, false, Style(DRAW_XOR, PATTERN_DIAGONAL)));
+  buffer.push(CircleCommand(90 + dx, 200 + dy, 30, true, Style(DRAW_XOR, PATTERN_CROSSHATCH)));
+  buffer.push(LineCommand(75 + dx, 0 + dy, 75 + dx, 295 + dy, Style(DRAW_XOR, PATTERN_HORIZONTAL)));
+  buffer.push(PixelCommand(75 + dx, 100 + dy, Style(DRAW_INVERT)));
+  buffer.push(ArcCommand(76 + dx, 100 + dy, 30, 45, 210, -30, Style(DRAW_SET, PATTERN_GRAY75)));
+  buffer.push(ArcCommand(20 + dx, 270 + dy, 0, 40, 100, 350));
+  buffer.push(PolygonCommand(76 + dx, 150 + dy, STAR, true));
+  buffer.push(PolygonCommand(100 + dx, 30 + dy, BOW, false, Style(DRAW_INVERT)));
+  buffer.push(TriangleCommand(3 + dx, 290 + dy, 140 + dx, 250 + dy, 70 + dx, 299 + dy));
+  buffer.push(TextBlockCommand(10 + dx, 100 + dy, 70, 60, "12 34 5678 90\n1\n  23 4567890123456 7", numerals16, centred, ALIGN_CENTER, 2));
+  buffer.push(TextBlockCommand(-7 + dx, 150 + dy, 50, 200, "1 2 3 4 5 6 7 8 9 0 11 22 333 4444 55555", numerals16, right, ALIGN_RIGHT, 5));
+  buffer.push(TextBlockCommand(60 + dx, 10 + dy, 90, 80, "\xc2\xb0" "C 12.5   \n\n-3 F", numerals16, left, ALIGN_LEFT));
+}
+
+// render_row, and the chunks it renders, and render against process
+template <typename TBuffer>
+static void check_rows(const char* const kind)
+{
+  static uint8_t expected[STRIDE * HEIGHT], got[STRIDE * HEIGHT];
+  int wrong = 0;
+  int states[3] = {0, 0, 0};
+  for (uint8_t o = 0; o < 4; ++o)
+  {
+    EPDLite epd(WIDTH, HEIGHT);
+    epd.setOrientation(o);
+
+    TBuffer dense;
+    dense_scene(dense);
+    reference(dense, epd, expected);
+    rows(dense, epd, got);
+    wrong += differences(expected, got, sizeof(got));
+    bytes(dense, epd, got);
+    wrong += differences(expected, got, sizeof(got));
+
+    TBuffer sparse;
+    sparse_scene(sparse);
+    reference(sparse, epd, expected);
+    rows(sparse, epd, got, states);
+    wrong += differences(expected, got, sizeof(got));
+    bytes(sparse, epd, got);
+    wrong += differences(expected, got, sizeof(got));
+  }
+
+  char name[64];
+  snprintf(name, sizeof(name), "rows, %s", kind);
+  report(name, wrong);
+  snprintf(name, sizeof(name), "blank, repeated and drawn rows, %s", kind);
+  report(name, !states[CommandBufferInterface::BLANK_ROW] + !states[CommandBufferInterface::REPEATED_ROW] + !states[CommandBufferInterface::DRAWN_ROW]);
+}
+
+// the same shapes drawn on a canvas and pushed as commands
+static void page_scene(Canvas& canvas)
+{
+  canvas.rect(10, 10, 40, 30, true);
+  canvas.rect(60, 20, 20, 50, false);
+  canvas.rect(-5, 290, 30, 20, true);
+  canvas.line(5, 100, 120, 100);
+  canvas.line(70, 5, 70, 200);
+  canvas.circle(80, 150, 30, true);
+  canvas.circle(80, 150, 40, false);
+  canvas.circle(140, 5, 20, false);
+  canvas.pixel(3, 3);
+  canvas.pixel(151, 295);
+  canvas.text(20, 220, "Hello, world", font5x7, 2);
+  canvas.text(30, 60, "gjpqy", font5x7, 3);
+  canvas.text(-4, 260, "Clipped", font5x7);
+  canvas.text(3, 30, "12:34.5%", numerals16);
+  canvas.text(90, 280, "-67+890", numerals16);
+}
+
+template <typename TBuffer>
+static void page_scene(TBuffer& buffer)
+{
+  buffer.push(RectCommand(10, 10, 40, 30, true));
+  buffer.push(RectCommand(60, 20, 20, 50, false));
+  buffer.push(RectCommand(-5, 290, 30, 20, true));
+  buffer.push(LineCommand(5, 100, 120, 100));
+  buffer.push(LineCommand(70, 5, 70, 200));
+  buffer.push(CircleCommand(80, 150, 30, true));
+  buffer.push(CircleCommand(80, 150, 40, false));
+  buffer.push(CircleCommand(140, 5, 20, false));
+  buffer.push(PixelCommand(3, 3));
+  buffer.push(PixelCommand(151, 295));
+  buffer.push(TextCommand(20, 220, "Hello, world", font5x7, 2));
+  buffer.push(TextCommand(30, 60, "gjpqy", font5x7, 3));
+  buffer.push(TextCommand(-4, 260, "Clipped", font5x7, 1));
+  buffer.push(TextCommand(3, 30, "12:34.5%", numerals16));
+  buffer.push(TextCommand(90, 280, "-67+890", numerals16));
+}
+
+// page mode, a strip of rows at a time onto a canvas, against the commands rendered a row at a time
+static void check_pages()
+{
+  static uint8_t expected[STRIDE * HEIGHT], got[STRIDE * HEIGHT];
+  EPDLite epd(WIDTH, HEIGHT);
+  PlainBuffer buffer;
+  page_scene(buffer);
+  rows(buffer, epd, expected);
+
+  int wrong = 0;
+  static const int16_t STRIPS[] = {1, 7, 8, 13, 64, HEIGHT};
+  for (const int16_t strip : STRIPS)
+  {
+    memset(got, 0xaa, sizeof(got));
+    for (int16_t top = 0; top < HEIGHT; top += strip)
+    {
+      // the last strip is cut short at the bottom of the display
+      Canvas canvas(got + top * STRIDE, WIDTH, top, top + strip > HEIGHT ? HEIGHT - top : strip);
+      canvas.clear();
+      page_scene(canvas);
+    }
+    wrong += differences(expected, got, sizeof(got));
+  }
+  report("page mode against commands", wrong);
+}
+
+// fill_span, blit_span and copy_span a lane at a time against a byte at a time
+static void check_lanes()
+{
+  static const int16_t LENGTH = 512;
+  uint8_t original[LENGTH / 8], src[LENGTH / 8];
+  // rows at every alignment, with a guard byte either side
+  uint8_t a[3][LENGTH / 8 + 16];
+
+  int wrong = 0;
+  srand(7);
+  for (int mode = DRAW_SET; mode <= DRAW_INVERT; ++mode)
+    for (size_t p = 0; p < sizeof(PATTERNS) / sizeof(PATTERNS[0]); ++p)
+      for (int trial = 0; trial < 20000; ++trial)
+      {
+        const int16_t width = 8 + rand() % (LENGTH - 8);
+        const int offset = 1 + rand() % 8;
+        for (uint8_t& v : original)
+          v = rand();
+        for (uint8_t& v : src)
+          v = rand();
+
+        int16_t x0 = rand() % width, x1 = rand() % width;
+        if (x0 > x1)
+        {
+          const int16_t swap = x0;
+          x0 = x1;
+          x1 = swap;
+        }
+        const int16_t x = rand() % (width + 80) - 60;
+        const int16_t w = 1 + rand() % 300;
+        const int16_t y = rand() % 16;
+        const bool progmem = rand() & 1;
+        const Style style(static_cast<DrawMode>(mode), PATTERNS[p]);
+
+        uint8_t* row[3];
+        for (int l = 0; l < 3; ++l)
+        {
+          memset(a[l], 0xa5, sizeof(a[l]));
+          row[l] = a[l] + offset;
+          memcpy(row[l], original, (width + 7) / 8);
+        }
+
+        switch (trial % 3)
+        {
+          case 0:
+            fill_span<uint8_t>(row[0], x0, x1, y, style);
+            fill_span<uint32_t>(row[1], x0, x1, y, style);
+            fill_span<uint64_t>(row[2], x0, x1, y, style);
+            break;
+          case 1:
+            blit_span<uint8_t>(row[0], x0, x1, x, src, w, progmem);
+            blit_span<uint32_t>(row[1], x0, x1, x, src, w, progmem);
+            blit_span<uint64_t>(row[2], x0, x1, x, src, w, progmem);
+            break;
+          default:
+            for (int16_t k = x0; k <= x1; ++k)
+            {
+              const uint8_t mask = 0x80 >> (k & 7);
+              row[0][k >> 3] = static_cast<uint8_t>((row[0][k >> 3] & ~mask) | (src[k >> 3] & mask));
+            }
+            copy_span(row[1], x0, x1, src, progmem);
+            copy_span(row[2], x0, x1, src, progmem);
+            break;
+        }
+        wrong += memcmp(a[0], a[1], sizeof(a[0])) != 0;
+        wrong += memcmp(a[0], a[2], sizeof(a[0])) != 0;
+      }
+  report("spans, every lane and draw mode", wrong);
+}
+
+// both planes evaluated a pixel at a time, a black command paints a pixel where it comes out the same over white and
+// over black, and takes the red from beneath it
+static void reference_colours(CommandBufferInterface& buffer, const Colour* const colours, const Display& epd, uint8_t* const black, uint8_t* const red)
+{
+  for (int16_t y = 0; y < epd.height; ++y)
+    for (int16_t b = 0; b < STRIDE; ++b)
+    {
+      uint8_t v = 0xff, r = 0xff;
+      for (size_t i = 0; i < buffer.size(); ++i)
+        for (int16_t k = 0; k < 8; ++k)
+        {
+          const int16_t x = b * 8 + k;
+          if (colours[i] == COLOUR_RED)
+          {
+            r = buffer.process(i, r, x, y, epd);
+            continue;
+          }
+          if (!((buffer.process(i, 0xff, x, y, epd) ^ buffer.process(i, 0x00, x, y, epd)) & (0x80 >> k)))
+            r |= 0x80 >> k;
+          v = buffer.process(i, v, x, y, epd);
+        }
+      black[y * STRIDE + b] = v;
+      red[y * STRIDE + b] = r;
+    }
+}
+
+// both planes rendered a row at a time
+static void colour_rows(CommandBufferInterface& buffer, const Display& epd, uint8_t* const black, uint8_t* const red)
+{
+  buffer.prepare(epd);
+  uint8_t row[STRIDE], r[STRIDE];
+  for (int16_t y = 0; y < epd.height; ++y)
+  {
+    if (buffer.render_row(row, r, y, STRIDE, y > 0, epd) == CommandBufferInterface::BLANK_ROW)
+    {
+      memset(row, 0xff, STRIDE);
+      memset(r, 0xff, STRIDE);
+    }
+    memcpy(black + y * STRIDE, row, STRIDE);
+    memcpy(red + y * STRIDE, r, STRIDE);
+  }
+}
+
+// render_row with a red plane, against both planes a pixel at a time
+template <typename TBuffer>
+static void check_colours(const char* const kind)
+{
+  static uint8_t black[STRIDE * HEIGHT], red[STRIDE * HEIGHT], expected_black[STRIDE * HEIGHT], expected_red[STRIDE * HEIGHT];
+  EPDLite epd(WIDTH, HEIGHT);
+
+  // red under black and black under red, with pixels of each overlap against what they must be
+  int wrong = 0;
+  {
+    static const Colour COLOURS[] = {COLOUR_RED, COLOUR_BLACK, COLOUR_BLACK, COLOUR_RED, COLOUR_BLACK, COLOUR_RED, COLOUR_BLACK, COLOUR_BLACK};
+    TBuffer buffer;
+    buffer.push(RectCommand(10, 10, 60, 40, true), COLOUR_RED);
+    buffer.push(RectCommand(40, 30, 60, 40, true));
+    buffer.push(CircleCommand(110, 150, 30, true));
+    buffer.push(RectCommand(100, 140, 40, 60, true), COLOUR_RED);
+    buffer.push(TextCommand(12, 14, "Hello", font5x7, 2));
+    buffer.push(RectCommand(20, 100, 40, 40, true), COLOUR_RED);
+    buffer.push(RectCommand(30, 110, 40, 10, true, Style(DRAW_XOR)));
+    buffer.push(RectCommand(30, 125, 40, 10, true, Style(DRAW_CLEAR)));
+    colour_rows(buffer, epd, black, red);
+    reference_colours(buffer, COLOURS, epd, expected_black, expected_red);
+    wrong += differences(expected_black, black, sizeof(black)) + differences(expected_red, red, sizeof(red));
+
+    static const struct
+    {
+      int16_t x, y;
+      bool black, red;
+    } PIXELS[] = {
+      {20, 40, false, true},   // red alone
+      {50, 40, true, false},   // black set over red
+      {80, 60, true, false},   // black alone
+      {110, 150, true, true},  // red over black, which stays on its plane
+      {135, 195, false, true}, // red alone
+      {35, 115, true, true},   // XOR over red leaves the red
+      {65, 115, true, false},  // XOR alone
+      {35, 130, false, false}, // clear over red leaves white
+    };
+    for (const auto& p : PIXELS)
+      wrong += pixel(black, p.x, p.y) != p.black || pixel(red, p.x, p.y) != p.red;
+  }
+  char name[64];
+  snprintf(name, sizeof(name), "colours overlapping, %s", kind);
+  report(name, wrong);
+
+  // patterned and XOR shapes of either colour over the other, at every orientation
+  wrong = 0;
+  static const Colour COLOURS[] = {COLOUR_RED, COLOUR_BLACK, COLOUR_BLACK, COLOUR_RED, COLOUR_BLACK, COLOUR_BLACK};
+  for (uint8_t o = 0; o < 4; ++o)
+    for (int mode = DRAW_SET; mode <= DRAW_INVERT; ++mode)
+      for (size_t p = 0; p < sizeof(PATTERNS) / sizeof(PATTERNS[0]); ++p)
+      {
+        epd.setOrientation(o);
+        const Style style(static_cast<DrawMode>(mode), PATTERNS[p]);
+        TBuffer buffer;
+        buffer.push(RectCommand(10, 10, 100, 100, true), COLOUR_RED);
+        buffer.push(CircleCommand(60, 60, 40, true, style));
+        buffer.push(RectCommand(0, 80, 152, 60, true, Style(DRAW_SET, PATTERN_GRAY50)));
+        buffer.push(CircleCommand(70, 120, 35, true, style), COLOUR_RED);
+        buffer.push(TextCommand(5, 50, "12:34", numerals16));
+        buffer.push(LineCommand(0, 0, 151, 295, style));
+        colour_rows(buffer, epd, black, red);
+        reference_colours(buffer, COLOURS, epd, expected_black, expected_red);
+        wrong += differences(expected_black, black, sizeof(black)) + differences(expected_red, red, sizeof(red));
+      }
+  snprintf(name, sizeof(name), "colours, every mode and pattern, %s", kind);
+  report(name, wrong);
+}
+
+// a command drawn alone, a pixel at a time and a row at a time, against a brute force test of every pixel
+template <typename TCommand, typename TInside>
+static int shape(const TCommand& command, const Display& epd, const TInside inside)
+{
+  CommandBuffer<1, CommandBufferInterface::max_size_all()> buffer;
+  buffer.push(command);
+  static uint8_t drawn[STRIDE * HEIGHT];
+  rows(buffer, epd, drawn);
+
+  int wrong = 0;
+  for (int16_t y = 0; y < epd.height; ++y)
+    for (int16_t x = 0; x < epd.width; ++x)
+    {
+      const int expected = inside(x, y);
+      // pixels the test can't decide, such as on the edge of an arc, only need to agree with each other
+      const bool processed = buffer.process(0, 0xff, x, y, epd) != 0xff;
+      wrong += processed != pixel(drawn, x, y);
+      wrong += expected >= 0 && processed != (expected != 0);
+    }
+  return wrong;
+}
+
+static void check_circles()
+{
+  int wrong = 0;
+  srand(11);
+  for (int trial = 0; trial < 80; ++trial)
+  {
+    EPDLite epd(WIDTH, HEIGHT);
+    epd.setOrientation(trial % 4);
+    const int16_t cx = rand() % 200 - 20, cy = rand() % 200 - 20, r = trial < 20 ? trial : rand() % 70;
+    const bool filled = trial & 1;
+    const int32_t r2 = static_cast<int32_t>(r) * r;
+
+    wrong += shape(CircleCommand(cx, cy, r, filled), epd, [&](const int16_t x, const int16_t y) {
+      int16_t lx, ly;
+      logical(x, y, epd, lx, ly);
+      const int32_t d2 = static_cast<int32_t>(lx - cx) * (lx - cx) + static_cast<int32_t>(ly - cy) * (ly - cy);
+      // an outline is the pixels whose distance rounds to the radius
+      return filled ? d2 <= r2 : r ? r2 - r < d2 && d2 <= r2 + r : d2 == 0;
+    });
+  }
+  report("circles, brute force", wrong);
+}
+
+static void check_arcs()
+{
+  int wrong = 0;
+  srand(3);
+  for (int trial = 0; trial < 120; ++trial)
+  {
+    EPDLite epd(WIDTH, HEIGHT);
+    epd.setOrientation(trial % 4);
+    const int16_t cx = rand() % 152, cy = rand() % 296, inner = rand() % 20, outer = inner + rand() % 40;
+    const int16_t start = rand() % 720 - 360, end = start + rand() % 400;
+
+    wrong += shape(ArcCommand(cx, cy, inner, outer, start, end), epd, [&](const int16_t x, const int16_t y) {
+      int16_t lx, ly;
+      logical(x, y, epd, lx, ly);
+      const double dx = lx - cx, dy = ly - cy, d2 = dx * dx + dy * dy;
+      if (d2 > outer * outer || d2 < inner * inner)
+        return 0;
+      if (end - start >= 360 || d2 == 0)
+        return 1;
+
+      // anticlockwise from the start, with y down the display
+      const double sweep = (end - start) % 360;
+      const double angle = fmod(fmod(atan2(-dy, dx) * 180 / PI - start, 360) + 360, 360);
+      // within a pixel of either edge of the wedge either answer will do
+      const double edge = fmin(fmin(angle, 360 - angle), fabs(angle - sweep)) * PI / 180 * sqrt(d2);
+      if (edge < 1)
+        return -1;
+      return angle <= sweep ? 1 : 0;
+    });
+  }
+  report("arcs, brute force", wrong);
+}
+
+static void check_polygons()
+{
+  int wrong = 0;
+  srand(5);
+  Vertex vertices[POLYGON_MAX_VERTICES];
+  for (int trial = 0; trial < 160; ++trial)
+  {
+    EPDLite epd(WIDTH, HEIGHT);
+    epd.setOrientation(trial % 4);
+    const uint8_t count = 3 + rand() % (POLYGON_MAX_VERTICES - 2);
+    const int16_t ox = rand() % 152, oy = rand() % 296;
+    for (uint8_t i = 0; i < count; ++i)
+      vertices[i] = {static_cast<int16_t>(rand() % 160 - 80), static_cast<int16_t>(rand() % 160 - 80)};
+
+    // even-odd, with each edge crossing the rows from the row of its upper end to the row before its lower end
+    auto inside = [&](const int16_t x, const int16_t y) {
+      bool odd = false;
+      Vertex a = physical(vertices[count - 1].x + ox, vertices[count - 1].y + oy, epd);
+      for (uint8_t i = 0; i < count; ++i)
+      {
+        const Vertex b = physical(vertices[i].x + ox, vertices[i].y + oy, epd);
+        if ((a.y <= y) != (b.y <= y))
+        {
+          const Vertex& top = a.y < b.y ? a : b;
+          const Vertex& bottom = a.y < b.y ? b : a;
+          odd ^= static_cast<int32_t>(x - top.x) * (bottom.y - top.y) >= static_cast<int32_t>(y - top.y) * (bottom.x - top.x);
+        }
+        a = b;
+      }
+      return odd ? 1 : 0;
+    };
+
+    if (count == 3 && trial % 2)
+      wrong += shape(TriangleCommand(vertices[0].x + ox, vertices[0].y + oy, vertices[1].x + ox, vertices[1].y + oy, vertices[2].x + ox, vertices[2].y + oy), epd, inside);
+    else
+      wrong += shape(PolygonCommand(ox, oy, vertices, count, false), epd, inside);
+  }
+  report("polygons, brute force", wrong);
+}
+
+// commands pushed in translations, and clipped, against the same commands pushed where they are drawn
+static void check_stacks()
+{
+  static uint8_t expected[STRIDE * HEIGHT], got[STRIDE * HEIGHT], outside[STRIDE * HEIGHT];
+  int moved = 0, clipped = 0;
+  for (uint8_t o = 0; o < 4; ++o)
+  {
+    EPDLite epd(WIDTH, HEIGHT);
+    epd.setOrientation(o);
+
+    BoundsBuffer scene;
+    sparse_scene(scene);
+    rows(scene, epd, expected);
+
+    PlainBuffer plain;
+    plain.push_translate(7, -3);
+    plain.push_translate(-2, 12);
+    sparse_scene(plain, -5, -9);
+    plain.pop_translate();
+    plain.pop_translate();
+    rows(plain, epd, got);
+    moved += differences(expected, got, sizeof(got));
+
+    // a translation moves the clips pushed within it too
+    BoundsBuffer clips;
+    clips.push_translate(3, 5);
+    clips.push_clip(10, 15, 93, 200);
+    clips.push_translate(-3, -5);
+    clips.push_clip(1, 37, 130, 101);
+    sparse_scene(clips);
+    clips.pop_clip();
+    clips.pop_translate();
+    clips.pop_clip();
+    clips.pop_translate();
+    clips.push(RectCommand(0, 280, 20, 10, true));
+    rows(clips, epd, got);
+
+    BoundsBuffer after;
+    after.push(RectCommand(0, 280, 20, 10, true));
+    rows(after, epd, outside);
+
+    for (int16_t y = 0; y < HEIGHT; ++y)
+      for (int16_t x = 0; x < WIDTH; ++x)
+      {
+        int16_t lx, ly;
+        logical(x, y, epd, lx, ly);
+        const bool within = lx >= 13 && lx < 13 + 93 && ly >= 20 && ly < 20 + 200 && lx >= 1 && lx < 1 + 130 && ly >= 37 && ly < 37 + 101;
+        clipped += pixel(got, x, y) != ((within && pixel(expected, x, y)) || pixel(outside, x, y));
+      }
+  }
+  report("translations", moved);
+  report("clips", clipped);
+}
+
+// a fragment of shapes, or the same shapes turned and placed at (x, y) by hand
+template <typename TBuffer>
+static void fragment(TBuffer& buffer, const int16_t x, const int16_t y, const uint8_t turns)
+{
+  static Vertex stars[4][10];
+  for (uint8_t i = 0; i < 10; ++i)
+    stars[turns][i] = turn(STAR[i], turns);
+
+  auto at = [&](const int16_t u, const int16_t v) {
+    const Vertex t = turn({u, v}, turns);
+    return Vertex{static_cast<int16_t>(t.x + x), static_cast<int16_t>(t.y + y)};
+  };
+  auto line = [&](const Vertex a, const Vertex b, const Style& style) {
+    buffer.push(LineCommand(a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.x < b.x ? b.x : a.x, a.y < b.y ? b.y : a.y, style));
+  };
+
+  Vertex v = at(3, 2);
+  buffer.push(PixelCommand(v.x, v.y));
+  line(at(0, 0), at(20, 0), Style());
+  line(at(-3, -9), at(-3, 13), Style(DRAW_INVERT));
+  v = at(10, 10);
+  buffer.push(CircleCommand(v.x, v.y, 6, true, Style(DRAW_XOR)));
+  v = at(-15, 20);
+  buffer.push(CircleCommand(v.x, v.y, 9, false));
+  const Vertex t0 = at(0, 20), t1 = at(25, 30), t2 = at(5, 40);
+  buffer.push(TriangleCommand(t0.x, t0.y, t1.x, t1.y, t2.x, t2.y));
+  v = at(30, -10);
+  buffer.push(PolygonCommand(v.x, v.y, stars[turns], false, Style(DRAW_XOR)));
+  v = at(-20, -30);
+  // turned clockwise, so back along the angles, which run anticlockwise
+  buffer.push(ArcCommand(v.x, v.y, 5, 12, 30 - 90 * turns, 250 - 90 * turns, Style(DRAW_SET, PATTERN_GRAY50)));
+}
+
+// groups placed and turned every way on displays turned every way, sharing fragments, against their shapes drawn directly
+template <typename TBuffer>
+static void check_groups(const char* const kind)
+{
+  static uint8_t expected[STRIDE * HEIGHT], got[STRIDE * HEIGHT];
+  int wrong = 0;
+  for (uint8_t o = 0; o < 4; ++o)
+    for (uint8_t turns = 0; turns < 4; ++turns)
+    {
+      EPDLite epd(WIDTH, HEIGHT);
+      epd.setOrientation(o);
+
+      // groups sharing a fragment turn it the same way
+      Fragment shared, other;
+      fragment(shared, 0, 0, 0);
+      fragment(other, 0, 0, 0);
+
+      TBuffer groups;
+      groups.push(GroupCommand(shared, 60, 100, turns));
+      groups.push(GroupCommand(shared, 20, 30, turns));
+      groups.push_translate(-3, 4);
+      groups.push(GroupCommand(other, 103, 196, (turns + 1) % 4));
+      groups.pop_translate();
+      groups.push(GroupCommand(shared, 140, 280, turns));
+
+      BoundsBuffer direct;
+      fragment(direct, 60, 100, turns);
+      fragment(direct, 20, 30, turns);
+      fragment(direct, 100, 200, (turns + 1) % 4);
+      fragment(direct, 140, 280, turns);
+      rows(direct, epd, expected);
+
+      // twice, so the second render finds the fragments already turned and moved
+      for (int pass = 0; pass < 2; ++pass)
+      {
+        rows(groups, epd, got);
+        wrong += differences(expected, got, sizeof(got));
+      }
+      bytes(groups, epd, got);
+      wrong += differences(expected, got, sizeof(got));
+      groups.prepare(epd);
+      reference(groups, epd, got);
+      wrong += differences(expected, got, sizeof(got));
+    }
+
+  char name[64];
+  snprintf(name, sizeof(name), "group placement, %s", kind);
+  report(name, wrong);
+
+  // text, clips and nested groups in a fragment, a pixel at a time against a row and a byte at a time
+  wrong = 0;
+  for (uint8_t o = 0; o < 4; ++o)
+    for (uint8_t turns = 0; turns < 4; ++turns)
+    {
+      EPDLite epd(WIDTH, HEIGHT);
+      epd.setOrientation(o);
+
+      Fragment inner;
+      inner.push(TextCommand(0, 0, "12:5", numerals16));
+      inner.push(RectCommand(-2, -2, 40, 20, false));
+      BoundsBuffer outer;
+      outer.push(TextCommand(0, 0, "Hi there", font5x7, 2));
+      outer.push(StrokeTextCommand(0, 20, "ROT", stroke, 16, 2, 10));
+      outer.push_clip(0, 0, 30, 60);
+      outer.push(GroupCommand(inner, 5, 40, 1));
+      outer.pop_clip();
+      Fragment text;
+      text.push(TextCommand(0, 0, "Hi there", font5x7, 2));
+      text.push(StrokeTextCommand(0, 20, "ROT", stroke, 16, 2, 10));
+
+      TBuffer groups;
+      groups.push(RectCommand(0, 0, 150, 290, true, Style(DRAW_SET, PATTERN_GRAY50)));
+      groups.push(GroupCommand(outer, 70, 120, turns));
+      groups.push(GroupCommand(text, 10, 250, (turns + 2) % 4));
+      groups.push(GroupCommand(outer, 200, 10, turns));
+
+      groups.prepare(epd);
+      reference(groups, epd, expected);
+      rows(groups, epd, got);
+      wrong += differences(expected, got, sizeof(got));
+      bytes(groups, epd, got);
+      wrong += differences(expected, got, sizeof(got));
+    }
+  snprintf(name, sizeof(name), "nested groups, %s", kind);
+  report(name, wrong);
+
+  // a fragment shared at two turns is turned as the last group prepares it, the others draw nothing
+  wrong = 0;
+  static uint8_t blank[STRIDE * HEIGHT];
+  memset(blank, 0xff, sizeof(blank));
+  for (uint8_t o = 0; o < 4; ++o)
+    for (uint8_t turns = 0; turns < 4; ++turns)
+    {
+      EPDLite epd(WIDTH, HEIGHT);
+      epd.setOrientation(o);
+
+      Fragment shared;
+      fragment(shared, 0, 0, 0);
+      TBuffer groups;
+      groups.push(GroupCommand(shared, 60, 100, turns));
+      groups.push(GroupCommand(shared, 90, 200, (turns + 1) % 4));
+
+      BoundsBuffer direct;
+      fragment(direct, 90, 200, (turns + 1) % 4);
+      rows(direct, epd, expected);
+
+      rows(groups, epd, got);
+      wrong += differences(expected, got, sizeof(got));
+      bytes(groups, epd, got);
+      wrong += differences(expected, got, sizeof(got));
+      groups.prepare(epd);
+      reference(groups, epd, got);
+      wrong += differences(expected, got, sizeof(got));
+
+      // prepared on its own, the fragment is turned for neither group
+      groups.prepare(epd);
+      shared.prepare(epd);
+      reference(groups, epd, got);
+      wrong += differences(blank, got, sizeof(got));
+    }
+  snprintf(name, sizeof(name), "fragment shared at two turns, %s", kind);
+  report(name, wrong);
+}
+
+// an image of noise, rows repeated, repeating patterns and runs, so back references cross from row to row
+// bands rendered by helper threads and handed to the sending thread, against a row at a time
+static void check_bands()
+{
+  static const int16_t MOST_ROWS = 40;
+  static const int16_t ROWS[] = {1, 3, 8, 13, MOST_ROWS};
+  static const uint8_t SLOTS[] = {2, 3, BAND_SLOTS};
+  static uint8_t expected[STRIDE * HEIGHT], got[STRIDE * HEIGHT];
+  static uint8_t ring[BAND_SLOTS * MOST_ROWS * STRIDE];
+
+  // the helpers are started once and handed each pass, as the other core is on a board
+  static const int HELPERS = 3;
+  std::atomic<BandRenderer*> pass(nullptr);
+  std::atomic<unsigned> passes(0);
+  std::atomic<int> finished(0);
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> helpers;
+  for (int i = 0; i < HELPERS; ++i)
+    helpers.emplace_back([&]() {
+      unsigned seen = 0;
+      while (!stop.load(std::memory_order_acquire))
+      {
+        const unsigned n = passes.load(std::memory_order_acquire);
+        if (n == seen)
+        {
+          std::this_thread::yield();
+          continue;
+        }
+        seen = n;
+        pass.load(std::memory_order_acquire)->help();
+        finished.fetch_add(1, std::memory_order_release);
+      }
+    });
+
+  int wrong = 0;
+  for (uint8_t o = 0; o < 4; ++o)
+  {
+    EPDLite epd(WIDTH, HEIGHT);
+    epd.setOrientation(o);
+
+    PlainBuffer dense, sparse;
+    dense_scene(dense);
+    sparse_scene(sparse);
+    for (CommandBufferInterface* const buffer : {static_cast<CommandBufferInterface*>(&dense), static_cast<CommandBufferInterface*>(&sparse)})
+    {
+      rows(*buffer, epd, expected);
+      for (const int16_t r : ROWS)
+        for (const uint8_t slots : SLOTS)
+        {
+          memset(got, 0, sizeof(got));
+          BandRenderer bands(*buffer, epd, ring, r, slots);
+          finished.store(0, std::memory_order_relaxed);
+          pass.store(&bands, std::memory_order_relaxed);
+          passes.fetch_add(1, std::memory_order_release);
+
+          // the bands must arrive in order, each straight after the one before
+          int16_t next = 0, y, count;
+          for (const uint8_t* data = bands.next(y, count); data; data = bands.next(y, count))
+          {
+            wrong += y != next || count != (y + r > HEIGHT ? HEIGHT - y : r);
+            memcpy(got + y * STRIDE, data, static_cast<size_t>(count) * STRIDE);
+            next = y + count;
+            bands.release();
+          }
+          wrong += next != HEIGHT;
+
+          // the helpers use the bands until they finish
+          while (finished.load(std::memory_order_acquire) < HELPERS)
+            std::this_thread::yield();
+          wrong += differences(expected, got, sizeof(got));
+        }
+    }
+  }
+
+  stop.store(true, std::memory_order_release);
+  for (std::thread& helper : helpers)
+    helper.join();
+  report("bands handed between threads", wrong);
+}
+
+static std::vector<uint8_t> test_image(const size_t stride, const size_t height)
+{
+  std::vector<uint8_t> image(stride * height);
+  for (size_t i = 0; i < image.size(); ++i)
+  {
+    const size_t y = i / stride;
+    switch (y * 5 / height)
+    {
+      case 0: image[i] = rand(); break;
+      case 1: image[i] = y % 3 ? image[i - stride] : rand(); break;
+      case 2: image[i] = "\x12\x34\x56\x78\x9a\xbc\xde"[i % 7]; break;
+      case 3: image[i] = i % (stride + 3) < stride / 2 ? 0xff : 0x00; break;
+      default: image[i] = rand() % 4 ? image[i - stride + 1] : rand(); break;
+    }
+  }
+  return image;
+}
+
+// COPY tokens in compressed data which carry on past the end of a row
+static int row_crossing_copies(const std::vector<uint8_t>& data, const size_t stride)
+{
+  int n = 0;
+  size_t at = 0;
+  for (size_t i = 0; i < data.size();)
+  {
+    const uint8_t type = data[i] & 0xc0;
+    const size_t length = (data[i++] & 0x3f) + 1;
+    if (type == compress::COPY)
+    {
+      n += at / stride != (at + length - 1) / stride;
+      ++i;
+    }
+    else if (type == compress::LITERAL)
+      i += length;
+    at += length;
+  }
+  return n;
+}
+
+// compress then ImageDecoder, and CompressedBufferCommand alone and in a group against BufferCommand
+static void check_compressed()
+{
+  int wrong = 0, crossing = 0;
+  srand(9);
+  const size_t strides[] = {1, 3, STRIDE, 255};
+  for (const size_t stride : strides)
+  {
+    const size_t height = stride == 255 ? 20 : 60;
+    const std::vector<uint8_t> image = test_image(stride, height);
+    const std::vector<uint8_t> data = compress::encode(image.data(), stride, height);
+    crossing += row_crossing_copies(data, stride);
+
+    ImageDecoder decoder(data.data(), false);
+    std::vector<uint8_t> row(stride, 0xff);
+    for (size_t y = 0; y < height; ++y)
+    {
+      decoder.next(row.data(), stride);
+      wrong += memcmp(row.data(), &image[y * stride], stride) != 0;
+    }
+  }
+  report("compressed round trip", wrong);
+  report("copies crossing rows", !crossing);
+
+  static uint8_t expected[STRIDE * HEIGHT], got[STRIDE * HEIGHT];
+  const std::vector<uint8_t> image = test_image(STRIDE, HEIGHT);
+  const std::vector<uint8_t> data = compress::encode(image.data(), STRIDE, HEIGHT);
+  const CompressedImage compressed = {data.data(), WIDTH, HEIGHT};
+  uint8_t decoded[STRIDE];
+
+  wrong = 0;
+  EPDLite epd(WIDTH, HEIGHT);
+  PlainBuffer buffer;
+  buffer.push(BufferCommand(image.data(), WIDTH, false));
+  buffer.push(RectCommand(10, 10, 50, 50, false));
+  rows(buffer, epd, expected);
+
+  PlainBuffer alone;
+  alone.push(CompressedBufferCommand(compressed, decoded, false));
+  alone.push(RectCommand(10, 10, 50, 50, false));
+  Fragment inside;
+  inside.push(CompressedBufferCommand(compressed, decoded, false));
+  BoundsBuffer group;
+  group.push(GroupCommand(inside, 0, 0));
+  group.push(RectCommand(10, 10, 50, 50, false));
+  // twice, as each render decodes the image from the start
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    rows(alone, epd, got);
+    wrong += differences(expected, got, sizeof(got));
+    rows(group, epd, got);
+    wrong += differences(expected, got, sizeof(got));
+  }
+  report("compressed buffers, alone and in a group", wrong);
+}
+
+// numbers formatted into the string arena, at the edges of their ranges
+static void check_formats()
+{
+  CommandBuffer<1, CommandBufferInterface::max_size(), 1024> buffer;
+  int wrong = 0;
+  wrong += mismatch(buffer.format_int(0), "0");
+  wrong += mismatch(buffer.format_int(-5), "-5");
+  wrong += mismatch(buffer.format_int(12, "%"), "12%");
+  wrong += mismatch(buffer.format_int(INT32_MAX), "2147483647");
+  wrong += mismatch(buffer.format_int(INT32_MIN), "-2147483648");
+  report("format_int", wrong);
+
+  wrong = 0;
+  wrong += mismatch(buffer.format_fixed(-215, 1), "-21.5");
+  wrong += mismatch(buffer.format_fixed(5, 3, " V"), "0.005 V");
+  wrong += mismatch(buffer.format_fixed(-5, 3), "-0.005");
+  wrong += mismatch(buffer.format_fixed(0, 2), "0.00");
+  wrong += mismatch(buffer.format_fixed(INT32_MAX, 0), "2147483647");
+  wrong += mismatch(buffer.format_fixed(INT32_MIN, 9), "-2.147483648");
+  // past the ninth place the value is rounded, and values which round to 0 lose their sign
+  wrong += mismatch(buffer.format_fixed(1234567891, 12), "0.001234568");
+  wrong += mismatch(buffer.format_fixed(-1234567491, 12), "-0.001234567");
+  wrong += mismatch(buffer.format_fixed(-5, 10), "-0.000000001");
+  wrong += mismatch(buffer.format_fixed(-4, 10), "0.000000000");
+  wrong += mismatch(buffer.format_fixed(INT32_MAX, 18), "0.000000002");
+  wrong += mismatch(buffer.format_fixed(INT32_MIN, 19), "0.000000000");
+  wrong += mismatch(buffer.format_fixed(INT32_MIN, 255), "0.000000000");
+  report("format_fixed", wrong);
+
+  wrong = 0;
+  wrong += mismatch(buffer.format_float(NAN, 2), "nan");
+  wrong += mismatch(buffer.format_float(INFINITY, 1), "ovf");
+  wrong += mismatch(buffer.format_float(-INFINITY, 1), "ovf");
+  wrong += mismatch(buffer.format_float(5e9f, 0), "ovf");
+  wrong += mismatch(buffer.format_float(1e9f, 2), "ovf");
+  wrong += mismatch(buffer.format_float(3e9f, 0), "3000000000");
+  wrong += mismatch(buffer.format_float(-3e9f, 0), "-3000000000");
+  wrong += mismatch(buffer.format_float(1.25f, 1), "1.3");
+  wrong += mismatch(buffer.format_float(-2.5f, 0), "-3");
+  wrong += mismatch(buffer.format_float(21.5f, 1, "\xc2\xb0" "C"), "21.5\xc2\xb0" "C");
+  wrong += mismatch(buffer.format_float(-0.004f, 2), "0.00");
+  wrong += mismatch(buffer.format_float(-0.006f, 2), "-0.01");
+  wrong += mismatch(buffer.format_float(-0.0f, 1), "0.0");
+  wrong += mismatch(buffer.format_float(0.5f, 12), "0.500000000");
+  report("format_float", wrong);
+
+  // a full arena gives empty strings, and the strings already stored are kept
+  CommandBuffer<1, CommandBufferInterface::max_size(), 9> small;
+  wrong = 0;
+  const char* const kept = small.format_fixed(-215, 1);
+  wrong += mismatch(small.format_int(12345), "");
+  wrong += mismatch(small.format_float(1.0f, 0, "%"), "1%");
+  wrong += mismatch(small.format_int(0), "");
+  wrong += mismatch(kept, "-21.5");
+  report("formats into a full arena", wrong);
+}
+
+// a text block laid out into lines, each line checked against the text expected on it and drawn against process
+static int text_block(const char* const text, const int16_t width, const int16_t height, const TextAlign align, const std::vector<const char*>& expected, const bool complete)
+{
+  static uint8_t want[STRIDE * HEIGHT], got[STRIDE * HEIGHT];
+  TextLine lines[4];
+  const TextBlockCommand block(10, 20, width, height, text, numerals16, lines, align, 1);
+
+  int wrong = block.lines() != expected.size() || block.complete() != complete;
+  for (uint8_t i = 0; i < block.lines() && i < expected.size(); ++i)
+  {
+    const std::string line(text + lines[i].start, text + lines[i].end);
+    const int16_t length = numerals16.width(line.c_str());
+    const int16_t offset = align == ALIGN_CENTER ? (width - length) / 2 : align == ALIGN_RIGHT ? width - length : 0;
+    wrong += mismatch(line.c_str(), expected[i]) + (lines[i].offset != offset) + (lines[i].width > length);
+  }
+
+  for (uint8_t o = 0; o < 4; ++o)
+  {
+    EPDLite epd(WIDTH, HEIGHT);
+    epd.setOrientation(o);
+    PlainBuffer buffer;
+    buffer.push(block);
+    reference(buffer, epd, want);
+    rows(buffer, epd, got);
+    wrong += differences(want, got, sizeof(got));
+  }
+  return wrong;
+}
+
+// text blocks wrapping, breaking words, overflowing and empty
+static void check_text_blocks()
+{
+  const int16_t pitch = numerals16.height + 1;
+  const int16_t pair = numerals16.width("12 34");
+  int wrong = 0;
+  wrong += text_block("", 100, 100, ALIGN_LEFT, {}, true);
+  wrong += text_block("   ", 100, 100, ALIGN_CENTER, {""}, true);
+  wrong += text_block("12 34", 100, 100, ALIGN_RIGHT, {"12 34"}, true);
+  report("text blocks, empty and single lines", wrong);
+
+  wrong = 0;
+  wrong += text_block("12 34 5678", pair, 100, ALIGN_LEFT, {"12 34", "5678"}, true);
+  wrong += text_block("12 34   5678  ", pair, 100, ALIGN_RIGHT, {"12 34", "5678"}, true);
+  wrong += text_block("1234567890", numerals16.width("1234"), 100, ALIGN_CENTER, {"1234", "5678", "90"}, true);
+  wrong += text_block("1\n\n2 3", 100, 100, ALIGN_LEFT, {"1", "", "2 3"}, true);
+  wrong += text_block("-1.5\xc2\xb0 -2.5\xc2\xb0", numerals16.width("-1.5\xc2\xb0"), 100, ALIGN_CENTER, {"-1.5\xc2\xb0", "-2.5\xc2\xb0"}, true);
+  report("text blocks, wrapping", wrong);
+
+  wrong = 0;
+  // out of height, then out of lines in the table
+  wrong += text_block("12 34 56 78", pair, 2 * pitch, ALIGN_LEFT, {"12 34", "56 78"}, true);
+  wrong += text_block("12 34 56 78 90", pair, 2 * pitch, ALIGN_LEFT, {"12 34", "56 78"}, false);
+  wrong += text_block("1\n2\n3\n4\n5", 100, 100, ALIGN_LEFT, {"1", "2", "3", "4"}, false);
+  wrong += text_block("12", 100, numerals16.height - 1, ALIGN_LEFT, {}, false);
+  report("text blocks, overflowing", wrong);
+}
+
+// c in UTF-8, returning the number of bytes
+static size_t encode(const uint32_t c, char* const out)
+{
+  if (c < 0x80)
+  {
+    out[0] = c;
+    return 1;
+  }
+  if (c < 0x800)
+  {
+    out[0] = 0xc0 | c >> 6;
+    out[1] = 0x80 | (c & 0x3f);
+    return 2;
+  }
+  if (c < 0x10000)
+  {
+    out[0] = 0xe0 | c >> 12;
+    out[1] = 0x80 | (c >> 6 & 0x3f);
+    out[2] = 0x80 | (c & 0x3f);
+    return 3;
+  }
+  out[0] = 0xf0 | c >> 18;
+  out[1] = 0x80 | (c >> 12 & 0x3f);
+  out[2] = 0x80 | (c >> 6 & 0x3f);
+  out[3] = 0x80 | (c & 0x3f);
+  return 4;
+}
+
+// utf8_next against an encoder, on every character and on text which isn't UTF-8
+static void check_utf8()
+{
+  int wrong = 0;
+  for (uint32_t c = 1; c <= 0x10ffff; ++c)
+  {
+    // surrogates are only in UTF-16
+    if (c >= 0xd800 && c <= 0xdfff)
+      continue;
+    char text[5] = {};
+    const size_t length = encode(c, text);
+    const char* p = text;
+    wrong += utf8_next(p) != (c > 0xffff ? UTF8_REPLACEMENT : c) || p != text + length;
+  }
+  report("utf8_next, every character", wrong);
+
+  static const uint16_t R = UTF8_REPLACEMENT;
+  static const struct
+  {
+    const char* text;
+    uint16_t expected[5];
+  } MALFORMED[] = {
+    {"\xc2\xb0" "C", {0xb0, 'C'}},
+    {"\xe2\x82\xac", {0x20ac}},
+    {"\xef\xbf\xbf", {0xffff}},
+    // overlong
+    {"\xc0\x80", {R, R}},
+    {"\xc1\xbf", {R, R}},
+    {"\xe0\x80\x80", {R, R, R}},
+    {"\xe0\x9f\xbf", {R, R, R}},
+    {"\xf0\x8f\xbf\xbf", {R, R, R, R}},
+    // surrogates
+    {"\xed\xa0\x80", {R, R, R}},
+    {"\xed\xbf\xbf", {R, R, R}},
+    // past U+10FFFF, and bytes which never start a character
+    {"\xf4\x90\x80\x80", {R, R, R, R}},
+    {"\xf5\x80", {R, R}},
+    {"\xff" "A", {R, 'A'}},
+    {"\x80" "A", {R, 'A'}},
+    // cut short, by the terminator or by another character
+    {"Ab\xe2\x82", {'A', 'b', R}},
+    {"\xe2\x82" "A", {R, 'A'}},
+    {"\xf0\x9f\x98", {R}},
+    {"\xc2", {R}},
+    {"\xe2\xc2\xb0", {R, 0xb0}},
+    // outside the basic multilingual plane
+    {"\xf0\x9f\x98\x80!", {R, '!'}},
+  };
+  wrong = 0;
+  for (const auto& m : MALFORMED)
+  {
+    const char* const end = m.text + strlen(m.text);
+    const char* p = m.text;
+    size_t n = 0;
+    while (*p && n < 5)
+      wrong += utf8_next(p) != m.expected[n++];
+    wrong += p != end || (n < 5 && m.expected[n]);
+  }
+  report("utf8_next, malformed and truncated", wrong);
+
+  // every character against a linear search of the font, looked up by its table of characters and as a range
+  PackedFont range = numerals16;
+  range.first = 0x2010;
+  range.codepoints = nullptr;
+  wrong = 0;
+  for (const PackedFont* const font : {&numerals16, static_cast<const PackedFont*>(&range)})
+    for (uint32_t c = 0; c <= 0xffff; ++c)
+    {
+      int16_t index = -1;
+      for (uint16_t i = 0; i < font->count && index < 0; ++i)
+        if ((font->codepoints ? pgm_read_word(&font->codepoints[i]) : font->first + i) == c)
+          index = i;
+
+      Glyph glyph = {0xffff, 0, 0};
+      const bool found = font->glyph(c, glyph);
+      wrong += found != (index >= 0) || (found && glyph.offset != pgm_read_word(&font->glyphs[index].offset));
+    }
+  report("glyph lookup", wrong);
+}
+
+int main()
+{
+  srand(1);
+  for (uint8_t& v : noise)
+    v = rand();
+
+  check_rows<PlainBuffer>("measured lazily");
+  check_rows<BoundsBuffer>("kept bounds");
+  check_pages();
+  check_lanes();
+  check_colours<ColourBuffer>("measured lazily");
+  check_colours<ColourBoundsBuffer>("kept bounds");
+  check_circles();
+  check_arcs();
+  check_polygons();
+  check_stacks();
+  check_groups<PlainBuffer>("measured lazily");
+  check_groups<BoundsBuffer>("kept bounds");
+  check_bands();
+  check_compressed();
+  check_formats();
+  check_utf8();
+  check_text_blocks();
+
+  return failed;
+}
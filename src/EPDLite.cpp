@@ -5,21 +5,44 @@
 
 #include "EPDLite.h"
 
+#include <string.h>
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#elif defined(ARDUINO_ARCH_RP2040)
+#include <hardware/sync.h>
+#include <pico/multicore.h>
+#include <pico/platform.h>
+#endif
+
 EPDLite::EPDLite(const int16_t w, const int16_t h, const pin_t cs, const pin_t dc, const pin_t busy, const pin_t reset)
-  : width(w)
-  , height(h)
+  : Display(w, h)
   , pin_cs(cs)
   , pin_dc(dc)
   , pin_busy(busy)
   , pin_reset(reset)
   , settings(SPISettings(2000000/32, MSBFIRST, SPI_MODE0))
-  , orientation(0)
+  , colour(false)
+  , fast_waveform(nullptr)
+  , fast_length(0)
+  , fast_limit(0)
+  , fast_interval(0)
+  , updates(0)
+  , last_full(0)
+  , fast_loaded(false)
+  , sequence_changed(false)
+  , fast_differential(false)
+  , old_synced(false)
 {
 }
 
 
-void EPDLite::init()
+bool EPDLite::init()
 {
+  if (!RuntimeGeometry(width, height).fits())
+    return false;
+
   pinMode(pin_reset, OUTPUT);
   pinMode(pin_dc, OUTPUT);
   pinMode(pin_cs, OUTPUT);
@@ -38,19 +61,7 @@ void EPDLite::init()
   data(Y_INC | X_INC);
 
   // set the display size
-  command(SET_X_SIZE);
-  // start
-  data(0);
-  // end
-  data((((width - 1) / 8) & 0x1f)); // size in "address units" (bytes), -1 for when exact size
-
-  command(SET_Y_SIZE);
-  // start
-  data(0);
-  data(0);
-  // end
-  data(height & 0xff);
-  data((height & 0x100) >> 8);
+  full_window();
 
   command(DISPLAY_UPDATE_CONTROL);
   data(0x00); // ???
@@ -64,6 +75,7 @@ void EPDLite::init()
   data(0);
 
   block();
+  return true;
 }
 
 void EPDLite::reset()
@@ -78,13 +90,47 @@ void EPDLite::reset()
   // soft reset
   command(SOFT_RESET);
   block();
+
+  // the display is back to its own waveform and update sequence
+  fast_loaded = false;
+  sequence_changed = false;
+  old_synced = false;
 }
 
 void EPDLite::loadLUT(uint8_t* waveform, size_t len)
 {
-  command(0x32);
+  command(WRITE_LUT);
 
   data(waveform, len);
+  fast_loaded = false;
+}
+
+void EPDLite::setFastRefresh(const uint8_t* const waveform, const size_t len, const uint16_t limit, const uint32_t interval, const bool differential)
+{
+  fast_waveform = waveform;
+  fast_length = len;
+  fast_limit = limit;
+  fast_interval = interval;
+  fast_differential = differential;
+  fast_loaded = false;
+
+  // nothing has kept the previous image RAM up to date
+  old_synced = false;
+
+  // start counting from now, as if the screen had just been fully refreshed
+  updates = 0;
+  last_full = millis();
+}
+
+void EPDLite::setFullRefresh()
+{
+  fast_waveform = nullptr;
+  updates = 0;
+}
+
+void EPDLite::fullRefresh(const bool doBlock)
+{
+  update_full(doBlock);
 }
 
 void EPDLite::setOrientation(const uint8_t o)
@@ -96,109 +142,466 @@ void EPDLite::setOrientation(const uint8_t o)
 
 void EPDLite::render(CommandBufferInterface& buffer, const bool doBlock)
 {
-  place(0, 0);
+  render_commands(RuntimeGeometry(width, height), buffer, doBlock);
+}
+
+#ifdef EPDLITE_BANDS
+/**
+ * @brief A pass of bands for the helper on the other core to render
+ */
+struct BandHelper
+{
+  BandRenderer* bands;
+  std::atomic<bool> finished;
+};
 
-  command(WRITE_RAM);
+#if defined(ARDUINO_ARCH_ESP32)
+// the helper task is started with the first pass and waits for the next one between passes
+static TaskHandle_t helper_task = nullptr;
+static std::atomic<BandHelper*> helper_pass(nullptr);
 
-  SPI.beginTransaction(settings);
-  digitalWrite(pin_dc, 1);
-  digitalWrite(pin_cs, 0);
+static void help_bands(void*)
+{
+  for (;;)
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    BandHelper* const helper = helper_pass.load(std::memory_order_acquire);
+    helper->bands->help();
+    helper->finished.store(true, std::memory_order_release);
+  }
+}
+
+static bool start_helper(BandHelper& helper)
+{
+  // the same priority as the render, so neither core waits on a task the other is starving
+  if (!helper_task && xTaskCreatePinnedToCore(help_bands, "bands", 4096, nullptr, uxTaskPriorityGet(nullptr), &helper_task, xPortGetCoreID() ^ 1) != pdPASS)
+  {
+    helper_task = nullptr;
+    return false;
+  }
 
-  for (int16_t y = 0; y < height; ++y)
+  helper_pass.store(&helper, std::memory_order_release);
+  xTaskNotifyGive(helper_task);
+  return true;
+}
+
+static void rest()
+{
+  taskYIELD();
+}
+#else
+// core 1 is launched with the first pass and sleeps until it's woken for the next one between passes
+static bool core1_launched = false;
+static std::atomic<BandHelper*> core1_pass(nullptr);
+
+static void help_bands()
+{
+  for (;;)
   {
-    for (int16_t x = 0; x < width; x += 8)
+    BandHelper* const helper = core1_pass.load(std::memory_order_acquire);
+    if (!helper)
     {
-      uint8_t data = 0xff;
-      for (int16_t xi = 0; xi < 8; ++xi)
-      {
-        for (size_t i = 0; i < buffer.size(); ++i)
-          data = buffer.process(i, data, x + xi, y, *this);
-          // data = buffer.process(i, data, x + xi, orientation >= 2 ? height - 1 - y : y, *this);
-      }
-      SPI.transfer(data);
+      // a wake up sent since the load isn't lost, it ends the next wait straight away
+      __wfe();
+      continue;
     }
+
+    // only the next pass sets it again, once this one has finished
+    core1_pass.store(nullptr, std::memory_order_relaxed);
+    helper->bands->help();
+    helper->finished.store(true, std::memory_order_release);
   }
+}
 
-  digitalWrite(pin_cs, 1);
-  SPI.endTransaction();
+static bool start_helper(BandHelper& helper)
+{
+  if (!core1_launched)
+  {
+    multicore_launch_core1(help_bands);
+    core1_launched = true;
+  }
 
-  command(DISPLAY_UPDATE_SEQUENCE);
+  core1_pass.store(&helper, std::memory_order_release);
+  __sev();
+  return true;
+}
 
-  if (doBlock)
-    block();
+static void rest()
+{
+  tight_loop_contents();
+}
+#endif
+
+void EPDLite::render(CommandBufferInterface& buffer, uint8_t* const ring, const int16_t rows, const uint8_t slots, const bool doBlock)
+{
+  // both planes are rendered together a row at a time
+  if (colour || !RuntimeGeometry(width, height).fits())
+  {
+    render(buffer, doBlock);
+    return;
+  }
+
+  const int16_t stride = (width + 7) / 8;
+
+  send(static_cast<size_t>(stride) * height, [&](const uint8_t ram) {
+    BandRenderer bands(buffer, *this, ring, rows, slots);
+    BandHelper helper;
+    helper.bands = &bands;
+    helper.finished = false;
+    const bool helped = bands.concurrent() && start_helper(helper);
+
+    begin_write(0, ram);
+
+    int16_t y, count;
+    for (const uint8_t* data = bands.next(y, count); data; data = bands.next(y, count))
+    {
+      write(data, static_cast<size_t>(stride) * count);
+      bands.release();
+    }
+
+    end_write();
+
+    // the helper uses the bands until it finishes
+    while (helped && !helper.finished.load(std::memory_order_acquire))
+      rest();
+  }, doBlock);
 }
+#endif
 
 void EPDLite::render(const uint8_t* const buffer, const bool doBlock)
 {
-  place(0, 0);
+  render_buffer<false>(RuntimeGeometry(width, height), buffer, doBlock);
+}
 
-  command(WRITE_RAM);
+void EPDLite::render_P(const uint8_t* const buffer, const bool doBlock)
+{
+  render_buffer<true>(RuntimeGeometry(width, height), buffer, doBlock);
+}
 
-  SPI.beginTransaction(settings);
-  digitalWrite(pin_dc, 1);
-  digitalWrite(pin_cs, 0);
+bool EPDLite::render(const uint8_t* const buffer, const int16_t x, const int16_t y, const int16_t w, const int16_t h, const int16_t stride, const uint8_t format, const bool doBlock)
+{
+  return render_window(buffer, x, y, w, h, stride, format, false, doBlock);
+}
+
+bool EPDLite::render_P(const uint8_t* const buffer, const int16_t x, const int16_t y, const int16_t w, const int16_t h, const int16_t stride, const uint8_t format, const bool doBlock)
+{
+  return render_window(buffer, x, y, w, h, stride, format, true, doBlock);
+}
+
+bool EPDLite::render(const CompressedImage& image, const bool doBlock)
+{
+  return render_compressed(RuntimeGeometry(width, height), image, false, doBlock);
+}
+
+bool EPDLite::render_P(const CompressedImage& image, const bool doBlock)
+{
+  return render_compressed(RuntimeGeometry(width, height), image, true, doBlock);
+}
+
+bool EPDLite::render(Stream& stream, const bool pbm, const bool doBlock)
+{
+  return render_stream(RuntimeGeometry(width, height), stream, pbm, doBlock);
+}
 
-  for (int16_t y = 0; y < height; ++y)
+void EPDLite::render(uint8_t* const strip, const int16_t rows, const DrawCallback draw, void* const context, const bool doBlock)
+{
+  render_strips(RuntimeGeometry(width, height), strip, rows, draw, context, doBlock);
+}
+
+void EPDLite::clear()
+{
+  fill(RuntimeGeometry(width, height), 0xff);
+}
+
+// the next character of a PBM header, a comment running to the end of the line reads as its newline
+static bool read_pbm_char(Stream& stream, char& c)
+{
+  if (stream.readBytes(&c, 1) != 1)
+    return false;
+  if (c == '#')
   {
-    for (int16_t x = 0; x < width; x += 8)
-      SPI.transfer(buffer[y * width / 8 + width / 8]);
+    while (c != '\n')
+    {
+      if (stream.readBytes(&c, 1) != 1)
+        return false;
+    }
   }
+  return true;
+}
 
-  digitalWrite(pin_cs, 1);
-  SPI.endTransaction();
+bool EPDLite::read_pbm_header(Stream& stream, int16_t& w, int16_t& h)
+{
+  char magic[2];
+  if (stream.readBytes(magic, 2) != 2 || magic[0] != 'P' || magic[1] != '4')
+    return false;
 
-  command(DISPLAY_UPDATE_SEQUENCE);
+  // width and height, separated by whitespace and comments, which can also end a number
+  int16_t* const values[] = {&w, &h};
+  for (int16_t* const value : values)
+  {
+    char c;
+    do
+    {
+      if (!read_pbm_char(stream, c))
+        return false;
+    } while (c == ' ' || c == '\t' || c == '\r' || c == '\n');
 
-  if (doBlock)
-    block();
+    if (c < '0' || c > '9')
+      return false;
+
+    int32_t n = 0;
+    while (c >= '0' && c <= '9')
+    {
+      n = n * 10 + (c - '0');
+      if (n > INT16_MAX || !read_pbm_char(stream, c))
+        return false;
+    }
+    *value = n;
+  }
+
+  // a single whitespace character (already consumed) separates the header from the data
+  return w > 0 && h > 0;
 }
 
-void EPDLite::render_P(const uint8_t* const buffer, const bool doBlock)
+bool EPDLite::render_window(const uint8_t* buffer, int16_t x, int16_t y, int16_t w, int16_t h, const int16_t stride, const uint8_t format, const bool progmem, const bool doBlock)
+{
+  if (x % 8 || w <= 0 || h <= 0 || stride <= 0 || !RuntimeGeometry(width, height).fits())
+    return false;
+
+  // skip the parts of the window off the display, before the stride is checked against what's left
+  if (x < 0)
+  {
+    buffer += -x / 8;
+    w += x;
+    x = 0;
+  }
+  if (y < 0)
+  {
+    buffer += static_cast<size_t>(-y) * stride;
+    h += y;
+    y = 0;
+  }
+  w = x + w > width ? width - x : w;
+  h = y + h > height ? height - y : h;
+  if (w <= 0 || h <= 0 || stride < (w + 7) / 8)
+    return false;
+
+  const int16_t bytes = (w + 7) / 8;
+
+  // the red plane of a tri-colour display is blanked within the window alone
+  send(0, [&](const uint8_t ram) {
+    window(x / 8, x / 8 + bytes - 1, y, y + h - 1);
+
+    begin_write(y, ram, x);
+    for (int16_t r = 0; r < h; ++r)
+    {
+      const uint8_t* const row = buffer + static_cast<size_t>(r) * stride;
+      if (format == IMAGE_DEFAULT && !progmem)
+        write(row, bytes);
+      else
+        write_converted(row, bytes, format, progmem);
+    }
+    end_write();
+
+    if (colour)
+    {
+      begin_write(y, WRITE_RAM_RED, x);
+      write_run(0x00, static_cast<size_t>(bytes) * h);
+      end_write();
+    }
+
+    full_window();
+  }, doBlock);
+
+  return true;
+}
+
+/**
+ * @brief Reverses the order of the bits in a byte
+ */
+static uint8_t reverse(uint8_t b)
+{
+  b = (b & 0xf0) >> 4 | (b & 0x0f) << 4;
+  b = (b & 0xcc) >> 2 | (b & 0x33) << 2;
+  return (b & 0xaa) >> 1 | (b & 0x55) << 1;
+}
+
+void EPDLite::write_converted(const uint8_t* const row, const size_t len, const uint8_t format, const bool progmem)
+{
+  // converted a piece at a time, so the row is still sent in blocks without a copy of it
+  uint8_t piece[16];
+  for (size_t i = 0; i < len; i += sizeof(piece))
+  {
+    const size_t n = len - i < sizeof(piece) ? len - i : sizeof(piece);
+    for (size_t j = 0; j < n; ++j)
+    {
+      uint8_t b = progmem ? pgm_read_byte(&row[i + j]) : row[i + j];
+      if (format & IMAGE_LSB_FIRST)
+        b = reverse(b);
+      piece[j] = format & IMAGE_INVERT ? ~b : b;
+    }
+    write(piece, n);
+  }
+}
+
+void EPDLite::window(const int16_t x0, const int16_t x1, const int16_t y0, const int16_t y1)
+{
+  command(SET_X_SIZE);
+  // start
+  data(x0);
+  // end
+  data(x1);
+
+  command(SET_Y_SIZE);
+  // start
+  data(y0 & 0xff);
+  data((y0 & 0x100) >> 8);
+  // end
+  data(y1 & 0xff);
+  data((y1 & 0x100) >> 8);
+}
+
+void EPDLite::full_window()
 {
-  place(0, 0);
+  window(0, ((width - 1) / 8) & 0x1f, 0, height); // size in "address units" (bytes), -1 for when exact size
+}
 
-  command(WRITE_RAM);
+void EPDLite::begin_write(const int16_t y, const uint8_t ram, const int16_t x)
+{
+  place(x, y);
+
+  command(ram);
 
   SPI.beginTransaction(settings);
   digitalWrite(pin_dc, 1);
   digitalWrite(pin_cs, 0);
+}
+
+void EPDLite::end_write()
+{
+  digitalWrite(pin_cs, 1);
+  SPI.endTransaction();
+}
+
+#if !defined(ESP32) && !defined(ESP8266)
+/**
+ * @brief Bytes sent by each block transfer, a row of the widest panel
+ * @details A block transfer overwrites the bytes with those read back, so each block is copied to the stack first.
+ */
+static const size_t BLOCK = MAX_STRIDE;
+#endif
 
-  for (int16_t y = 0; y < height; ++y)
+void EPDLite::write(const uint8_t* const d, const size_t len)
+{
+#if defined(ESP32) || defined(ESP8266)
+  SPI.writeBytes(d, len);
+#else
+  uint8_t block[BLOCK];
+  for (size_t i = 0; i < len; i += BLOCK)
   {
-    for (int16_t x = 0; x < width; x += 8)
-      SPI.transfer(pgm_read_byte(&(buffer[y * width / 8 + width / 8])));
+    const size_t n = len - i < BLOCK ? len - i : BLOCK;
+    memcpy(block, d + i, n);
+    SPI.transfer(block, n);
   }
+#endif
+}
 
-  digitalWrite(pin_cs, 1);
-  SPI.endTransaction();
+void EPDLite::write_run(const uint8_t value, const size_t len)
+{
+#if defined(ESP32) || defined(ESP8266)
+  if (len)
+    SPI.writePattern(&value, 1, len);
+#else
+  uint8_t block[BLOCK];
+  for (size_t i = 0; i < len; i += BLOCK)
+  {
+    const size_t n = len - i < BLOCK ? len - i : BLOCK;
+    memset(block, value, n);
+    SPI.transfer(block, n);
+  }
+#endif
+}
+
+void EPDLite::clear_red(const size_t size)
+{
+  if (!colour || !size)
+    return;
+
+  begin_write(0, WRITE_RAM_RED);
+  write_run(0x00, size);
+  end_write();
+}
+
+bool EPDLite::full_due() const
+{
+  return !fast_waveform
+    || (keep_old() && !old_synced)
+    || (fast_limit && updates >= fast_limit)
+    || (fast_interval && millis() - last_full >= fast_interval);
+}
+
+void EPDLite::update(const bool doBlock)
+{
+  if (full_due())
+  {
+    update_full(doBlock);
+    return;
+  }
+
+  if (!fast_loaded)
+  {
+    load_fast_waveform();
+    command(DISPLAY_UPDATE_CONTROL_2);
+    if (keep_old())
+      data(SEQUENCE_DIFFERENTIAL);
+    else
+      data(SEQUENCE_FAST);
+    sequence_changed = true;
+  }
 
   command(DISPLAY_UPDATE_SEQUENCE);
+  ++updates;
 
   if (doBlock)
     block();
 }
 
-void EPDLite::clear()
+void EPDLite::update_full(const bool doBlock)
 {
-  place(0, 0);
+  // without fast refresh the display's default sequence is left alone
+  if (sequence_changed || fast_waveform)
+  {
+    command(DISPLAY_UPDATE_CONTROL_2);
+    data(SEQUENCE_FULL);
+    sequence_changed = true;
+  }
 
-  command(WRITE_RAM);
+  command(DISPLAY_UPDATE_SEQUENCE);
+
+  // the full sequence reloads the display's own waveform over the fast one
+  fast_loaded = false;
+  updates = 0;
+  last_full = millis();
+
+  if (doBlock)
+    block();
+}
+
+void EPDLite::load_fast_waveform()
+{
+  command(WRITE_LUT);
 
   SPI.beginTransaction(settings);
   digitalWrite(pin_dc, 1);
   digitalWrite(pin_cs, 0);
 
-  for (int16_t y = 0; y < height; ++y)
-  {
-    for (int16_t x = 0; x < width / 8; ++x)
-      SPI.transfer(0xff);
-  }
+  for (size_t i = 0; i < fast_length; ++i)
+    SPI.transfer(pgm_read_byte(&fast_waveform[i]));
 
   digitalWrite(pin_cs, 1);
   SPI.endTransaction();
 
-  command(DISPLAY_UPDATE_SEQUENCE);
-  block();
+  fast_loaded = true;
 }
 
 void EPDLite::block()
@@ -262,8 +665,7 @@ void EPDLite::data(const uint8_t* const d, const size_t len)
   digitalWrite(pin_dc, 1);
   digitalWrite(pin_cs, 0);
 
-  for (size_t i = 0; i < len; ++i)
-    SPI.transfer(d[i]);
+  write(d, len);
 
   digitalWrite(pin_cs, 1);
   SPI.endTransaction();
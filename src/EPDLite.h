@@ -14,162 +14,40 @@
 
 #include <SPI.h>
 
-#include "EPDLite/commands.h"
+#include "EPDLite/bands.h"
+#include "EPDLite/canvas.h"
+#include "EPDLite/commandbuffer.h"
+#include "EPDLite/display.h"
+#include "EPDLite/geometry.h"
+#include "EPDLite/packedfont.h"
+#include "EPDLite/strokefont.h"
+#include "EPDLite/style.h"
 
 
-/**
- * @brief Public interface to the @see CommandBuffer
- * @details Provides a public interface to the CommandBuffer to allow polymorphic use of CommandBuffer with template values
- */
-class CommandBufferInterface
-{
-public:
-  /**
-   * @brief The current number of commands stored in this buffer
-   * @return size
-   */
-  virtual size_t size() const;
-  /**
-   * @brief The maximum number of commands that can be stored in this buffer (i.e., TCommandSize it was created with).
-   * @return capacity
-   */
-  virtual size_t capacity() const;
-
-  /**
-   * @brief Removed a command from the end of the buffer
-   * @details No operation if there is no command to remove
-   */
-  virtual void pop() = 0;
-
-  virtual uint8_t process(const size_t at, const uint8_t input, const int16_t x, const int16_t y, const EPDLite& epd) = 0;
-
-  /**
-   * @brief The maximum amount of memory used for a single command.
-   * @details When constructing an instance of CommandBuffer, this can be used for TCommandSize.
-   */
-  static constexpr size_t max_size() {
-    return max_sizeof<
-      PixelCommand,
-      LineCommand,
-      RectCommand,
-      CircleCommand,
-      TextCommand,
-      BufferCommand
-    >();
-  }
-
-private:
-  template <typename T>
-  static constexpr T static_max(T a, T b)
-  {
-    return a < b ? b : a;
-  }
-
-  template <typename T, typename... Ts>
-  static constexpr T static_max(T a, Ts... bs)
-  {
-    return static_max(a, static_max(bs...));
-  }
-
-  template <typename... Ts>
-  static constexpr size_t max_sizeof()
-  {
-    return static_max(sizeof(Ts)...);
-  }
-};
+using pin_t =  int8_t;
 
 /**
- * @brief A buffer to store commands to render
- * @details The buffer is statically allocated on the stack, commands can be pushed into the buffer to be rendered on the display
- *
- * @tparam TCommandCount The maximum number of commands allowed in this buffer.
- * @tparam TCommandSize The maximum size of a command allowed in this buffer. Suggested to use MAX_COMMAND_SIZE, but smaller values can be used for memory reduction.
+ * @brief How the pixels of an uploaded image are stored, flags combined with |
  */
-template <size_t TCommandCount, size_t TCommandSize = CommandBufferInterface::max_size()>
-class CommandBuffer : public CommandBufferInterface
+enum ImageFormat
 {
-public:
-  CommandBuffer() : CommandBufferInterface(), count(0)
-  {
-  }
-
-  /**
-   * @brief The current number of commands stored in this buffer
-   * @return size
-   */
-  virtual size_t size() const { return count; }
-  /**
-   * @brief The maximum number of commands that can be stored in this buffer (i.e., TCommandSize it was created with).
-   * @return capacity
-   */
-  virtual size_t capacity() const { return TCommandCount; }
-
-  /**
-   * @brief Add a command to the buffer
-   * @details Pushes a command onto the end of the buffer
-   *
-   * @tparam TCommand The type of command to push
-   * @param command
-   */
-  template <typename TCommand>
-  void push(TCommand command)
-  {
-    static_assert(sizeof(TCommand) <= TCommandSize, "Pushed command is bigger. Increase TCommandCount.");
-
-    if (count >= TCommandCount)
-      return; // need to handle this somehow?
-
-    memcpy(&commands[TCommandSize * count], &command, sizeof(TCommand));
-    call_table[count++] = &TCommand::process;
-  }
-
-  /**
-   * @brief Removed a command from the end of the buffer
-   * @details No operation if there is no command to remove
-   */
-  virtual void pop()
-  {
-    if (count > 0)
-      --count;
-  }
-
-  /**
-   * @brief Dispatches the process to the correct command instance.
-   *
-   * @param at The command in the buffer to run
-   * @param input The current 8 pixel screen data
-   * @param x The x position of the pixel data
-   * @param y The y position of the pixel data
-   * @return The modified 8 pixels
-   */
-  virtual uint8_t process(const size_t at, const uint8_t input, const int16_t x, const int16_t y, const EPDLite& epd) override
-  {
-    return (call_table[at])((void*)&commands[at * TCommandSize], input, x, y, epd);
-  }
-
-
-private:
-  uint8_t (*call_table[TCommandCount])(void* command, const uint8_t input, const int16_t x, const int16_t y, const EPDLite& epd);
-
-  uint8_t commands[TCommandCount * TCommandSize];
-  size_t count;
+  IMAGE_DEFAULT = 0,  ///< MSB on the left and 0 for black, as the display stores them
+  IMAGE_INVERT = 1,   ///< 1 for black, as PBM images and many graphics libraries
+  IMAGE_LSB_FIRST = 2 ///< LSB on the left, as XBM images
 };
 
-
-using pin_t =  int8_t;
-
 /**
  * @brief Controls an ePaper Display
  *
  */
-class EPDLite
+class EPDLite : public Display
 {
 public:
   /**
    * @brief Initializes the display.
    *
    * @param w Width of the display in pixels
-   * @param h Height of the dusplay in pixels
+   * @param h Height of the display in pixels
    * @param cs Chip Select pin
    * @param dc Data/Command pin
    * @param busy Busy pin
@@ -179,12 +57,29 @@ public:
 
 
   void setOrientation(const uint8_t o);
-  uint8_t getOrientation() const { return orientation; }
+
+  /**
+   * @brief Sets whether the display has a second colour, red or yellow
+   * @details Tri-colour displays have a second RAM (0x26) for the red plane, which a red bit of 1 shows over the black plane. Command buffers are then rendered to both planes in a single pass, drawing each command in the colour it was pushed with in a buffer with BUFFER_COLOUR, @see CommandBuffer::push. Everything else rendered to the whole screen, and `clear`, leaves the red plane blank. An image rendered to a window blanks the red plane within the window, and the rest of both planes keeps what was last rendered.
+   *
+   * @param colour True for a tri-colour display
+   */
+  void setColour(const bool colour)
+  {
+    this->colour = colour;
+    // the second RAM changes between holding the red plane and the previous image
+    fast_loaded = false;
+    old_synced = false;
+  }
+  bool getColour() const { return colour; }
 
   /**
    * @brief Initializes the display
+   * @details The controller's x address is 5 bits, so panels wider than 256 pixels can't be addressed. They are refused here, and every render to them does nothing rather than show part of each row.
+   *
+   * @return false if the panel is too wide for the controller
    */
-  void init();
+  bool init();
 
   /**
    * @brief Resets the display
@@ -201,14 +96,62 @@ public:
    */
   void loadLUT(uint8_t* waveform, size_t len);
 
+  /**
+   * @brief Updates the display with a fast waveform, with a full refresh every so often
+   * @details Fast updates take a fraction of a second, but leave a little of each screen behind as a ghost. Every so often an update is instead a full refresh, which flashes the screen to clear the ghosting. The waveform is loaded into the display's LUT register before the first fast update after each full refresh, which reloads the display's own waveform.
+   * Waveform data is specific to the display, @see loadLUT
+   *
+   * @param waveform The fast waveform in PROGMEM, must stay valid while fast refresh is in use
+   * @param len The length of the waveform
+   * @param limit The number of fast updates between full refreshes, 0 for no limit
+   * @param interval The milliseconds from a full refresh after which the next update is a full refresh, 0 for no limit. It is checked when the next image is rendered, not by a timer, so a screen left alone keeps its ghosting until something is rendered again
+   * @param differential True for a partial waveform, which changes only the pixels which differ from the previous image. The previous image is kept in the display's second RAM (0x26) by writing each image to it as well, after a fast update and before a full one, so the first update is a full refresh. Each fast update therefore renders the image twice, once before the update and again into the second RAM after it, and blocks until the update is complete even when `doBlock` is false, as the display compares with the second RAM while it updates. Images rendered from a Stream are always a full refresh as they can't be read twice. Ignored for tri-colour displays, whose second RAM is the red plane
+   */
+  void setFastRefresh(const uint8_t* const waveform, const size_t len, const uint16_t limit = 10, const uint32_t interval = 0, const bool differential = false);
+
+  /**
+   * @brief Goes back to a full refresh for every update
+   */
+  void setFullRefresh();
+
+  /**
+   * @brief The number of fast updates since the last full refresh
+   */
+  uint16_t getUpdateCount() const { return updates; }
+
+  /**
+   * @brief Refreshes the screen fully now, clearing any ghosting
+   * @details The screen shows what was last rendered. The count of fast updates starts again.
+   *
+   * @param doBlock Blocks until the refresh is complete, if false call `wait` before sending any commands to the display again.
+   */
+  void fullRefresh(const bool doBlock = true);
+
   /**
    * @brief Render to the display from the command buffer
+   * @details With differential fast refresh the commands are rendered twice for each update, once into each of the display's RAMs, @see setFastRefresh
    *
    * @param buffer Renders the commands listed into the buffer onto a blank screen.
    * @param doBlock Blocks until the render is complete, if false call `wait` before sending any commands to the display again.
    */
   void render(CommandBufferInterface& buffer, const bool doBlock = true);
 
+#ifdef EPDLITE_BANDS
+  /**
+   * @brief Render to the display from the command buffer, rendering on both cores
+   * @details The screen is split into bands of `rows` rows, rendered into a ring of `slots` band buffers by this core and a helper on the other core while the bands already rendered are sent to the display, so a busy screen takes little longer than the bus takes to send it.
+   * On ESP32 the helper is a FreeRTOS task pinned to the other core. On RP2040 it runs on core 1, which must not be used for anything else (no `setup1` or `loop1`). Either is started by the first render and waits for the next one between renders. Buffers which must be rendered a row at a time, such as those with a CompressedBufferCommand, are rendered on this core alone, @see CommandBufferInterface::concurrent
+   * With differential fast refresh every band is rendered twice for each update, as the screen is sent to each of the display's RAMs.
+   *
+   * @param buffer Renders the commands listed into the buffer onto a blank screen.
+   * @param ring The band buffers, at least `slots * rows * ceil(width / 8)` bytes
+   * @param rows The number of rows in a band, 8 to 16 suits most screens
+   * @param slots The number of band buffers, 2 to BAND_SLOTS. With 3 or more, a band slow to render has others to be rendered around it
+   * @param doBlock Blocks until the render is complete, if false call `wait` before sending any commands to the display again.
+   */
+  void render(CommandBufferInterface& buffer, uint8_t* const ring, const int16_t rows, const uint8_t slots = 3, const bool doBlock = true);
+#endif
+
   /**
    * @brief Render to the display the raw data from the buffer
    * @details Rendering using a full memory buffer, similar to other libraries. The buffer must be big enough to hold the entire screen contents.
@@ -227,6 +170,85 @@ public:
    */
   void render_P(const uint8_t* const buffer, const bool doBlock = true);
 
+  /**
+   * @brief Render an image to a window of the display
+   * @details Only the window is written, the rest of the screen keeps what was last rendered. Each row is sent as a block, converted on the fly if the image isn't in the display's format. The image can be a region of a larger image, starting at a byte of it.
+   * The window is whole bytes wide, so the left edge must be a multiple of 8 and all `ceil(w / 8)` bytes of each row are written. Parts of the window off the display are skipped. On a tri-colour display the red plane is blanked within the window alone.
+   * With differential fast refresh a window updates fast only once a whole screen has been rendered since the refresh was set up, as the rest of the previous image RAM must match the screen. Until then each window is a full refresh.
+   *
+   * @param buffer The first byte of the image
+   * @param x The left edge of the window, a multiple of 8
+   * @param y The top edge of the window
+   * @param w The width of the window in pixels
+   * @param h The height of the window in pixels
+   * @param stride The number of bytes from the start of one row of the image to the next, at least `ceil(w / 8)` for the part of the window on the display
+   * @param format How the pixels are stored, @see ImageFormat
+   * @param doBlock Blocks until the render is complete, if false call `wait` before sending any commands to the display again.
+   * @return false if x isn't a multiple of 8, the stride is shorter than a row, the window is off the display or the panel is too wide (@see init), nothing is rendered
+   */
+  bool render(const uint8_t* const buffer, const int16_t x, const int16_t y, const int16_t w, const int16_t h, const int16_t stride, const uint8_t format = IMAGE_DEFAULT, const bool doBlock = true);
+
+  /**
+   * @brief Render an image stored in PROGMEM to a window of the display
+   * @details As `render(const uint8_t* const, const int16_t, const int16_t, const int16_t, const int16_t, const int16_t, const uint8_t, const bool)`, but the image is read from PROGMEM.
+   */
+  bool render_P(const uint8_t* const buffer, const int16_t x, const int16_t y, const int16_t w, const int16_t h, const int16_t stride, const uint8_t format = IMAGE_DEFAULT, const bool doBlock = true);
+
+  /**
+   * @brief Render to the display a compressed image
+   * @details The image is decoded a row at a time, so only a single row is held in memory. Images smaller than the display are padded with white. With differential fast refresh it is decoded twice for each update, @see setFastRefresh
+   *
+   * @param image The image to render, @see CompressedImage
+   * @param doBlock Blocks until the render is complete, if false call `wait` before sending any commands to the display again.
+   * @return false if the image or the panel is too wide (@see init), nothing is rendered
+   */
+  bool render(const CompressedImage& image, const bool doBlock = true);
+
+  /**
+   * @brief Render to the display a compressed image stored in PROGMEM
+   * @details As `render(const CompressedImage&, const bool)`, but the image data is read from PROGMEM.
+   *
+   * @param image The image to render, the data must be in PROGMEM
+   * @param doBlock Blocks until the render is complete, if false call `wait` before sending any commands to the display again.
+   * @return false if the image or the panel is too wide (@see init), nothing is rendered
+   */
+  bool render_P(const CompressedImage& image, const bool doBlock = true);
+
+  /**
+   * @brief Render to the display from a stream
+   * @details Image data is read a row at a time from the stream (e.g., an SD card file, Serial, or a network client) and sent straight to the display, so the image never needs to fit in memory.
+   * Without a header the stream must hold the raw display data, `height * ceil(width / 8)` bytes in the same format as `render(const uint8_t* const)`.
+   * With `pbm` the stream must hold a binary PBM (P4) image, which is cropped or padded with white to the size of the display.
+   * Reads wait for data using the stream's timeout, if the stream runs out the rest of the display is left white.
+   *
+   * @param stream The stream to read from
+   * @param pbm True if the image has a PBM header
+   * @param doBlock Blocks until the render is complete, if false call `wait` before sending any commands to the display again.
+   * @return false if the PBM header was invalid or the panel is too wide (nothing is rendered), or if the stream ran out before the image was complete
+   */
+  bool render(Stream& stream, const bool pbm = false, const bool doBlock = true);
+
+  /**
+   * @brief Called to draw each strip in page mode
+   *
+   * @param canvas The canvas to draw on, covering the rows of the current strip
+   * @param context The context passed to `render`
+   */
+  using DrawCallback = void (*)(Canvas& canvas, void* context);
+
+  /**
+   * @brief Render to the display a strip at a time (page mode)
+   * @details The screen is split into strips of `rows` rows. For each strip the canvas is cleared, `draw` is called to draw onto it, and the strip is sent to the display. `draw` should draw the entire screen every time, anything outside of the strip is clipped.
+   * This trades a strip buffer for arbitrary drawing code, and is much faster than the command buffer for complex screens. With differential fast refresh the screen is drawn twice for each update, so `draw` is called twice for each strip and must draw the same both times.
+   *
+   * @param strip The strip buffer, must be at least `rows * ceil(width / 8)` bytes
+   * @param rows The number of rows in a strip
+   * @param draw Function to draw the screen
+   * @param context Passed to `draw`
+   * @param doBlock Blocks until the render is complete, if false call `wait` before sending any commands to the display again.
+   */
+  void render(uint8_t* const strip, const int16_t rows, const DrawCallback draw, void* const context = nullptr, const bool doBlock = true);
+
   /**
    * @brief Waits until the display's busy line is low
    */
@@ -242,16 +264,188 @@ public:
    */
   void clear();
 
+protected:
+  /**
+   * @brief Renders the command buffer using the loop bounds provided by the geometry
+   *
+   * @tparam TGeometry PanelGeometry or RuntimeGeometry
+   */
+  template <typename TGeometry>
+  void render_commands(const TGeometry& geometry, CommandBufferInterface& buffer, const bool doBlock);
+
+  /**
+   * @brief Renders both planes of a prepared command buffer to a tri-colour display, a row of each at a time
+   *
+   * @tparam TGeometry PanelGeometry or RuntimeGeometry
+   * @param row The black row buffer, `stride` bytes
+   */
+  template <typename TGeometry>
+  void render_colour(const TGeometry& geometry, CommandBufferInterface& buffer, uint8_t* const row, const int16_t stride);
+
+  /**
+   * @brief Renders a full screen buffer using the loop bounds provided by the geometry
+   *
+   * @tparam TProgmem True if the buffer is stored in PROGMEM
+   * @tparam TGeometry PanelGeometry or RuntimeGeometry
+   */
+  template <bool TProgmem, typename TGeometry>
+  void render_buffer(const TGeometry& geometry, const uint8_t* const buffer, const bool doBlock);
+
+  /**
+   * @brief Renders a compressed image using the loop bounds provided by the geometry
+   *
+   * @tparam TGeometry PanelGeometry or RuntimeGeometry
+   */
+  template <typename TGeometry>
+  bool render_compressed(const TGeometry& geometry, const CompressedImage& image, const bool progmem, const bool doBlock);
+
+  /**
+   * @brief Renders from a stream using the loop bounds provided by the geometry
+   *
+   * @tparam TGeometry PanelGeometry or RuntimeGeometry
+   */
+  template <typename TGeometry>
+  bool render_stream(const TGeometry& geometry, Stream& stream, const bool pbm, const bool doBlock);
+
   /**
-   * @brief The width of the display in pixels
+   * @brief Renders in page mode using the loop bounds provided by the geometry
+   *
+   * @tparam TGeometry PanelGeometry or RuntimeGeometry
    */
-  const int16_t width;
+  template <typename TGeometry>
+  void render_strips(const TGeometry& geometry, uint8_t* const strip, const int16_t rows, const DrawCallback draw, void* const context, const bool doBlock);
+
   /**
-   * @brief The height of the display in pixels
+   * @brief Fills the screen with a single byte value
+   *
+   * @tparam TGeometry PanelGeometry or RuntimeGeometry
    */
-  const int16_t height;
+  template <typename TGeometry>
+  void fill(const TGeometry& geometry, const uint8_t value);
 
 private:
+  /**
+   * @brief Reads the header of a binary PBM (P4) image
+   *
+   * @param stream The stream to read from, left at the start of the image data
+   * @param w Set to the width of the image
+   * @param h Set to the height of the image
+   * @return false if the header is invalid
+   */
+  static bool read_pbm_header(Stream& stream, int16_t& w, int16_t& h);
+
+  /**
+   * @brief Renders an image to a window of the display, @see render(const uint8_t* const, const int16_t, const int16_t, const int16_t, const int16_t, const int16_t, const uint8_t, const bool)
+   *
+   * @param progmem True if the image is stored in PROGMEM
+   */
+  bool render_window(const uint8_t* buffer, int16_t x, int16_t y, int16_t w, int16_t h, const int16_t stride, const uint8_t format, const bool progmem, const bool doBlock);
+
+  /**
+   * @brief Writes a row of an image within `begin_write` and `end_write`, converting it to the display's format
+   *
+   * @param row The row of the image
+   * @param len The number of bytes to send
+   * @param format How the pixels are stored, @see ImageFormat
+   * @param progmem True if the row is stored in PROGMEM
+   */
+  void write_converted(const uint8_t* const row, const size_t len, const uint8_t format, const bool progmem);
+
+  /**
+   * @brief Sets the window of display RAM that is written to
+   * @details Writes wrap from the right edge of the window to the left edge of the next row.
+   *
+   * @param x0 The left edge, in bytes
+   * @param x1 The right edge (inclusive), in bytes
+   * @param y0 The top row
+   * @param y1 The bottom row
+   */
+  void window(const int16_t x0, const int16_t x1, const int16_t y0, const int16_t y1);
+
+  /**
+   * @brief Sets the window back to the whole display
+   */
+  void full_window();
+
+  /**
+   * @brief Starts writing to the display RAM from the start of a row
+   * @details Leaves the SPI transaction open in data mode, must be followed by `end_write`
+   *
+   * @param y The row to start writing from
+   * @param ram The RAM to write to, WRITE_RAM for black or WRITE_RAM_RED
+   * @param x The column to start writing from, rounded down to a byte
+   */
+  void begin_write(const int16_t y = 0, const uint8_t ram = WRITE_RAM, const int16_t x = 0);
+
+  /**
+   * @brief Ends writing to the display RAM
+   */
+  void end_write();
+
+  /**
+   * @brief Writes a block of data within `begin_write` and `end_write`
+   *
+   * @param d The data to send
+   * @param len The number of bytes to send
+   */
+  void write(const uint8_t* const d, const size_t len);
+
+  /**
+   * @brief Writes the same byte repeatedly within `begin_write` and `end_write`
+   *
+   * @param value The byte to send
+   * @param len The number of times to send it
+   */
+  void write_run(const uint8_t value, const size_t len);
+
+  /**
+   * @brief Blanks the red plane of a tri-colour display, before rendering something with no red in it
+   *
+   * @param size The number of bytes in the plane
+   */
+  void clear_red(const size_t size);
+
+  /**
+   * @brief Writes an image to the display RAM and updates the display
+   * @details With differential updates the image is written to the previous image RAM as well, before a full refresh or once a fast update is complete. Otherwise the red plane of a tri-colour display is blanked.
+   *
+   * @tparam TPass Called with the RAM to write, WRITE_RAM or WRITE_RAM_OLD, to write the whole image to it from the start
+   * @param size The number of bytes in the image, 0 for a window, which leaves the rest of both RAMs as they were
+   * @param doBlock Blocks until the update is complete
+   */
+  template <typename TPass>
+  void send(const size_t size, const TPass& pass, const bool doBlock);
+
+  /**
+   * @brief Whether the previous image RAM is kept in sync for differential updates
+   */
+  bool keep_old() const { return fast_waveform && fast_differential && !colour; }
+
+  /**
+   * @brief Whether the next update is a full refresh
+   */
+  bool full_due() const;
+
+  /**
+   * @brief Triggers the display update sequence
+   * @details With fast refresh, the update is fast unless a full refresh is due.
+   *
+   * @param doBlock Blocks until the update is complete
+   */
+  void update(const bool doBlock);
+
+  /**
+   * @brief Triggers a full update with the display's own waveform
+   *
+   * @param doBlock Blocks until the update is complete
+   */
+  void update_full(const bool doBlock);
+
+  /**
+   * @brief Sends the fast waveform from PROGMEM to the LUT register
+   */
+  void load_fast_waveform();
+
   /**
    * @brief blocks execution until the busy pin indicates the display is ready
    */
@@ -303,7 +497,19 @@ private:
 
   const SPISettings settings;
 
-  uint8_t orientation;
+  bool colour;
+
+  const uint8_t* fast_waveform; // in PROGMEM, or nullptr for a full refresh every update
+  size_t fast_length;
+  uint16_t fast_limit;
+  uint32_t fast_interval;
+
+  uint16_t updates;        // fast updates since the last full refresh
+  uint32_t last_full;      // millis() at the last full refresh
+  bool fast_loaded;        // the LUT register holds the fast waveform
+  bool sequence_changed;   // the update sequence has been set, rather than left at the display's default
+  bool fast_differential;  // fast updates compare with the previous image
+  bool old_synced;         // the previous image RAM holds the image on screen
 
   static const uint8_t DATA_ENTRY_ORDER = 0x11;
 
@@ -315,6 +521,9 @@ private:
   static const uint8_t SOFT_RESET = 0x12;
 
   static const uint8_t WRITE_RAM = 0x24;
+  static const uint8_t WRITE_LUT = 0x32;
+  static const uint8_t WRITE_RAM_RED = 0x26;
+  static const uint8_t WRITE_RAM_OLD = 0x26; // the same RAM, holding the previous image on black and white displays
 
   static const uint8_t SET_X_SIZE = 0x44;
   static const uint8_t SET_Y_SIZE = 0x45;
@@ -322,8 +531,369 @@ private:
   static const uint8_t SET_Y_ADDRESS = 0x4F;
   static const uint8_t DISPLAY_UPDATE_CONTROL = 0x21;
   static const uint8_t DISPLAY_UPDATE_SEQUENCE = 0x20;
+  static const uint8_t DISPLAY_UPDATE_CONTROL_2 = 0x22;
+
+  static const uint8_t SEQUENCE_FULL = 0xF7; // load the waveform from OTP and display
+  static const uint8_t SEQUENCE_FAST = 0xC7; // display with the waveform in the LUT register
+  static const uint8_t SEQUENCE_DIFFERENTIAL = 0xCF; // as fast, comparing with the previous image (display mode 2)
 };
 
+/**
+ * @brief Controls an ePaper Display with dimensions known at compile time
+ * @details Behaves the same as EPDLite, but the render loops are generated for the exact panel size so loop bounds are constants and byte addressing reduces to shifts. Use EPDLite when the size is only known at runtime.
+ *
+ * @tparam TWidth Width of the display in pixels
+ * @tparam THeight Height of the display in pixels
+ */
+template <int16_t TWidth, int16_t THeight>
+class FixedEPDLite : public EPDLite
+{
+public:
+  using Geometry = PanelGeometry<TWidth, THeight>;
+
+  /**
+   * @brief Initializes the display.
+   *
+   * @param cs Chip Select pin
+   * @param dc Data/Command pin
+   * @param busy Busy pin
+   * @param reset Reset pin
+   */
+  FixedEPDLite(const pin_t cs, const pin_t dc, const pin_t busy, const pin_t reset)
+  : EPDLite(TWidth, THeight, cs, dc, busy, reset)
+  {}
+
+  using EPDLite::render;
+  using EPDLite::render_P;
+
+  /**
+   * @copydoc EPDLite::render(CommandBufferInterface&, const bool)
+   */
+  void render(CommandBufferInterface& buffer, const bool doBlock = true)
+  {
+    render_commands(Geometry(), buffer, doBlock);
+  }
+
+  /**
+   * @copydoc EPDLite::render(const uint8_t* const, const bool)
+   */
+  void render(const uint8_t* const buffer, const bool doBlock = true)
+  {
+    render_buffer<false>(Geometry(), buffer, doBlock);
+  }
+
+  /**
+   * @copydoc EPDLite::render_P
+   */
+  void render_P(const uint8_t* const buffer, const bool doBlock = true)
+  {
+    render_buffer<true>(Geometry(), buffer, doBlock);
+  }
+
+  /**
+   * @copydoc EPDLite::render(const CompressedImage&, const bool)
+   */
+  bool render(const CompressedImage& image, const bool doBlock = true)
+  {
+    return render_compressed(Geometry(), image, false, doBlock);
+  }
+
+  /**
+   * @copydoc EPDLite::render_P(const CompressedImage&, const bool)
+   */
+  bool render_P(const CompressedImage& image, const bool doBlock = true)
+  {
+    return render_compressed(Geometry(), image, true, doBlock);
+  }
+
+  /**
+   * @copydoc EPDLite::render(Stream&, const bool, const bool)
+   */
+  bool render(Stream& stream, const bool pbm = false, const bool doBlock = true)
+  {
+    return render_stream(Geometry(), stream, pbm, doBlock);
+  }
+
+  /**
+   * @copydoc EPDLite::render(uint8_t* const, const int16_t, const DrawCallback, void* const, const bool)
+   */
+  void render(uint8_t* const strip, const int16_t rows, const DrawCallback draw, void* const context = nullptr, const bool doBlock = true)
+  {
+    render_strips(Geometry(), strip, rows, draw, context, doBlock);
+  }
+
+  /**
+   * @copydoc EPDLite::clear
+   */
+  void clear()
+  {
+    fill(Geometry(), 0xff);
+  }
+};
+
+
+template <typename TGeometry>
+void EPDLite::render_commands(const TGeometry& geometry, CommandBufferInterface& buffer, const bool doBlock)
+{
+  if (!geometry.fits())
+    return;
+
+  const int16_t stride = geometry.stride();
+  uint8_t row[TGeometry::max_stride()];
+
+  buffer.prepare(*this);
+
+  if (colour)
+  {
+    render_colour(geometry, buffer, row, stride);
+    update(doBlock);
+    return;
+  }
+
+  send(geometry.size(), [&](const uint8_t ram) {
+    begin_write(0, ram);
+
+    for (int16_t y = 0; y < geometry.height(); ++y)
+    {
+      if (buffer.render_row(row, y, stride, true, *this) == CommandBufferInterface::BLANK_ROW)
+        write_run(0xff, stride);
+      else
+        write(row, stride);
+    }
+
+    end_write();
+  }, doBlock);
+}
+
+template <typename TGeometry>
+void EPDLite::render_colour(const TGeometry& geometry, CommandBufferInterface& buffer, uint8_t* const row, const int16_t stride)
+{
+  uint8_t red[TGeometry::max_stride()];
+
+  // the planes share the address counter, so each row of each plane is placed
+  for (int16_t y = 0; y < geometry.height(); ++y)
+  {
+    const CommandBufferInterface::RowState state = buffer.render_row(row, red, y, stride, true, *this);
+
+    // the display uses 1 for red, kept inverted so a repeated row can be sent again as it is
+    if (state == CommandBufferInterface::DRAWN_ROW)
+    {
+      for (int16_t i = 0; i < stride; ++i)
+        red[i] = ~red[i];
+    }
+
+    begin_write(y);
+    if (state == CommandBufferInterface::BLANK_ROW)
+      write_run(0xff, stride);
+    else
+      write(row, stride);
+    end_write();
+
+    begin_write(y, WRITE_RAM_RED);
+    if (state == CommandBufferInterface::BLANK_ROW)
+      write_run(0x00, stride);
+    else
+      write(red, stride);
+    end_write();
+  }
+}
+
+template <bool TProgmem, typename TGeometry>
+void EPDLite::render_buffer(const TGeometry& geometry, const uint8_t* const buffer, const bool doBlock)
+{
+  if (!geometry.fits())
+    return;
+
+  send(geometry.size(), [&](const uint8_t ram) {
+    begin_write(0, ram);
+
+    if (TProgmem)
+    {
+      for (size_t i = 0; i < geometry.size(); ++i)
+        SPI.transfer(pgm_read_byte(&buffer[i]));
+    }
+    else
+      write(buffer, geometry.size());
+
+    end_write();
+  }, doBlock);
+}
+
+template <typename TGeometry>
+bool EPDLite::render_compressed(const TGeometry& geometry, const CompressedImage& image, const bool progmem, const bool doBlock)
+{
+  if (!geometry.fits())
+    return false;
+
+  const int16_t stride = geometry.stride();
+  uint8_t row[TGeometry::max_stride()];
+
+  // the whole row must be decoded, even if it's cropped
+  const int16_t source = image.stride();
+  if (source > TGeometry::max_stride())
+    return false;
+
+  send(geometry.size(), [&](const uint8_t ram) {
+    ImageDecoder decoder(image.data, progmem);
+
+    begin_write(0, ram);
+
+    for (int16_t y = 0; y < geometry.height(); ++y)
+    {
+      if (y >= image.height)
+      {
+        write_run(0xff, stride);
+        continue;
+      }
+
+      decoder.next(row, source);
+      if (source < stride)
+      {
+        write(row, source);
+        write_run(0xff, stride - source);
+      }
+      else
+        write(row, stride);
+    }
+
+    end_write();
+  }, doBlock);
+  return true;
+}
+
+template <typename TGeometry>
+bool EPDLite::render_stream(const TGeometry& geometry, Stream& stream, const bool pbm, const bool doBlock)
+{
+  if (!geometry.fits())
+    return false;
+
+  const int16_t stride = geometry.stride();
+  uint8_t row[TGeometry::max_stride()];
+
+  int16_t w = geometry.width();
+  int16_t h = geometry.height();
+  if (pbm && !read_pbm_header(stream, w, h))
+    return false;
+
+  // bytes per row in the stream, and how many of them land on the display
+  const int16_t source = (w + 7) / 8;
+  const int16_t used = source < stride ? source : stride;
+
+  bool complete = true;
+  for (int16_t y = 0; y < geometry.height(); ++y)
+  {
+    memset(row, 0xff, stride);
+
+    if (complete && y < h)
+    {
+      const size_t got = stream.readBytes(row, used);
+      complete = got == static_cast<size_t>(used);
+
+      // skip the part of the row that's wider than the display
+      uint8_t discard;
+      for (int16_t i = used; complete && i < source; ++i)
+        complete = stream.readBytes(&discard, 1) == 1;
+
+      // PBM uses 1 for black, the display uses 0
+      if (pbm)
+      {
+        for (size_t i = 0; i < got; ++i)
+          row[i] = ~row[i];
+        if (got == static_cast<size_t>(used) && w < geometry.width() && (w & 7))
+          row[used - 1] |= 0xff >> (w & 7);
+      }
+    }
+
+    // the bus is released while reading, so the stream is free to use SPI (e.g., an SD card)
+    begin_write(y);
+    write(row, stride);
+    end_write();
+
+    // the stream can't be read again after the update, so the previous image is written now for a full refresh
+    if (keep_old())
+    {
+      begin_write(y, WRITE_RAM_OLD);
+      write(row, stride);
+      end_write();
+    }
+  }
+
+  if (keep_old())
+  {
+    old_synced = true;
+    update_full(doBlock);
+  }
+  else
+  {
+    clear_red(geometry.size());
+    update(doBlock);
+  }
+  return complete;
+}
+
+template <typename TGeometry>
+void EPDLite::render_strips(const TGeometry& geometry, uint8_t* const strip, const int16_t rows, const DrawCallback draw, void* const context, const bool doBlock)
+{
+  if (!geometry.fits())
+    return;
+
+  send(geometry.size(), [&](const uint8_t ram) {
+    for (int16_t top = 0; top < geometry.height(); top += rows)
+    {
+      const int16_t count = top + rows > geometry.height() ? geometry.height() - top : rows;
+
+      Canvas canvas(strip, geometry.width(), top, count);
+      canvas.clear();
+      draw(canvas, context);
+
+      // the bus is released while drawing, so the callback is free to use SPI (e.g., to read from an SD card)
+      begin_write(top, ram);
+      write(strip, static_cast<size_t>(geometry.stride()) * count);
+      end_write();
+    }
+  }, doBlock);
+}
+
+template <typename TGeometry>
+void EPDLite::fill(const TGeometry& geometry, const uint8_t value)
+{
+  if (!geometry.fits())
+    return;
+
+  send(geometry.size(), [&](const uint8_t ram) {
+    begin_write(0, ram);
+    write_run(value, geometry.size());
+    end_write();
+  }, true);
+}
+
+template <typename TPass>
+void EPDLite::send(const size_t size, const TPass& pass, const bool doBlock)
+{
+  pass(WRITE_RAM);
+
+  if (!keep_old())
+  {
+    clear_red(size);
+    update(doBlock);
+    return;
+  }
+
+  // a full refresh doesn't compare with the previous image, so the new image can be written there first
+  if (full_due())
+  {
+    pass(WRITE_RAM_OLD);
+    // the rest of the previous image RAM is only in step with a window if it already was
+    old_synced = old_synced || size;
+    update_full(doBlock);
+    return;
+  }
+
+  // the display compares with the previous image as it updates, after which the new image is the previous one
+  update(true);
+  pass(WRITE_RAM_OLD);
+}
+
 #endif
 
 /* \} */
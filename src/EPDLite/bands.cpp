@@ -0,0 +1,124 @@
+#include "bands.h"
+
+#ifdef EPDLITE_BANDS
+
+#include <string.h>
+
+#if defined(TEST)
+#include <thread>
+#include "../../extra/stub.h"
+#elif defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "EPDLite.h"
+#else
+#include <pico/platform.h>
+#include "EPDLite.h"
+#endif
+
+/**
+ * @brief Lets the other cores get on while there's nothing to render
+ */
+static void rest()
+{
+#if defined(TEST)
+  std::this_thread::yield();
+#elif defined(ARDUINO_ARCH_ESP32)
+  taskYIELD();
+#else
+  tight_loop_contents();
+#endif
+}
+
+BandRenderer::BandRenderer(CommandBufferInterface& buffer, const Display& epd, uint8_t* const ring, const int16_t rows, const uint8_t slots) :
+buffer(buffer), epd(epd), ring(ring),
+rows(rows > 0 ? rows : 1),
+stride((epd.width + 7) / 8),
+bands((epd.height + this->rows - 1) / this->rows),
+slots(slots < 1 ? 1 : slots > BAND_SLOTS ? BAND_SLOTS : slots),
+parallel(false), taken(0), sent(0)
+{
+  for (uint8_t i = 0; i < BAND_SLOTS; ++i)
+    done[i] = -1;
+
+  buffer.prepare(epd);
+  parallel = buffer.concurrent(epd);
+}
+
+void BandRenderer::help()
+{
+  if (!parallel)
+    return;
+
+  while (taken.load() < bands)
+  {
+    if (!take())
+      rest();
+  }
+}
+
+const uint8_t* BandRenderer::next(int16_t& y, int16_t& count)
+{
+  const int16_t band = sent.load();
+  if (band >= bands)
+    return nullptr;
+
+  const uint8_t slot = band % slots;
+  while (done[slot].load(std::memory_order_acquire) != band)
+  {
+    if (!take())
+      rest();
+  }
+
+  y = band * rows;
+  count = y + rows > epd.height ? epd.height - y : rows;
+  return ring + static_cast<size_t>(slot) * rows * stride;
+}
+
+void BandRenderer::release()
+{
+  // only the sending core moves on, so the count doesn't need to be swapped atomically
+  sent.store(sent.load() + 1, std::memory_order_release);
+}
+
+bool BandRenderer::take()
+{
+  // a band can only be taken once the band before it in its buffer has been sent
+  int16_t band = taken.load();
+  if (band >= bands || band - sent.load(std::memory_order_acquire) >= slots)
+    return false;
+
+  // another core took it first, there may be another to take
+  if (!taken.compare_exchange_weak(band, band + 1))
+    return true;
+
+  render(band);
+  done[band % slots].store(band, std::memory_order_release);
+  return true;
+}
+
+void BandRenderer::render(const int16_t band)
+{
+  uint8_t* const data = ring + static_cast<size_t>(band % slots) * rows * stride;
+  const int16_t top = band * rows;
+  const int16_t count = top + rows > epd.height ? epd.height - top : rows;
+
+  // rows are rendered in place, so a repeated row is copied down from the row above
+  for (int16_t r = 0; r < count; ++r)
+  {
+    uint8_t* const row = data + static_cast<size_t>(r) * stride;
+    switch (buffer.render_row(row, top + r, stride, r > 0, epd))
+    {
+      case CommandBufferInterface::BLANK_ROW:
+        memset(row, 0xff, stride);
+        break;
+      case CommandBufferInterface::REPEATED_ROW:
+        memcpy(row, row - stride, stride);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+#endif
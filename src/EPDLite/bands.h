@@ -0,0 +1,105 @@
+/**
+ * @file bands.h
+ * @brief ePaper Display Interface band renderer
+ * @ingroup  EPDLite
+ * @addtogroup  EPDLite
+ * \{
+ *
+ * The screen is split into bands of rows, which are rendered into a small ring of band buffers by several cores at once while the bands already rendered are sent to the display in order.
+ */
+
+#ifndef EPDLITE_BANDS_H_INCLUDE
+#define EPDLITE_BANDS_H_INCLUDE
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(TEST) || defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_RP2040)
+/**
+ * @brief Defined where bands can be rendered on more than one core
+ */
+#define EPDLITE_BANDS
+#endif
+
+#ifdef EPDLITE_BANDS
+
+#include <atomic>
+
+#include "commandbuffer.h"
+
+/**
+ * @brief The most band buffers in a ring
+ */
+const uint8_t BAND_SLOTS = 8;
+
+/**
+ * @brief Renders a command buffer a band at a time, on several cores at once
+ * @details One core sends the bands in order, taking each with `next` and handing its buffer back with `release`, and renders bands itself while it waits for them. Any number of helpers on other cores call `help` to render bands ahead of it, as far as the ring allows.
+ * Bands are taken in order, each by whichever core gets to it first, so a band slow to render doesn't hold up the others.
+ */
+class BandRenderer
+{
+public:
+  /**
+   * @brief Prepares a buffer to render in bands
+   *
+   * @param buffer The commands to render
+   * @param epd The display to render for
+   * @param ring The band buffers, at least `slots * rows * ceil(width / 8)` bytes
+   * @param rows The number of rows in a band
+   * @param slots The number of band buffers, 1 to BAND_SLOTS. Each core needs one to render into, and one more lets them render while a band is sent
+   */
+  BandRenderer(CommandBufferInterface& buffer, const Display& epd, uint8_t* const ring, const int16_t rows, const uint8_t slots);
+
+  /**
+   * @brief Whether helpers can render bands
+   * @details False if the buffer must be rendered a row at a time in order, @see CommandBufferInterface::concurrent. Every band is then rendered by the core sending them, and `help` returns straight away.
+   */
+  bool concurrent() const { return parallel; }
+
+  /**
+   * @brief Renders bands until every band has been taken
+   * @details Called by helpers, waits while the ring is full.
+   */
+  void help();
+
+  /**
+   * @brief Waits for the next band, rendering bands while it waits
+   *
+   * @param y Set to the first row of the band
+   * @param count Set to the number of rows in the band
+   * @return The band's buffer, `count` rows of `ceil(width / 8)` bytes, or nullptr once every band has been sent
+   */
+  const uint8_t* next(int16_t& y, int16_t& count);
+
+  /**
+   * @brief Hands the buffer of the band from `next` back, to render another band into
+   */
+  void release();
+
+private:
+  /**
+   * @brief Takes the next band and renders it, if its buffer is free
+   * @return false if there was nothing to do
+   */
+  bool take();
+
+  void render(const int16_t band);
+
+  CommandBufferInterface& buffer;
+  const Display& epd;
+  uint8_t* const ring;
+  const int16_t rows, stride, bands;
+  const uint8_t slots;
+  bool parallel;
+
+  std::atomic<int16_t> taken;           // the next band to render
+  std::atomic<int16_t> sent;            // the next band to send
+  std::atomic<int16_t> done[BAND_SLOTS]; // the band rendered into each buffer
+};
+
+#endif
+
+#endif
+
+/* \} */
@@ -0,0 +1,43 @@
+/**
+ * @file bitmap.h
+ * @brief ePaper Display Interface bitmaps
+ * @ingroup  EPDLite
+ * @addtogroup  EPDLite
+ * \{
+ */
+
+#ifndef EPDLITE_BITMAP_H_INCLUDE
+#define EPDLITE_BITMAP_H_INCLUDE
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief An uncompressed image
+ * @details The data is in the same format as the display: row major, MSB first, 0 is black, each row padded to a whole byte.
+ * Bitmaps can be created with the `imgconv` tool in `extra/`.
+ */
+struct Bitmap
+{
+  /**
+   * @brief The image data, `height * stride()` bytes
+   */
+  const uint8_t* data;
+  /**
+   * @brief Width of the image in pixels
+   */
+  int16_t width;
+  /**
+   * @brief Height of the image in pixels
+   */
+  int16_t height;
+
+  /**
+   * @brief The number of bytes in a row of the image
+   */
+  int16_t stride() const { return (width + 7) / 8; }
+};
+
+#endif
+
+/* \} */
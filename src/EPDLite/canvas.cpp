@@ -0,0 +1,246 @@
+#include "canvas.h"
+
+#ifdef TEST
+#include "../../extra/stub.h"
+#else
+#include "EPDLite.h"
+#endif
+
+#include "font.h"
+#include "packedfont.h"
+#include "raster.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+Canvas::Canvas(uint8_t* const buffer, const int16_t width, const int16_t top, const int16_t rows)
+  : buf(buffer)
+  , w(width)
+  , stride((width + 7) / 8)
+  , y0(top)
+  , rows(rows)
+{
+}
+
+void Canvas::clear(const uint8_t value)
+{
+  memset(buf, value, static_cast<size_t>(stride) * rows);
+}
+
+void Canvas::pixel(const int16_t x, const int16_t y)
+{
+  if (x < 0 || x >= w || y < top() || y > bottom())
+    return;
+
+  row(y)[x >> 3] &= ~(1 << (7 - (x & 7)));
+}
+
+void Canvas::span(int16_t x0, int16_t x1, const int16_t y)
+{
+  if (y < top() || y > bottom())
+    return;
+
+  if (x0 < 0)
+    x0 = 0;
+  if (x1 >= w)
+    x1 = w - 1;
+  if (x1 < x0)
+    return;
+
+  fill_span(row(y), x0, x1);
+}
+
+void Canvas::hline(const int16_t x0, const int16_t x1, const int16_t y)
+{
+  if (x0 <= x1)
+    span(x0, x1, y);
+  else
+    span(x1, x0, y);
+}
+
+void Canvas::vline(const int16_t x, int16_t y0, int16_t y1)
+{
+  if (y1 < y0)
+  {
+    const int16_t t = y0;
+    y0 = y1;
+    y1 = t;
+  }
+
+  if (y0 < top())
+    y0 = top();
+  if (y1 > bottom())
+    y1 = bottom();
+
+  for (int16_t y = y0; y <= y1; ++y)
+    pixel(x, y);
+}
+
+void Canvas::line(int16_t x0, int16_t y0, const int16_t x1, const int16_t y1)
+{
+  if (y0 == y1)
+    return hline(x0, x1, y0);
+  if (x0 == x1)
+    return vline(x0, y0, y1);
+
+  // Bresenham's line algorithm
+  const int16_t dx = abs(x1 - x0);
+  const int16_t dy = -abs(y1 - y0);
+  const int16_t sx = x0 < x1 ? 1 : -1;
+  const int16_t sy = y0 < y1 ? 1 : -1;
+  int16_t err = dx + dy;
+
+  while (true)
+  {
+    pixel(x0, y0);
+    if (x0 == x1 && y0 == y1)
+      break;
+
+    // the rest of the line is below (or above) the canvas
+    if ((sy > 0 && y0 > bottom()) || (sy < 0 && y0 < top()))
+      break;
+
+    const int16_t e2 = 2 * err;
+    if (e2 >= dy)
+    {
+      err += dy;
+      x0 += sx;
+    }
+    if (e2 <= dx)
+    {
+      err += dx;
+      y0 += sy;
+    }
+  }
+}
+
+void Canvas::rect(const int16_t x, const int16_t y, const int16_t width, const int16_t height, const bool fill)
+{
+  if (!visible(y, y + height))
+    return;
+
+  if (fill)
+  {
+    const int16_t first = y < top() ? top() : y;
+    const int16_t last = y + height > bottom() ? bottom() : y + height;
+    for (int16_t r = first; r <= last; ++r)
+      span(x, x + width, r);
+    return;
+  }
+
+  span(x, x + width, y);
+  span(x, x + width, y + height);
+  vline(x, y, y + height);
+  vline(x + width, y, y + height);
+}
+
+void Canvas::circle(const int16_t x, const int16_t y, const int16_t r, const bool fill)
+{
+  if (!visible(y - r, y + r))
+    return;
+
+  const int16_t first = y - r < top() ? top() : y - r;
+  const int16_t last = y + r > bottom() ? bottom() : y + r;
+  const int32_t rsq = static_cast<int32_t>(r) * r;
+
+  for (int16_t row = first; row <= last; ++row)
+  {
+    const int32_t dysq = static_cast<int32_t>(row - y) * (row - y);
+
+    if (fill)
+    {
+      const int16_t outer = isqrt(rsq - dysq);
+      span(x - outer, x + outer, row);
+      continue;
+    }
+
+    // pixels whose distance rounds to r: (r - 0.5)^2 <= d^2 < (r + 0.5)^2
+    const int32_t outersq = rsq + r - dysq;
+    if (outersq < 0)
+      continue;
+    const int16_t outer = isqrt(outersq);
+    const int32_t innersq = rsq - r + 1 - dysq;
+    const int16_t inner = innersq > 0 ? isqrt(innersq - 1) + 1 : 0;
+    if (inner > outer)
+      continue;
+
+    span(x - outer, x - inner, row);
+    span(x + inner, x + outer, row);
+  }
+}
+
+void Canvas::text(const int16_t x, const int16_t y, const char* const text, const Font& font, const int16_t size)
+{
+  // glyph columns are a byte each, some fonts use the 8th bit for descenders. As TextCommand, rows below
+  // `charheight * size` are clipped, so the text is the same in page mode
+  const int16_t last = y + font.charheight * size;
+  if (!visible(y, last))
+    return;
+
+  int16_t cx = x;
+  for (const char* c = text; *c; ++c, cx += (font.charwidth + 1) * size)
+  {
+    if (cx >= w)
+      break;
+    if (cx + font.charwidth * size < 0)
+      continue;
+
+    // anything outside the font's range (such as UTF-8) is drawn as a blank
+    const uint8_t code = static_cast<uint8_t>(*c);
+    if (code < font.mapoffset || code >= font.mapoffset + font.maplength)
+      continue;
+
+    const uint8_t* const glyph = &font.charmap[(code - font.mapoffset) * font.charwidth];
+    for (int16_t d = 0; d < font.charwidth; ++d)
+    {
+      const uint8_t slice = pgm_read_byte(&glyph[d]);
+      for (int16_t bit = 0; bit < 8; ++bit)
+      {
+        if (!((slice >> bit) & 1))
+          continue;
+
+        const int16_t px = cx + d * size;
+        const int16_t py = y + bit * size;
+        for (int16_t r = 0; r < size && py + r <= last; ++r)
+          span(px, px + size - 1, py + r);
+      }
+    }
+  }
+}
+
+void Canvas::text(const int16_t x, const int16_t y, const char* const text, const PackedFont& font)
+{
+  if (!visible(y, y + font.height - 1))
+    return;
+
+  const int16_t first = y < top() ? top() : y;
+  const int16_t last = y + font.height - 1 > bottom() ? bottom() : y + font.height - 1;
+
+  int16_t cx = x;
+  for (const char* c = text; *c && cx < w;)
+  {
+    Glyph glyph;
+    if (!font.next(c, glyph))
+      continue;
+
+    if (glyph.width && cx + glyph.width > 0)
+    {
+      for (int16_t r = first; r <= last; ++r)
+        blit_span(row(r), w, cx, font.row(glyph, r - y), glyph.width, true);
+    }
+    cx += glyph.advance;
+  }
+}
+
+void Canvas::bitmap(const int16_t x, const int16_t y, const uint8_t* const bitmap, const int16_t width, const int16_t height, const bool progmem)
+{
+  if (!visible(y, y + height - 1))
+    return;
+
+  const int16_t first = y < top() ? top() : y;
+  const int16_t last = y + height - 1 > bottom() ? bottom() : y + height - 1;
+  const int16_t bytes = (width + 7) / 8;
+
+  for (int16_t r = first; r <= last; ++r)
+    blit_span(row(r), w, x, &bitmap[static_cast<size_t>(r - y) * bytes], width, progmem);
+}
@@ -0,0 +1,172 @@
+/**
+ * @file canvas.h
+ * @brief ePaper Display Interface immediate mode drawing
+ * @ingroup  EPDLite
+ * @addtogroup  EPDLite
+ * \{
+ */
+
+#ifndef EPDLITE_CANVAS_H_INCLUDE
+#define EPDLITE_CANVAS_H_INCLUDE
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bitmap.h"
+
+class Font;
+struct PackedFont;
+
+/**
+ * @brief Draws directly into a strip of rows of the display
+ * @details Used with page mode rendering, @see EPDLite::render(uint8_t* const, const int16_t, const DrawCallback, void* const, const bool).
+ * The canvas covers a number of rows of the display starting at `top()`, anything drawn outside of them is clipped.
+ * Coordinates are display coordinates, the orientation of the display is not applied.
+ */
+class Canvas
+{
+public:
+  /**
+   * @brief Creates a canvas over a strip buffer
+   *
+   * @param buffer The strip buffer, at least `rows * (width + 7) / 8` bytes
+   * @param width The width of the display in pixels
+   * @param top The first row of the display held in the buffer
+   * @param rows The number of rows held in the buffer
+   */
+  Canvas(uint8_t* const buffer, const int16_t width, const int16_t top, const int16_t rows);
+
+  /**
+   * @brief The width of the canvas in pixels
+   */
+  int16_t width() const { return w; }
+  /**
+   * @brief The first row of the display covered by the canvas
+   */
+  int16_t top() const { return y0; }
+  /**
+   * @brief The last row of the display covered by the canvas (inclusive)
+   */
+  int16_t bottom() const { return y0 + rows - 1; }
+
+  /**
+   * @brief Whether any of the rows from y0 to y1 (inclusive) are covered by the canvas
+   * @details Useful to skip expensive drawing code for strips it can't appear in.
+   */
+  bool visible(const int16_t y0, const int16_t y1) const { return y1 >= top() && y0 <= bottom(); }
+
+  /**
+   * @brief Fills the canvas with a byte value, 0xff is white
+   */
+  void clear(const uint8_t value = 0xff);
+
+  /**
+   * @brief Draws a single pixel
+   */
+  void pixel(const int16_t x, const int16_t y);
+
+  /**
+   * @brief Draws a horizontal line from x0 to x1 (inclusive)
+   */
+  void hline(const int16_t x0, const int16_t x1, const int16_t y);
+
+  /**
+   * @brief Draws a vertical line from y0 to y1 (inclusive)
+   */
+  void vline(const int16_t x, const int16_t y0, const int16_t y1);
+
+  /**
+   * @brief Draws a one width line between any two points
+   */
+  void line(const int16_t x0, const int16_t y0, const int16_t x1, const int16_t y1);
+
+  /**
+   * @brief Draws a rectangle
+   *
+   * @param x X position of the top left corner
+   * @param y Y position of the top left corner
+   * @param width Width of the rectangle
+   * @param height Height of the rectangle
+   * @param fill True to fill the rectangle, false to draw the outline
+   */
+  void rect(const int16_t x, const int16_t y, const int16_t width, const int16_t height, const bool fill);
+
+  /**
+   * @brief Draws a circle
+   *
+   * @param x X position of the circle's origin
+   * @param y Y position of the circle's origin
+   * @param r Radius of the circle
+   * @param fill True to fill the circle, false to draw the outline
+   */
+  void circle(const int16_t x, const int16_t y, const int16_t r, const bool fill);
+
+  /**
+   * @brief Draws some text
+   *
+   * @param x X position of the start of the text
+   * @param y Y position of the top of the text
+   * @param text The text to draw
+   * @param font The font to use
+   * @param size Scale factor for the font
+   */
+  void text(const int16_t x, const int16_t y, const char* const text, const Font& font, const int16_t size = 1);
+
+  /**
+   * @brief Draws some text with a packed font
+   * @details Each row of a glyph is copied into the canvas a byte at a time.
+   *
+   * @param x X position of the start of the text
+   * @param y Y position of the top of the text
+   * @param text The text to draw
+   * @param font The font to use, @see PackedFont
+   */
+  void text(const int16_t x, const int16_t y, const char* const text, const PackedFont& font);
+
+  /**
+   * @brief Draws a bitmap
+   * @details The bitmap uses the same format as the display. Black pixels are drawn, white pixels are transparent.
+   *
+   * @param x X position of the top left corner
+   * @param y Y position of the top left corner
+   * @param bitmap Row major bitmap, each row padded to a whole byte
+   * @param width Width of the bitmap in pixels
+   * @param height Height of the bitmap in pixels
+   * @param progmem True if the bitmap is stored in PROGMEM
+   */
+  void bitmap(const int16_t x, const int16_t y, const uint8_t* const bitmap, const int16_t width, const int16_t height, const bool progmem);
+
+  /**
+   * @brief Draws a bitmap
+   *
+   * @param x X position of the top left corner
+   * @param y Y position of the top left corner
+   * @param bitmap The bitmap to draw, @see Bitmap
+   * @param progmem True if the bitmap is stored in PROGMEM
+   */
+  void bitmap(const int16_t x, const int16_t y, const Bitmap& bitmap, const bool progmem)
+  {
+    this->bitmap(x, y, bitmap.data, bitmap.width, bitmap.height, progmem);
+  }
+
+private:
+  /**
+   * @brief The row buffer for row y of the display
+   */
+  uint8_t* row(const int16_t y) { return &buf[(y - y0) * stride]; }
+
+  /**
+   * @brief Draws a horizontal span clipped to the canvas
+   */
+  void span(int16_t x0, int16_t x1, const int16_t y);
+
+  uint8_t* const buf;
+  const int16_t w;
+  const int16_t stride;
+  const int16_t y0;
+  const int16_t rows;
+};
+
+#endif
+
+/* \} */
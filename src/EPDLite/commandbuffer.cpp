@@ -0,0 +1,353 @@
+#include "commandbuffer.h"
+
+#ifdef TEST
+#include "../../extra/stub.h"
+#else
+#include "EPDLite.h"
+#endif
+
+const char* CommandBufferInterface::copy(const char* const text)
+{
+  return store(text, strlen(text), nullptr);
+}
+
+const char* CommandBufferInterface::format_int(const int32_t value, const char* const suffix)
+{
+  // negate as unsigned so INT32_MIN doesn't overflow
+  return store_fixed(value < 0, value < 0 ? 0u - static_cast<uint32_t>(value) : value, 0, suffix);
+}
+
+const char* CommandBufferInterface::format_fixed(const int32_t value, const uint8_t decimals, const char* const suffix)
+{
+  uint32_t magnitude = value < 0 ? 0u - static_cast<uint32_t>(value) : value;
+
+  // digits past the ninth place are rounded off, from the tenth every magnitude rounds to 0
+  if (decimals > 9)
+  {
+    uint32_t divisor = 1;
+    for (uint8_t i = 9; i < decimals && i < 18; ++i)
+      divisor *= 10;
+    magnitude = decimals - 9 > 9 ? 0 : magnitude / divisor + (magnitude % divisor >= divisor / 2);
+  }
+
+  // values which round to 0 have no sign
+  return store_fixed(value < 0 && magnitude, magnitude, decimals, suffix);
+}
+
+const char* CommandBufferInterface::format_float(const float value, const uint8_t precision, const char* const suffix)
+{
+  if (value != value)
+    return store("nan", 3, suffix);
+
+  const uint8_t decimals = precision > 9 ? 9 : precision;
+  float scaled = value < 0 ? -value : value;
+  for (uint8_t i = 0; i < decimals; ++i)
+    scaled *= 10;
+  scaled += 0.5f;
+
+  // the largest float below 2^32
+  if (scaled >= 4294967040.0f)
+    return store("ovf", 3, suffix);
+
+  const uint32_t magnitude = static_cast<uint32_t>(scaled);
+  // values which round to 0 have no sign
+  return store_fixed(value < 0 && magnitude, magnitude, decimals, suffix);
+}
+
+const char* CommandBufferInterface::store(const char* const text, const size_t length, const char* const suffix)
+{
+  const size_t extra = suffix ? strlen(suffix) : 0;
+  char* const out = allocate(length + extra + 1);
+  if (!out)
+    return "";
+
+  memcpy(out, text, length);
+  if (extra)
+    memcpy(out + length, suffix, extra);
+  out[length + extra] = '\0';
+  return out;
+}
+
+const char* CommandBufferInterface::store_fixed(const bool negative, uint32_t magnitude, const uint8_t decimals, const char* const suffix)
+{
+  // sign, 10 digits, a point and a leading 0, written backwards from the end
+  char digits[13];
+  char* p = digits + sizeof(digits);
+  const uint8_t places = decimals > 9 ? 9 : decimals;
+  for (uint8_t i = 0; i < places; ++i)
+  {
+    *--p = '0' + magnitude % 10;
+    magnitude /= 10;
+  }
+  if (places)
+    *--p = '.';
+  do
+  {
+    *--p = '0' + magnitude % 10;
+    magnitude /= 10;
+  } while (magnitude);
+  if (negative)
+    *--p = '-';
+
+  return store(p, digits + sizeof(digits) - p, suffix);
+}
+
+void CommandBufferInterface::prepare(const Display& epd)
+{
+  prepare_within(epd, {0, 0, static_cast<int16_t>(epd.width - 1), static_cast<int16_t>(epd.height - 1)});
+  frame = NO_FRAME;
+}
+
+void CommandBufferInterface::prepare_within(const Display& epd, const Bounds& within)
+{
+  // bounds are found where the commands were pushed
+  home();
+  area = within;
+
+  // looked up once, as bounds are read for every byte rendered
+  kept = kept_bounds();
+  // narrowed by each clip the command is within
+  Bounds clip = within;
+  for (size_t i = 0; i < size(); ++i)
+  {
+    // a group prepares its fragment before its bounds can be found from it
+    if (&ops(i) == &CommandTraits<GroupCommand>::ops)
+      ((GroupCommand*)command(i))->prepare(epd);
+
+    // without kept bounds, commands are measured as they are rendered
+    if (!kept)
+      continue;
+
+    Bounds b = ops(i).bounds(command(i), epd);
+
+    if (&ops(i) == &CommandTraits<ClipCommand>::ops)
+    {
+      ClipCommand* cc = (ClipCommand*)command(i);
+      if (cc->closing)
+      {
+        clip = ((ClipCommand*)command(cc->opened))->outer;
+      }
+      else
+      {
+        cc->outer = clip;
+        clip.intersect(b);
+      }
+
+      // the clip itself draws nothing
+      b = {0, 0, -1, -1};
+    }
+
+    b.intersect(clip);
+    kept[i] = b;
+  }
+}
+
+Bounds CommandBufferInterface::measure(const size_t at, const Display& epd)
+{
+  Bounds b = ops(at).bounds(command(at), epd);
+  b.intersect(area);
+  return b;
+}
+
+void CommandBufferInterface::move_to(const Vertex& to)
+{
+  const int16_t dx = to.x - moved.x;
+  const int16_t dy = to.y - moved.y;
+  for (size_t i = 0; i < size(); ++i)
+    ops(i).translate(command(i), dx, dy);
+  moved = to;
+}
+
+size_t CommandBufferInterface::open_clip()
+{
+  // skip over clips which have already ended
+  size_t ended = 0;
+  for (size_t i = size(); i > 0; --i)
+  {
+    if (&ops(i - 1) != &CommandTraits<ClipCommand>::ops)
+      continue;
+
+    const ClipCommand* cc = (const ClipCommand*)command(i - 1);
+    if (cc->closing)
+      ++ended;
+    else if (ended)
+      --ended;
+    else
+      return i - 1;
+  }
+  return size();
+}
+
+CommandBufferInterface::RowState CommandBufferInterface::render_row(uint8_t* const row, const int16_t y, const int16_t stride, const bool sequential, const Display& epd)
+{
+  return render_row(row, nullptr, y, stride, sequential, epd);
+}
+
+CommandBufferInterface::RowState CommandBufferInterface::render_row(uint8_t* const row, uint8_t* const red, const int16_t y, const int16_t stride, const bool sequential, const Display& epd)
+{
+  bool active = false;
+  bool repeat = sequential && y > 0;
+  for (size_t i = 0; i < size(); ++i)
+  {
+    const Bounds b = bounds(i, epd);
+    const bool here = b.contains_row(y);
+    const bool above = b.contains_row(y - 1);
+
+    active |= here;
+    if (repeat && (here != above || (here && !ops(i).repeats(command(i), y, epd))))
+      repeat = false;
+  }
+
+  if (!active)
+    return BLANK_ROW;
+  if (repeat)
+    return REPEATED_ROW;
+
+  for (int16_t xb = 0; xb < stride; xb += CHUNK)
+    render_chunk(row, red, xb, xb + CHUNK < stride ? xb + CHUNK : stride, y, epd);
+  return DRAWN_ROW;
+}
+
+void CommandBufferInterface::render_chunk(uint8_t* const row, uint8_t* const red, const int16_t begin, const int16_t end, const int16_t y, const Display& epd)
+{
+  // the topmost command which overwrites each byte, anything below it can't show through
+  // red commands only overwrite the red plane, so the black beneath them still shows
+  size_t first[CHUNK];
+  size_t base = size();
+  for (int16_t xb = begin; xb < end; ++xb)
+  {
+    size_t& f = first[xb - begin];
+    f = 0;
+    for (size_t i = size(); i > 0; --i)
+    {
+      if ((!red || colour(i - 1) == COLOUR_BLACK) && fills(i - 1, xb * 8, y, epd) && ops(i - 1).opaque(command(i - 1), xb * 8, y, epd))
+      {
+        f = i - 1;
+        break;
+      }
+    }
+    base = f < base ? f : base;
+    row[xb] = 0xff;
+    if (red)
+      red[xb] = 0xff;
+  }
+
+  // commands are drawn bottom up across the chunk
+  for (size_t i = base; i < size(); ++i)
+  {
+    const Bounds b = bounds(i, epd);
+    if (!b.contains_row(y))
+      continue;
+
+    const int16_t x0 = b.x0 > begin * 8 ? b.x0 : begin * 8;
+    const int16_t x1 = b.x1 < end * 8 - 1 ? b.x1 : end * 8 - 1;
+    if (x0 > x1)
+      continue;
+
+    if (!red)
+      draw_command(i, row, x0, x1, y, epd, first, begin);
+    else if (colour(i) == COLOUR_RED)
+      draw_command(i, red, x0, x1, y, epd, first, begin);
+    else
+    {
+      erase_red(i, row, red, x0, x1, y, epd, first, begin);
+      draw_command(i, row, x0, x1, y, epd, first, begin);
+    }
+  }
+}
+
+void CommandBufferInterface::draw_command(const size_t at, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd, const size_t* const first, const int16_t begin)
+{
+  const CommandOps& op = ops(at);
+  void* const c = command(at);
+  if (op.draw)
+  {
+    // drawing into a byte with an opaque command above is wasted, but harmless as the opaque command replaces it
+    op.draw(c, row, x0, x1, y, epd);
+    return;
+  }
+
+  for (int16_t xb = x0 >> 3; xb <= x1 >> 3; ++xb)
+  {
+    if (at < first[xb - begin])
+      continue;
+
+    const int16_t start = x0 > xb * 8 ? x0 : xb * 8;
+    const int16_t stop = x1 < xb * 8 + 7 ? x1 : xb * 8 + 7;
+    uint8_t data = row[xb];
+    for (int16_t x = start; x <= stop; ++x)
+      data = op.process(c, data, x, y, epd);
+    row[xb] = keep(row[xb], data, start - xb * 8, stop - xb * 8);
+  }
+}
+
+void CommandBufferInterface::erase_red(const size_t at, uint8_t* const row, uint8_t* const red, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd, const size_t* const first, const int16_t begin)
+{
+  const int16_t b0 = x0 >> 3;
+  const int16_t b1 = x1 >> 3;
+
+  // most black commands have no red beneath them
+  bool any = false;
+  for (int16_t xb = b0; xb <= b1; ++xb)
+    any |= red[xb] != 0xff;
+  if (!any)
+    return;
+
+  // draw the command over white and over black, the pixels it paints come out the same
+  uint8_t saved[CHUNK];
+  uint8_t white[CHUNK];
+  memcpy(saved, &row[b0], b1 - b0 + 1);
+  memset(&row[b0], 0xff, b1 - b0 + 1);
+  draw_command(at, row, x0, x1, y, epd, first, begin);
+  memcpy(white, &row[b0], b1 - b0 + 1);
+  memset(&row[b0], 0x00, b1 - b0 + 1);
+  draw_command(at, row, x0, x1, y, epd, first, begin);
+  for (int16_t xb = b0; xb <= b1; ++xb)
+    red[xb] |= ~(white[xb - b0] ^ row[xb]);
+  memcpy(&row[b0], saved, b1 - b0 + 1);
+}
+
+bool CommandBufferInterface::concurrent(const Display& epd)
+{
+  for (size_t i = 0; i < size(); ++i)
+  {
+    // commands which draw nothing are never rendered
+    if (!bounds(i, epd).empty() && !ops(i).concurrent(command(i), epd))
+      return false;
+  }
+  return true;
+}
+
+uint8_t CommandBufferInterface::render(const int16_t x, const int16_t y, const Display& epd)
+{
+  // find the topmost command which overwrites the whole byte, anything below it can't show through
+  size_t first = 0;
+  for (size_t i = size(); i > 0; --i)
+  {
+    if (fills(i - 1, x, y, epd) && ops(i - 1).opaque(command(i - 1), x, y, epd))
+    {
+      first = i - 1;
+      break;
+    }
+  }
+
+  uint8_t data = 0xff;
+  for (size_t i = first; i < size(); ++i)
+  {
+    const Bounds b = bounds(i, epd);
+    if (!b.contains_row(y) || x > b.x1 || x + 7 < b.x0)
+      continue;
+
+    // only the pixels within the command's bounds need evaluating
+    const int16_t start = b.x0 > x ? b.x0 - x : 0;
+    const int16_t end = b.x1 < x + 7 ? b.x1 - x : 7;
+
+    const CommandOps& op = ops(i);
+    void* const c = command(i);
+    uint8_t drawn = data;
+    for (int16_t xi = start; xi <= end; ++xi)
+      drawn = op.process(c, drawn, x + xi, y, epd);
+    data = keep(data, drawn, start, end);
+  }
+  return data;
+}
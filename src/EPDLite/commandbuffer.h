@@ -0,0 +1,609 @@
+/**
+ * @file commandbuffer.h
+ * @brief ePaper Display Interface command buffer
+ * @ingroup  EPDLite
+ * @addtogroup  EPDLite
+ * \{
+ */
+
+#ifndef EPDLITE_COMMANDBUFFER_H_INCLUDE
+#define EPDLITE_COMMANDBUFFER_H_INCLUDE
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "commands.h"
+
+/**
+ * @brief What a CommandBuffer keeps for each command, besides the command, @see CommandBuffer
+ * @details Combine them with `|`. Each costs RAM for every command the buffer can hold, so they are only kept when asked for.
+ */
+enum BufferOptions
+{
+  BUFFER_PLAIN = 0,  ///< Each command is measured as it is rendered
+  BUFFER_BOUNDS = 1, ///< The bounds of each command are kept when the buffer is prepared, so rendering doesn't measure them again. 8 bytes a command, needed for clips
+  BUFFER_COLOUR = 2  ///< The colour each command is pushed with is kept, otherwise every command is black. 1 byte a command
+};
+
+/**
+ * @brief Public interface to the @see CommandBuffer
+ * @details Provides a public interface to the CommandBuffer to allow polymorphic use of CommandBuffer with template values
+ */
+class CommandBufferInterface
+{
+public:
+  CommandBufferInterface() : frame(NO_FRAME), moved({0, 0}), area({INT16_MIN, INT16_MIN, INT16_MAX, INT16_MAX}), kept(nullptr)
+  {
+  }
+
+  /**
+   * @brief The current number of commands stored in this buffer
+   * @return size
+   */
+  virtual size_t size() const = 0;
+  /**
+   * @brief The maximum number of commands that can be stored in this buffer (i.e., TCommandSize it was created with).
+   * @return capacity
+   */
+  virtual size_t capacity() const = 0;
+
+  /**
+   * @brief Removed a command from the end of the buffer
+   * @details No operation if there is no command to remove
+   */
+  virtual void pop() = 0;
+
+  /**
+   * @brief Removes every command from the buffer and empties the string arena
+   */
+  virtual void clear() = 0;
+
+  /**
+   * @brief The number of bytes left in the string arena
+   */
+  virtual size_t strings_free() const = 0;
+
+  /**
+   * @brief Copies some text into the string arena
+   * @details Text in the arena lives as long as the buffer, or until it is cleared, so text pushed with commands doesn't need to outlive the call.
+   *
+   * @param text The text to copy
+   * @return The copy, or an empty string if the arena is full
+   */
+  const char* copy(const char* const text);
+
+  /**
+   * @brief Formats an integer into the string arena
+   *
+   * @param value The value to format
+   * @param suffix Text to append, such as a unit, or nullptr
+   * @return The text, or an empty string if the arena is full
+   */
+  const char* format_int(const int32_t value, const char* const suffix = nullptr);
+
+  /**
+   * @brief Formats a fixed point number into the string arena
+   * @details The value is a whole number of `10^-decimals`, so `format_fixed(-215, 1)` is "-21.5".
+   *
+   * @param value The value to format
+   * @param decimals The number of digits in the value after the decimal point. Only 9 are shown, the value is rounded to them
+   * @param suffix Text to append, such as a unit, or nullptr
+   * @return The text, or an empty string if the arena is full
+   */
+  const char* format_fixed(const int32_t value, const uint8_t decimals, const char* const suffix = nullptr);
+
+  /**
+   * @brief Formats a floating point number into the string arena
+   * @details The value is rounded to `precision` digits after the decimal point. Values too large to format are "ovf", and NaN is "nan".
+   *
+   * @param value The value to format
+   * @param precision The number of digits after the decimal point, more than 9 are shown as 9
+   * @param suffix Text to append, such as a unit, or nullptr
+   * @return The text, or an empty string if the arena is full
+   */
+  const char* format_float(const float value, const uint8_t precision, const char* const suffix = nullptr);
+
+  virtual uint8_t process(const size_t at, const uint8_t input, const int16_t x, const int16_t y, const Display& epd) = 0;
+
+  /**
+   * @brief Result of rendering a row, @see render_row
+   */
+  enum RowState
+  {
+    BLANK_ROW,    ///< No command draws on the row, the row buffer was not written to
+    REPEATED_ROW, ///< The row is identical to the previous row, the row buffer was not written to
+    DRAWN_ROW     ///< The row buffer holds the rendered row
+  };
+
+  /**
+   * @brief Prepares the commands for rendering
+   * @details Calculates where on the display each command can draw, must be called before rendering after commands are added or the orientation changes. The bounds are kept with BUFFER_BOUNDS, otherwise each command is measured as it is rendered.
+   */
+  void prepare(const Display& epd);
+
+  /**
+   * @brief Renders a row of the display
+   * @details Rows which no command draws on, and rows which every command draws the same as the row above, are detected without evaluating any pixels.
+   *
+   * @param row The row buffer, at least `stride` bytes
+   * @param y The row to render
+   * @param stride The number of bytes in the row
+   * @param sequential True if `row` holds row `y - 1` from the previous call, allows REPEATED_ROW to be returned
+   * @return How the row was rendered
+   */
+  RowState render_row(uint8_t* const row, const int16_t y, const int16_t stride, const bool sequential, const Display& epd);
+
+  /**
+   * @brief Renders a row of both planes of a tri-colour display
+   * @details The planes are rendered together in one pass over the commands. Commands are drawn on the plane of their colour. Where a black command paints a pixel whatever was beneath it, as shapes drawn with DRAW_SET or DRAW_CLEAR and text do, red beneath it is removed; XOR and inverted shapes only change their own plane.
+   *
+   * @param row The black row buffer, at least `stride` bytes
+   * @param red The red row buffer, at least `stride` bytes. 0 is red, as 0 is black in the black plane, so invert it for displays which use 1 for red
+   * @param y The row to render
+   * @param stride The number of bytes in the row
+   * @param sequential True if `row` and `red` hold row `y - 1` from the previous call, allows REPEATED_ROW to be returned
+   * @return How the row was rendered, for both planes
+   */
+  RowState render_row(uint8_t* const row, uint8_t* const red, const int16_t y, const int16_t stride, const bool sequential, const Display& epd);
+
+  /**
+   * @brief Whether rows of the prepared buffer can be rendered on several threads at once
+   * @details Each row is then rendered without changing the buffer, so rows can be rendered in any order. Otherwise rows must be rendered in order from one thread, @see Command::concurrent
+   */
+  bool concurrent(const Display& epd);
+
+  /**
+   * @brief Renders 8 pixels of the display
+   * @details Commands are evaluated from the topmost command that fully overwrites the byte, commands beneath it cannot show through and are skipped.
+   *
+   * @param x The x position of the first pixel, must be a multiple of 8
+   * @param y The y position of the pixels
+   * @return The 8 pixels
+   */
+  uint8_t render(const int16_t x, const int16_t y, const Display& epd);
+
+  /**
+   * @brief The maximum amount of memory used for a single basic command.
+   * @details The default TCommandSize of a CommandBuffer, which fits pixels, lines, rectangles, circles, text and buffers. Buffers holding other commands need max_size_all(), or the size of the largest command they hold.
+   */
+  static constexpr size_t max_size() {
+    return max_sizeof<
+      PixelCommand,
+      LineCommand,
+      RectCommand,
+      CircleCommand,
+      TextCommand,
+      BufferCommand
+    >();
+  }
+
+  /**
+   * @brief The maximum amount of memory used for a single command of any type.
+   * @details When constructing an instance of CommandBuffer, this can be used for TCommandSize.
+   */
+  static constexpr size_t max_size_all() {
+    return max_sizeof<
+      PixelCommand,
+      LineCommand,
+      RectCommand,
+      CircleCommand,
+      ArcCommand,
+      PolygonCommand,
+      TriangleCommand,
+      TextCommand,
+      TextBlockCommand,
+      StrokeTextCommand,
+      BufferCommand,
+      CompressedBufferCommand,
+      ClipCommand,
+      GroupCommand
+    >();
+  }
+
+protected:
+  /**
+   * @brief The stored command data
+   *
+   * @param at The command in the buffer
+   */
+  virtual void* command(const size_t at) = 0;
+
+  /**
+   * @brief The dispatch table for a stored command
+   *
+   * @param at The command in the buffer
+   */
+  virtual const CommandOps& ops(const size_t at) const = 0;
+
+  /**
+   * @brief The region of the display a stored command can draw on
+   * @details Kept by prepare with BUFFER_BOUNDS, otherwise measured from the command.
+   *
+   * @param at The command in the buffer
+   */
+  Bounds bounds(const size_t at, const Display& epd)
+  {
+    return kept ? kept[at] : measure(at, epd);
+  }
+
+  /**
+   * @brief The bounds kept for each command, or nullptr without BUFFER_BOUNDS
+   */
+  virtual Bounds* kept_bounds() = 0;
+
+  /**
+   * @brief The colour a stored command is drawn in
+   * @details Black without BUFFER_COLOUR.
+   *
+   * @param at The command in the buffer
+   */
+  virtual Colour colour(const size_t at) const = 0;
+
+  /**
+   * @brief Reserves space in the string arena
+   *
+   * @param size The number of bytes
+   * @return The space, or nullptr if the arena is full
+   */
+  virtual char* allocate(const size_t size) = 0;
+
+  /**
+   * @brief The number of bytes stored for each command
+   */
+  virtual size_t command_size() const = 0;
+
+  /**
+   * @brief The position of the innermost clip which hasn't ended, or size() if there isn't one
+   */
+  size_t open_clip();
+
+  /**
+   * @brief Moves the commands back to where they were pushed, if a group has moved them
+   */
+  void home()
+  {
+    if (moved.x || moved.y)
+      move_to({0, 0});
+  }
+
+private:
+  friend class GroupCommand;
+
+  /**
+   * @brief Marks a buffer which hasn't been prepared as the fragment of a group
+   */
+  static const uint8_t NO_FRAME = 0xff;
+
+  /**
+   * @brief The orientation of the view the buffer was last prepared for as a fragment of a group, @see GroupCommand
+   */
+  uint8_t frame;
+
+  /**
+   * @brief How far the commands have been moved from where they were pushed, by the group drawing the buffer as its fragment
+   */
+  Vertex moved;
+
+  /**
+   * @brief Moves every command so they are `to` from where they were pushed
+   */
+  void move_to(const Vertex& to);
+
+  /**
+   * @brief The area the buffer was last prepared within, measured bounds are clipped to it
+   */
+  Bounds area;
+
+  /**
+   * @brief The bounds kept for each command, found when the buffer is prepared, or nullptr to measure them
+   */
+  Bounds* kept;
+
+  /**
+   * @brief Measures the region of the display a stored command can draw on, within the area
+   */
+  Bounds measure(const size_t at, const Display& epd);
+
+  /**
+   * @brief Prepares the commands for rendering, clipped to area rather than the display
+   */
+  void prepare_within(const Display& epd, const Bounds& area);
+
+  /**
+   * @brief Stores length bytes of text followed by a suffix in the string arena
+   */
+  const char* store(const char* const text, const size_t length, const char* const suffix);
+
+  /**
+   * @brief Formats a magnitude with a decimal point before the last `decimals` digits into the string arena
+   */
+  const char* store_fixed(const bool negative, uint32_t magnitude, const uint8_t decimals, const char* const suffix);
+
+  /**
+   * @brief The number of bytes of a row rendered together, commands with a DrawSpan draw across all of them at once
+   */
+  static const int16_t CHUNK = 8;
+
+  /**
+   * @brief Renders bytes begin to end (exclusive) of row y, at most CHUNK bytes
+   * @details With a red row, both planes are rendered, otherwise every command is drawn on row.
+   */
+  void render_chunk(uint8_t* const row, uint8_t* const red, const int16_t begin, const int16_t end, const int16_t y, const Display& epd);
+
+  /**
+   * @brief Draws command at onto pixels x0 to x1 of row y, within the chunk starting at byte begin
+   *
+   * @param first For each byte of the chunk, the topmost command which overwrites it
+   */
+  void draw_command(const size_t at, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd, const size_t* const first, const int16_t begin);
+
+  /**
+   * @brief Removes the red from pixels x0 to x1 of row y which black command at paints over
+   * @details The pixels it paints are those it draws the same whether they were black or white beneath it.
+   */
+  void erase_red(const size_t at, uint8_t* const row, uint8_t* const red, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd, const size_t* const first, const int16_t begin);
+
+  /**
+   * @brief Whether a command can draw on all of the 8 pixels starting at (x, y)
+   * @details Only then can it overwrite the byte, a command clipped part way through a byte leaves the rest of it as it is.
+   */
+  bool fills(const size_t at, const int16_t x, const int16_t y, const Display& epd)
+  {
+    const Bounds b = bounds(at, epd);
+    return b.contains_row(y) && x >= b.x0 && x + 7 <= b.x1;
+  }
+
+  /**
+   * @brief Takes pixels first to last of a byte from drawn, and the rest from before
+   * @details Commands which produce whole bytes, such as buffers, would otherwise draw outside of their clipped bounds.
+   */
+  static uint8_t keep(const uint8_t before, const uint8_t drawn, const int16_t first, const int16_t last)
+  {
+    const uint8_t mask = (0xff >> first) & (0xff << (7 - last));
+    return (drawn & mask) | (before & ~mask);
+  }
+
+  template <typename T>
+  static constexpr T static_max(T a, T b)
+  {
+    return a < b ? b : a;
+  }
+
+  template <typename T, typename... Ts>
+  static constexpr T static_max(T a, Ts... bs)
+  {
+    return static_max(a, static_max(bs...));
+  }
+
+  template <typename... Ts>
+  static constexpr size_t max_sizeof()
+  {
+    return static_max(sizeof(Ts)...);
+  }
+};
+
+/**
+ * @brief A buffer to store commands to render
+ * @details The buffer is statically allocated on the stack, commands can be pushed into the buffer to be rendered on the display
+ *
+ * Text for commands can be copied or formatted into a string arena held in the buffer, @see copy
+ *
+ * Each command takes TCommandSize bytes and a pointer, and BufferOptions add to that.
+ *
+ * @tparam TCommandCount The maximum number of commands allowed in this buffer.
+ * @tparam TCommandSize The maximum size of a command allowed in this buffer. Defaults to CommandBufferInterface::max_size(), which fits the basic commands, use CommandBufferInterface::max_size_all() for any command, or smaller values for memory reduction.
+ * @tparam TStringSize The number of bytes in the string arena, including each string's terminator.
+ * @tparam TOptions What is kept for each command besides the command, BufferOptions combined with `|`.
+ */
+template <size_t TCommandCount, size_t TCommandSize = CommandBufferInterface::max_size(), size_t TStringSize = 0, uint8_t TOptions = BUFFER_PLAIN>
+class CommandBuffer : public CommandBufferInterface
+{
+public:
+  CommandBuffer() : CommandBufferInterface(), count(0), used(0), depth(0), offset({0, 0})
+  {
+  }
+
+  /**
+   * @brief The most translations which can be nested, @see push_translate
+   */
+  static const uint8_t TRANSLATE_DEPTH = 4;
+
+  /**
+   * @brief The current number of commands stored in this buffer
+   * @return size
+   */
+  virtual size_t size() const { return count; }
+  /**
+   * @brief The maximum number of commands that can be stored in this buffer (i.e., TCommandSize it was created with).
+   * @return capacity
+   */
+  virtual size_t capacity() const { return TCommandCount; }
+
+  /**
+   * @brief Add a command to the buffer
+   * @details Pushes a command onto the end of the buffer
+   *
+   * @tparam TCommand The type of command to push
+   * @param command
+   * @param colour The colour to draw the command in on a tri-colour display, kept with BUFFER_COLOUR. A group is drawn in its own colour, whatever the colours of its fragment
+   */
+  template <typename TCommand>
+  void push(TCommand command, const Colour colour = COLOUR_BLACK)
+  {
+    static_assert(sizeof(TCommand) <= TCommandSize, "Pushed command is bigger. Increase TCommandSize, CommandBufferInterface::max_size_all() fits every command.");
+
+    if (count >= TCommandCount)
+      return; // need to handle this somehow?
+
+    // the commands already pushed may have been moved by a group drawing this buffer
+    home();
+
+    if (offset.x || offset.y)
+      TCommand::translate(&command, offset.x, offset.y);
+
+    memcpy(&commands[TCommandSize * count], &command, sizeof(TCommand));
+    // until prepared, treat the command as able to draw anywhere
+    if (TOptions & BUFFER_BOUNDS)
+      bounds_table[count] = {INT16_MIN, INT16_MIN, INT16_MAX, INT16_MAX};
+    if (TOptions & BUFFER_COLOUR)
+      colour_table[count] = colour;
+    op_table[count++] = &CommandTraits<TCommand>::ops;
+  }
+
+  /**
+   * @brief Removed a command from the end of the buffer
+   * @details No operation if there is no command to remove
+   */
+  virtual void pop()
+  {
+    if (count > 0)
+      --count;
+  }
+
+  /**
+   * @brief Removes every command from the buffer, empties the string arena, and ends any translations
+   */
+  virtual void clear()
+  {
+    home();
+    count = 0;
+    used = 0;
+    depth = 0;
+    offset = {0, 0};
+  }
+
+  /**
+   * @brief Moves the commands pushed from now on by (dx, dy), until pop_translate
+   * @details Translations nest, adding to the translations they are within. Commands are moved as they are pushed, so a translation costs nothing to render and doesn't use a place in the buffer.
+   *
+   * @param dx Distance to move right
+   * @param dy Distance to move down
+   * @return false if translations are already nested TRANSLATE_DEPTH deep, the translation is ignored
+   */
+  bool push_translate(const int16_t dx, const int16_t dy)
+  {
+    if (depth >= TRANSLATE_DEPTH)
+      return false;
+
+    translations[depth++] = {dx, dy};
+    offset.x += dx;
+    offset.y += dy;
+    return true;
+  }
+
+  /**
+   * @brief Ends the innermost translation
+   * @details No operation if there is no translation to end
+   */
+  void pop_translate()
+  {
+    if (depth == 0)
+      return;
+
+    --depth;
+    offset.x -= translations[depth].x;
+    offset.y -= translations[depth].y;
+  }
+
+  /**
+   * @brief Clips the commands pushed from now on to a rectangle, until pop_clip
+   * @details Clips nest, a clip within another only draws where both allow. The clip is moved by the current translation, and uses a place in the buffer.
+   * When the buffer is prepared, commands outside of the clip are skipped entirely and the rest are only evaluated within it, @see ClipCommand. The buffer must keep BUFFER_BOUNDS
+   *
+   * @param x X position of the top left of the rectangle
+   * @param y Y position of the top left of the rectangle
+   * @param width Width of the rectangle
+   * @param height Height of the rectangle
+   */
+  void push_clip(const int16_t x, const int16_t y, const int16_t width, const int16_t height)
+  {
+    static_assert(TOptions & BUFFER_BOUNDS, "Clips are kept in the bounds of the commands within them. Use BUFFER_BOUNDS.");
+    push(ClipCommand(x, y, width, height));
+  }
+
+  /**
+   * @brief Ends the innermost clip
+   * @details Uses a place in the buffer. No operation if there is no clip to end
+   */
+  void pop_clip()
+  {
+    const size_t start = open_clip();
+    if (start < count)
+      push(ClipCommand(start));
+  }
+
+  /**
+   * @brief The number of bytes left in the string arena
+   */
+  virtual size_t strings_free() const { return TStringSize - used; }
+
+  /**
+   * @brief Dispatches the process to the correct command instance.
+   *
+   * @param at The command in the buffer to run
+   * @param input The current 8 pixel screen data
+   * @param x The x position of the pixel data
+   * @param y The y position of the pixel data
+   * @return The modified 8 pixels
+   */
+  virtual uint8_t process(const size_t at, const uint8_t input, const int16_t x, const int16_t y, const Display& epd) override
+  {
+    return op_table[at]->process(command(at), input, x, y, epd);
+  }
+
+protected:
+  virtual void* command(const size_t at) override
+  {
+    return &commands[at * TCommandSize];
+  }
+
+  virtual const CommandOps& ops(const size_t at) const override
+  {
+    return *op_table[at];
+  }
+
+  virtual Bounds* kept_bounds() override
+  {
+    return TOptions & BUFFER_BOUNDS ? bounds_table : nullptr;
+  }
+
+  virtual Colour colour(const size_t at) const override
+  {
+    return TOptions & BUFFER_COLOUR ? static_cast<Colour>(colour_table[at]) : COLOUR_BLACK;
+  }
+
+  virtual size_t command_size() const override
+  {
+    return TCommandSize;
+  }
+
+  virtual char* allocate(const size_t size) override
+  {
+    if (size > TStringSize - used)
+      return nullptr;
+
+    char* const space = &strings[used];
+    used += size;
+    return space;
+  }
+
+private:
+  const CommandOps* op_table[TCommandCount];
+  Bounds bounds_table[TOptions & BUFFER_BOUNDS ? TCommandCount : 1];
+  uint8_t colour_table[TOptions & BUFFER_COLOUR ? TCommandCount : 1]; // a byte rather than the enum, which is an int on AVR
+
+  uint8_t commands[TCommandCount * TCommandSize];
+  size_t count;
+
+  char strings[TStringSize ? TStringSize : 1];
+  size_t used;
+
+  Vertex translations[TRANSLATE_DEPTH];
+  uint8_t depth;
+  Vertex offset; // the sum of the translations
+};
+
+#endif
+
+/* \} */
@@ -6,12 +6,15 @@
 #include "EPDLite.h"
 #endif
 
+#include "commandbuffer.h"
 #include "font.h"
+#include "packedfont.h"
+#include "raster.h"
+#include "strokefont.h"
 
-#include <math.h>
 #include <stdlib.h>
 
-int16_t orientate_x(const int16_t x, const int16_t y, const EPDLite& epd)
+int16_t orientate_x(const int16_t x, const int16_t y, const Display& epd)
 {
   switch (epd.getOrientation())
   {
@@ -27,7 +30,7 @@ int16_t orientate_x(const int16_t x, const int16_t y, const EPDLite& epd)
   return x;
 }
 
-int16_t orientate_y(const int16_t x, const int16_t y, const EPDLite& epd)
+int16_t orientate_y(const int16_t x, const int16_t y, const Display& epd)
 {
   switch (epd.getOrientation())
   {
@@ -44,7 +47,150 @@ int16_t orientate_y(const int16_t x, const int16_t y, const EPDLite& epd)
 }
 
 
-uint8_t PixelCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const EPDLite& epd)
+// Packed text is drawn in its own coordinates, u along the text and v down the glyphs, each row of the display is either a row of the text or a column of it
+
+// draws row v of the glyphs from text to end, the first glyph starts at x and the text runs right (step 1) or left (step -1, rotated half a turn)
+static void packed_row(const PackedFont& font, const char* const text, const char* const end, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t x, const int16_t step, const int16_t v)
+{
+  if (v < 0 || v >= font.height)
+    return;
+
+  int16_t cu = 0;
+  for (const char* p = text; p < end && *p;)
+  {
+    Glyph glyph;
+    if (!font.next(p, glyph))
+      continue;
+
+    const int16_t gx = x + step * cu;
+    if (step > 0)
+    {
+      if (gx > x1)
+        break;
+      if (glyph.width)
+        blit_span(row, x0, x1, gx, font.row(glyph, v), glyph.width, true);
+    }
+    else
+    {
+      if (gx < x0)
+        break;
+      for (int16_t c = 0; c < glyph.width; ++c)
+      {
+        const int16_t px = gx - c;
+        if (px >= x0 && px <= x1 && font.ink(glyph, v, c))
+          row[px >> 3] &= ~(1 << (7 - px % 8));
+      }
+    }
+    cu += glyph.advance;
+  }
+}
+
+// draws column u of the text from text to end, pixel v of the glyphs is drawn at base + step * v
+static void packed_column(const PackedFont& font, const char* const text, const char* const end, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t u, const int16_t base, const int16_t step)
+{
+  int16_t cu = 0;
+  for (const char* p = text; p < end && *p && cu <= u;)
+  {
+    Glyph glyph;
+    if (!font.next(p, glyph))
+      continue;
+
+    const int16_t c = u - cu;
+    cu += glyph.advance;
+    if (c >= glyph.width)
+      continue;
+
+    for (int16_t v = 0; v < font.height; ++v)
+    {
+      const int16_t px = base + step * v;
+      if (px >= x0 && px <= x1 && font.ink(glyph, v, c))
+        row[px >> 3] &= ~(1 << (7 - px % 8));
+    }
+  }
+}
+
+// the position within text placed at (ox, oy) of the display pixel (x, y), the inverse of orientate_x and orientate_y
+static void text_position(const int16_t x, const int16_t y, const int16_t ox, const int16_t oy, const Display& epd, int16_t& u, int16_t& v)
+{
+  switch (epd.getOrientation())
+  {
+    case 1:
+      u = y - ox;
+      v = epd.width - x - oy;
+      return;
+    case 2:
+      u = epd.width - x - ox;
+      v = epd.height - y - oy;
+      return;
+    case 3:
+      u = epd.height - y - ox;
+      v = x - oy;
+      return;
+  }
+  u = x - ox;
+  v = y - oy;
+}
+
+// the display bounds of a length by height area of text placed at (ox, oy)
+static Bounds text_bounds(const int16_t ox, const int16_t oy, const int16_t length, const int16_t height, const Display& epd)
+{
+  const int16_t l = length - 1;
+  const int16_t h = height - 1;
+  switch (epd.getOrientation())
+  {
+    case 1:
+      return {static_cast<int16_t>(epd.width - oy - h), ox, static_cast<int16_t>(epd.width - oy), static_cast<int16_t>(ox + l)};
+    case 2:
+      return {static_cast<int16_t>(epd.width - ox - l), static_cast<int16_t>(epd.height - oy - h), static_cast<int16_t>(epd.width - ox), static_cast<int16_t>(epd.height - oy)};
+    case 3:
+      return {oy, static_cast<int16_t>(epd.height - ox - l), static_cast<int16_t>(oy + h), static_cast<int16_t>(epd.height - ox)};
+  }
+  return {ox, oy, static_cast<int16_t>(ox + l), static_cast<int16_t>(oy + h)};
+}
+
+// whether pixel (u, v) of the line of text from begin to end is drawn, resuming from walk, an offset from base, when it is on the line and not past u
+static bool packed_ink(const PackedFont& font, const char* const base, const char* const begin, const char* const end, const int16_t u, const int16_t v, TextWalk& walk)
+{
+  if (u < 0 || v < 0 || v >= font.height)
+    return false;
+
+  const char* p = begin;
+  int16_t cu = 0;
+  if (base + walk.at >= begin && base + walk.at < end && walk.pen <= u)
+  {
+    p = base + walk.at;
+    cu = walk.pen;
+  }
+
+  // the walk can only move past glyphs which end by the next one's pen position
+  bool settled = true;
+  while (p < end && *p && cu <= u)
+  {
+    if (settled)
+      walk = {static_cast<int16_t>(p - base), cu};
+
+    Glyph glyph;
+    if (!font.next(p, glyph))
+      continue;
+
+    // glyphs can be wider than their advance, so keep looking once one is found without ink
+    if (u - cu < glyph.width && font.ink(glyph, v, u - cu))
+      return true;
+    settled &= glyph.width <= glyph.advance;
+    cu += glyph.advance;
+  }
+  return false;
+}
+
+Bounds Command::bounds(void* command, const Display& epd)
+{
+  (void)command;
+
+  return {0, 0, static_cast<int16_t>(epd.width - 1), static_cast<int16_t>(epd.height - 1)};
+}
+
+
+uint8_t PixelCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd)
 {
   PixelCommand* pc = (PixelCommand*)command;
 
@@ -52,45 +198,115 @@ uint8_t PixelCommand::process(void* command, const uint8_t input, const int16_t
   const int16_t ty = orientate_y(pc->_x, pc->_y, epd);
 
   if (tx == x && ty == y)
-    return input & ~(1 << (7 - (x % 8)));
+    return pc->style.apply(input, 1 << (7 - (x % 8)), y);
 
   return input;
 }
 
-uint8_t LineCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const EPDLite& epd)
+Bounds PixelCommand::bounds(void* command, const Display& epd)
+{
+  PixelCommand* pc = (PixelCommand*)command;
+
+  const int16_t tx = orientate_x(pc->_x, pc->_y, epd);
+  const int16_t ty = orientate_y(pc->_x, pc->_y, epd);
+
+  return {tx, ty, tx, ty};
+}
+
+void PixelCommand::translate(void* command, const int16_t dx, const int16_t dy)
+{
+  PixelCommand* pc = (PixelCommand*)command;
+
+  pc->_x += dx;
+  pc->_y += dy;
+}
+
+uint8_t LineCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd)
 {
   LineCommand* lc = (LineCommand*)command;
 
-  const int16_t tx0 = orientate_x(lc->_x0, lc->_y0, epd);
-  const int16_t ty0 = orientate_y(lc->_x0, lc->_y0, epd);
-  const int16_t tx1 = orientate_x(lc->_x1, lc->_y1, epd);
-  const int16_t ty1 = orientate_y(lc->_x1, lc->_y1, epd);
+  // the ends of the line in order, orientation can swap them
+  const Bounds b = bounds(command, epd);
 
   // horizontal line
-  if (ty0 == ty1 && ty0 == y)
+  if (b.y0 == b.y1 && b.y0 == y)
   {
-    if (x < tx0)
+    if (x < b.x0)
       return input;
-    else if (x > tx1)
+    else if (x > b.x1)
       return input;
 
-    return input & ~(1 << (7 - (x % 8)));
+    return lc->style.apply(input, 1 << (7 - (x % 8)), y);
   }
   // vertical line
-  else if (tx0 == tx1 && tx0 == x)
+  else if (b.x0 == b.x1 && b.x0 == x)
   {
-    if (y < ty0)
+    if (y < b.y0)
       return input;
-    if (y > ty1)
+    if (y > b.y1)
       return input;
 
-    return input & ~(1 << (7 - (x % 8)));
+    return lc->style.apply(input, 1 << (7 - (x % 8)), y);
   }
 
   return input;
 }
 
-uint8_t RectCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const EPDLite& epd)
+Bounds LineCommand::bounds(void* command, const Display& epd)
+{
+  LineCommand* lc = (LineCommand*)command;
+
+  const int16_t tx0 = orientate_x(lc->_x0, lc->_y0, epd);
+  const int16_t ty0 = orientate_y(lc->_x0, lc->_y0, epd);
+  const int16_t tx1 = orientate_x(lc->_x1, lc->_y1, epd);
+  const int16_t ty1 = orientate_y(lc->_x1, lc->_y1, epd);
+
+  return {
+    tx0 < tx1 ? tx0 : tx1,
+    ty0 < ty1 ? ty0 : ty1,
+    tx0 < tx1 ? tx1 : tx0,
+    ty0 < ty1 ? ty1 : ty0
+  };
+}
+
+void LineCommand::translate(void* command, const int16_t dx, const int16_t dy)
+{
+  LineCommand* lc = (LineCommand*)command;
+
+  lc->_x0 += dx;
+  lc->_y0 += dy;
+  lc->_x1 += dx;
+  lc->_y1 += dy;
+}
+
+bool LineCommand::repeats(void* command, const int16_t y, const Display& epd)
+{
+  LineCommand* lc = (LineCommand*)command;
+  (void)epd;
+
+  // a horizontal line is only one row tall, so two rows within the bounds means it's vertical (or not drawn at all)
+  return lc->style.repeats(y);
+}
+
+void LineCommand::draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd)
+{
+  LineCommand* lc = (LineCommand*)command;
+
+  const Bounds b = bounds(command, epd);
+
+  // as process, the span is within the bounds so only the ends of the line need checking
+  if (b.y0 == b.y1 && b.y0 == y)
+  {
+    const int16_t s0 = b.x0 > x0 ? b.x0 : x0;
+    const int16_t s1 = b.x1 < x1 ? b.x1 : x1;
+    if (s0 <= s1)
+      fill_span(row, s0, s1, y, lc->style);
+  }
+  else if (b.x0 == b.x1 && b.x0 >= x0 && b.x0 <= x1 && y >= b.y0 && y <= b.y1)
+    row[b.x0 >> 3] = lc->style.apply(row[b.x0 >> 3], 0x80 >> (b.x0 & 7), y);
+}
+
+uint8_t RectCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd)
 {
   RectCommand* rc = (RectCommand*)command;
 
@@ -104,190 +320,1399 @@ uint8_t RectCommand::process(void* command, const uint8_t input, const int16_t x
     if (y < ty || y > ty + (epd.getOrientation() % 2 ? rc->_w : rc->_h))
       return input;
 
-    return input & ~(1 << (7 - (x % 8)));
+    return rc->style.apply(input, 1 << (7 - (x % 8)), y);
   }
   else
   {
     if ((x == tx || x == tx + rc->_w) && (y >= ty && y <= ty + rc->_h))
-      return input & ~(1 << (7 - (x % 8)));
+      return rc->style.apply(input, 1 << (7 - (x % 8)), y);
     if ((y == ty || y == ty + rc->_h) && (x >= tx && x <= tx + rc->_w))
-      return input & ~(1 << (7 - (x % 8)));
+      return rc->style.apply(input, 1 << (7 - (x % 8)), y);
   }
   return input;
 }
 
-uint8_t CircleCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const EPDLite& epd)
+bool RectCommand::opaque(void* command, const int16_t x, const int16_t y, const Display& epd)
 {
-  CircleCommand* cc = (CircleCommand*)command;
-
-  const int16_t tx = orientate_x(cc->_x, cc->_y, epd);
-  const int16_t ty = orientate_y(cc->_x, cc->_y, epd);
+  RectCommand* rc = (RectCommand*)command;
 
-  // if we're too far out, don't even consider it
-  if (abs(x - tx) > cc->radius + 1)
-    return input;
+  if (!rc->f || !rc->style.opaque())
+    return false;
 
-  if (abs(y - ty) > cc->radius + 1)
-    return input;
+  const int16_t tx = orientate_x(rc->_x, rc->_y, epd);
+  const int16_t ty = orientate_y(rc->_x, rc->_y, epd);
 
-  const float dist = static_cast<float>(x - tx) * static_cast<float>(x - tx) + static_cast<float>(y - ty) * static_cast<float>(y - ty);
-  if (cc->f)
-  {
-    const float rsq = static_cast<float>(cc->radius) * static_cast<float>(cc->radius);
-    if (dist <= rsq)
-      return input & ~(1 << (7 - (x % 8)));
-  }
-  else
-  {
-    if (cc->radius == floor(sqrt(dist) + 0.5f))
-      return input & ~(1 << (7 - (x % 8)));
-  }
+  if (y < ty || y > ty + (epd.getOrientation() % 2 ? rc->_w : rc->_h))
+    return false;
 
-  return input;
+  return x >= tx && x + 7 <= tx + (epd.getOrientation() % 2 ? rc->_h : rc->_w);
 }
 
-int16_t _index(const int16_t x, const int16_t y, const int16_t tx, const int16_t ty, const EPDLite& epd)
+Bounds RectCommand::bounds(void* command, const Display& epd)
 {
-  switch (epd.getOrientation())
-  {
-    case 0:
-      return x - tx;
-    case 1:
-      return y - ty;
-    case 2:
-      return abs(tx - x);
-    case 3:
-      return abs(ty - y);
-  }
-  return 0;
+  RectCommand* rc = (RectCommand*)command;
+
+  const int16_t tx = orientate_x(rc->_x, rc->_y, epd);
+  const int16_t ty = orientate_y(rc->_x, rc->_y, epd);
+
+  if (rc->f && epd.getOrientation() % 2)
+    return {tx, ty, static_cast<int16_t>(tx + rc->_h), static_cast<int16_t>(ty + rc->_w)};
+  return {tx, ty, static_cast<int16_t>(tx + rc->_w), static_cast<int16_t>(ty + rc->_h)};
 }
 
-uint8_t TextCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const EPDLite& epd)
+void RectCommand::translate(void* command, const int16_t dx, const int16_t dy)
 {
-  TextCommand* tc = (TextCommand*)command;
-  const char* const text = tc->txt;
-  const Font& font = tc->fnt;
-
-  const int16_t tx = orientate_x(tc->_x, tc->_y, epd);
-  const int16_t ty = orientate_y(tc->_x, tc->_y, epd);
+  RectCommand* rc = (RectCommand*)command;
 
-  if (tc->out_of_bounds(x, y, tx, ty, epd))
-    return input;
-  // return input & ~(1 << (7- x % 8));
+  rc->_x += dx;
+  rc->_y += dy;
+}
 
-  const int16_t offset = epd.getOrientation() >= 2 ? (font.charwidth + 1) * tc->fontsize * tc->length : 0;
-  const int16_t index = _index(x, y, tx - offset, ty - offset, epd) / ((font.charwidth + 1) * tc->fontsize);
-  if (index >= tc->length)
-    return input;
+bool RectCommand::repeats(void* command, const int16_t y, const Display& epd)
+{
+  RectCommand* rc = (RectCommand*)command;
 
-  const char c = epd.getOrientation() >= 2 ? text[tc->length - 1 - index] : text[index];
+  if (!rc->style.repeats(y))
+    return false;
+  if (rc->f)
+    return true;
 
-  return tc->render_char(input, c, x, y, tx, ty, epd);
+  // only the sides are drawn between the top and bottom edges
+  const int16_t ty = orientate_y(rc->_x, rc->_y, epd);
+  return y - 1 != ty && y != ty + rc->_h;
 }
 
-bool TextCommand::out_of_bounds(const int16_t x, const int16_t y, const int16_t tx, const int16_t ty, const EPDLite& epd)
+void RectCommand::draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd)
 {
-  const Font& font = this->fnt;
+  RectCommand* rc = (RectCommand*)command;
 
-  if (epd.getOrientation() == 0)
+  // the span is already within the bounds, which for a filled rectangle is the whole rectangle
+  if (rc->f)
   {
-    // out of x-bounds
-    if (x < tx || x >= tx + (font.charwidth + 1) * this->fontsize * this->length)
-      return true;
-
-    // out of y-bounds
-    if (y < ty || y > ty + font.charheight * this->fontsize)
-      return true;
+    fill_span(row, x0, x1, y, rc->style);
+    return;
+  }
 
-    // 1px letter spacing
-    if (((x - tx) / this->fontsize + 1) % (font.charwidth + 1) == 0)
-      return true;
+  const int16_t tx = orientate_x(rc->_x, rc->_y, epd);
+  const int16_t ty = orientate_y(rc->_x, rc->_y, epd);
+  if (y == ty || y == ty + rc->_h)
+  {
+    fill_span(row, x0, x1, y, rc->style);
+    return;
   }
-  else if (epd.getOrientation() == 1)
+
+  // the sides
+  const int16_t sides[] = {tx, static_cast<int16_t>(tx + rc->_w)};
+  for (uint8_t i = 0; i < (rc->_w ? 2 : 1); ++i)
   {
-    // out of x-bounds
-    if (x < tx || x > tx + (font.charheight + 1) * this->fontsize)
-      return true;
+    if (sides[i] >= x0 && sides[i] <= x1)
+      row[sides[i] >> 3] = rc->style.apply(row[sides[i] >> 3], 0x80 >> (sides[i] & 7), y);
+  }
+}
 
-    // out of y-bounds
-    if (y < ty || y >= ty + (font.charwidth + 1) * this->fontsize * this->length)
-      return true;
+template <typename F>
+void CircleCommand::spans(const int16_t y, const Display& epd, F emit) const
+{
+  const int16_t tx = orientate_x(_x, _y, epd);
+  const int16_t ty = orientate_y(_x, _y, epd);
+  const int32_t dy = y - ty;
+  const int32_t r = radius;
+  if (dy < -r - 1 || dy > r + 1)
+    return;
 
-    // 1px letter spacing
-    if (((y - ty) / this->fontsize + 1) % (font.charwidth + 1) == 0)
-      return true;
+  if (f)
+  {
+    // pixels within the radius
+    const int32_t rest = r * r - dy * dy;
+    if (rest >= 0)
+    {
+      const int16_t half = isqrt(rest);
+      emit(tx - half, tx + half);
+    }
+    return;
   }
-  if (epd.getOrientation() == 2)
+
+  // pixels whose distance rounds to the radius, (r - 0.5)^2 <= d^2 < (r + 0.5)^2
+  const int32_t outer = r * r + r - dy * dy;
+  if (outer < 0)
+    return;
+  const int16_t out = isqrt(outer);
+  const int32_t inner = r * r - r - dy * dy;
+  if (inner < 0 || r == 0)
   {
-    // out of x-bounds
-    if (x < tx - (font.charwidth + 1) * this->fontsize * this->length || x >= tx)
-      return true;
+    emit(tx - out, tx + out);
+    return;
+  }
+  const int16_t in = isqrt(inner);
+  emit(tx - out, tx - in - 1);
+  emit(tx + in + 1, tx + out);
+}
 
-    // out of y-bounds
-    if (y < ty || y > ty + font.charheight * this->fontsize)
-      return true;
+uint8_t CircleCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd)
+{
+  CircleCommand* cc = (CircleCommand*)command;
 
-    // 1px letter spacing
-    if (((x - tx) / this->fontsize + 1) % (font.charwidth + 1) == 0)
-      return true;
-  }
-  else if (epd.getOrientation() == 3)
-  {
-    // out of x-bounds
-    if (x < tx || x > tx + font.charheight * this->fontsize)
-      return true;
+  bool inside = false;
+  cc->spans(y, epd, [&](const int16_t s0, const int16_t s1) {
+    inside |= s0 <= x && x <= s1;
+  });
 
-    // out of y-bounds
-    if (y < ty - (font.charwidth + 1) * this->fontsize * this->length || y >= ty)
-      return true;
+  if (inside)
+    return cc->style.apply(input, 1 << (7 - x % 8), y);
+  return input;
+}
 
-    // 1px letter spacing
-    if (((y - ty) / this->fontsize + 1) % (font.charwidth + 1) == 0)
-      return true;
+Bounds CircleCommand::bounds(void* command, const Display& epd)
+{
+  CircleCommand* cc = (CircleCommand*)command;
 
-  }
-  return false;
+  const int16_t tx = orientate_x(cc->_x, cc->_y, epd);
+  const int16_t ty = orientate_y(cc->_x, cc->_y, epd);
+  const int16_t r = cc->radius + 1;
+
+  return {static_cast<int16_t>(tx - r), static_cast<int16_t>(ty - r), static_cast<int16_t>(tx + r), static_cast<int16_t>(ty + r)};
 }
 
-uint8_t TextCommand::render_char(const uint8_t input, const char c, const int16_t x, const int16_t y, const int16_t tx, const int16_t ty, const EPDLite& epd)
+void CircleCommand::translate(void* command, const int16_t dx, const int16_t dy)
 {
-  const Font& font = this->fnt;
+  CircleCommand* cc = (CircleCommand*)command;
 
-  const int16_t diff = epd.getOrientation() % 2 ? (y - ty) : (x - tx);
-  const int16_t d = abs((epd.getOrientation() >= 2 ? font.charwidth - 1 : 0) - modp(diff / this->fontsize, font.charwidth + 1));
-  const uint8_t glyph_slice = pgm_read_byte(&(font.charmap[(c - font.mapoffset) * font.charwidth + d]));
+  cc->_x += dx;
+  cc->_y += dy;
+}
 
-  if (epd.getOrientation() == 0)
-  {
-    if ((glyph_slice >> ((y - ty) / fontsize)) & 1)
-      return input & ~(1 << (7 - x % 8));
-  }
-  else if (epd.getOrientation() == 1)
+void CircleCommand::draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd)
+{
+  CircleCommand* cc = (CircleCommand*)command;
+
+  cc->spans(y, epd, [&](const int16_t s0, const int16_t s1) {
+    if (s1 >= x0 && s0 <= x1)
+      fill_span(row, s0 < x0 ? x0 : s0, s1 > x1 ? x1 : s1, y, cc->style);
+  });
+}
+
+// the extent of an arc's sweep, which decides how its wedge is tested
+static const uint8_t ARC_NARROW = 0;
+static const uint8_t ARC_WIDE = 1;
+static const uint8_t ARC_FULL = 2;
+
+ArcCommand::ArcCommand(const int16_t x, const int16_t y, const int16_t inner, const int16_t outer, const int16_t start, const int16_t end, const Style& style) :
+_x(x), _y(y), r0(inner), r1(outer), style(style)
+{
+  const int16_t turn = end - start;
+  const int16_t swept = modp<int16_t>(turn, 360);
+  sweep = turn >= 360 ? ARC_FULL : swept > 180 ? ARC_WIDE : ARC_NARROW;
+
+  // y runs down the display, so anticlockwise directions have negative y
+  int16_t sine, cosine;
+  sin_cos(start, sine, cosine);
+  sx = cosine;
+  sy = -sine;
+  sin_cos(end, sine, cosine);
+  ex = cosine;
+  ey = -sine;
+}
+
+// limits lo to hi to the values of d where a * d >= b
+static void half_plane(const int32_t a, const int32_t b, int16_t& lo, int16_t& hi)
+{
+  if (a == 0)
   {
-    if ((glyph_slice << ((x - tx) / fontsize)) & 0b10000000)
-      return input & ~(1 << (7 - x % 8));
+    if (b > 0)
+      hi = lo - 1;
+    return;
   }
-  else if (epd.getOrientation() == 2)
+
+  // rounded towards negative infinity
+  const int32_t q = b / a - ((b % a != 0) && ((b < 0) != (a < 0)));
+  if (a > 0)
   {
-    if ((glyph_slice << ((y - ty) / fontsize)) & 0b10000000)
-      return input & ~(1 << (7 - x % 8));
+    // d >= b / a, rounded up
+    const int32_t limit = q * a == b ? q : q + 1;
+    if (limit > lo)
+      lo = limit > hi ? hi + 1 : limit;
   }
-  else if (epd.getOrientation() == 3)
+  else
   {
-    if ((glyph_slice >> ((x - tx) / fontsize)) & 1)
-      return input & ~(1 << (7 - x % 8));
+    // dividing by a negative flips the test, d <= b / a rounded down
+    if (q < hi)
+      hi = q < lo ? lo - 1 : q;
   }
-  return input;
 }
 
-uint8_t BufferCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const EPDLite& epd)
+template <typename F>
+void ArcCommand::spans(const int16_t y, const Display& epd, F emit) const
 {
-  BufferCommand* bc = (BufferCommand*)command;
+  const int16_t cx = orientate_x(_x, _y, epd);
+  const int16_t cy = orientate_y(_x, _y, epd);
+  const int32_t dy = y - cy;
+  if (dy < -r1 || dy > r1)
+    return;
 
-  (void)epd;
-  (void)input;
+  // the ring, pixel centres within the outer radius and not within the inner one
+  const int16_t out = isqrt(static_cast<int32_t>(r1) * r1 - dy * dy);
+  const int32_t hole = static_cast<int32_t>(r0) * r0 - dy * dy;
+  const int16_t in = hole > 0 ? isqrt(hole - 1) : -1;
+  const int16_t ring[2][2] = {{static_cast<int16_t>(-out), in < 0 ? out : static_cast<int16_t>(-in - 1)}, {static_cast<int16_t>(in + 1), out}};
+  const uint8_t pieces = in < 0 ? 1 : 2;
 
-  if (bc->mem)
-    return pgm_read_byte(&(bc->buf[y * (bc->w / 8) + x / 8]));
-  return bc->buf[y * (bc->w / 8) + x / 8];
+  const auto piece = [&](const int16_t lo, const int16_t hi) {
+    if (lo <= hi)
+      emit(cx + lo, cx + hi);
+  };
+
+  if (sweep == ARC_FULL)
+  {
+    for (uint8_t i = 0; i < pieces; ++i)
+      piece(ring[i][0], ring[i][1]);
+    return;
+  }
+
+  // the directions, rotated with the display like orientate_x and orientate_y
+  int32_t s0 = sx, s1 = sy, e0 = ex, e1 = ey;
+  switch (epd.getOrientation())
+  {
+    case 1:
+      s0 = -sy; s1 = sx; e0 = -ey; e1 = ex;
+      break;
+    case 2:
+      s0 = -sx; s1 = -sy; e0 = -ex; e1 = -ey;
+      break;
+    case 3:
+      s0 = sy; s1 = -sx; e0 = ey; e1 = -ex;
+      break;
+  }
+
+  int16_t lo = -out;
+  int16_t hi = out;
+  if (sweep == ARC_NARROW)
+  {
+    // anticlockwise of the start and clockwise of the end
+    half_plane(s1, s0 * dy, lo, hi);
+    half_plane(-e1, -e0 * dy, lo, hi);
+    for (uint8_t i = 0; i < pieces; ++i)
+      piece(ring[i][0] > lo ? ring[i][0] : lo, ring[i][1] < hi ? ring[i][1] : hi);
+  }
+  else
+  {
+    // outside the narrow wedge from the end round to the start
+    half_plane(e1, e0 * dy + 1, lo, hi);
+    half_plane(-s1, -s0 * dy + 1, lo, hi);
+    for (uint8_t i = 0; i < pieces; ++i)
+    {
+      if (lo > hi)
+        piece(ring[i][0], ring[i][1]);
+      else
+      {
+        piece(ring[i][0], ring[i][1] < lo - 1 ? ring[i][1] : lo - 1);
+        piece(ring[i][0] > hi + 1 ? ring[i][0] : hi + 1, ring[i][1]);
+      }
+    }
+  }
+}
+
+uint8_t ArcCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd)
+{
+  ArcCommand* ac = (ArcCommand*)command;
+
+  bool inside = false;
+  ac->spans(y, epd, [&](const int16_t s0, const int16_t s1) {
+    inside |= s0 <= x && x <= s1;
+  });
+
+  if (inside)
+    return ac->style.apply(input, 1 << (7 - x % 8), y);
+  return input;
+}
+
+Bounds ArcCommand::bounds(void* command, const Display& epd)
+{
+  ArcCommand* ac = (ArcCommand*)command;
+
+  const int16_t tx = orientate_x(ac->_x, ac->_y, epd);
+  const int16_t ty = orientate_y(ac->_x, ac->_y, epd);
+  const int16_t r = ac->r1;
+
+  return {static_cast<int16_t>(tx - r), static_cast<int16_t>(ty - r), static_cast<int16_t>(tx + r), static_cast<int16_t>(ty + r)};
+}
+
+void ArcCommand::translate(void* command, const int16_t dx, const int16_t dy)
+{
+  ArcCommand* ac = (ArcCommand*)command;
+
+  ac->_x += dx;
+  ac->_y += dy;
+}
+
+void ArcCommand::draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd)
+{
+  ArcCommand* ac = (ArcCommand*)command;
+
+  ac->spans(y, epd, [&](const int16_t s0, const int16_t s1) {
+    if (s1 >= x0 && s0 <= x1)
+      fill_span(row, s0 < x0 ? x0 : s0, s1 > x1 ? x1 : s1, y, ac->style);
+  });
+}
+
+// vertex i of a polygon offset by (ox, oy), in display coordinates
+static Vertex polygon_vertex(const Vertex* const vertices, const uint8_t i, const bool progmem, const int16_t ox, const int16_t oy, const Display& epd)
+{
+  // flash can't be read as RAM on AVR, so vertices in PROGMEM are only read a word at a time
+  const int16_t x = ox + (progmem ? static_cast<int16_t>(pgm_read_word(reinterpret_cast<const uint16_t*>(&vertices[i].x))) : vertices[i].x);
+  const int16_t y = oy + (progmem ? static_cast<int16_t>(pgm_read_word(reinterpret_cast<const uint16_t*>(&vertices[i].y))) : vertices[i].y);
+  return {orientate_x(x, y, epd), orientate_y(x, y, epd)};
+}
+
+// calls emit(x0, x1) for each span of row y inside the polygon
+template <typename F>
+static void polygon_spans(const Vertex* const vertices, const uint8_t count, const bool progmem, const int16_t ox, const int16_t oy, const int16_t y, const Display& epd, F emit)
+{
+  // the first pixel right of where each edge crosses the row, in order
+  int16_t crossings[POLYGON_MAX_VERTICES];
+  uint8_t n = 0;
+
+  Vertex a = polygon_vertex(vertices, count - 1, progmem, ox, oy, epd);
+  for (uint8_t i = 0; i < count; ++i)
+  {
+    const Vertex b = polygon_vertex(vertices, i, progmem, ox, oy, epd);
+
+    // vertices and the row are both at pixel centres, so an edge crosses when one end is on or above the row and the other below
+    if ((a.y <= y) != (b.y <= y))
+    {
+      const Vertex& top = a.y < b.y ? a : b;
+      const Vertex& bottom = a.y < b.y ? b : a;
+      const int32_t dy = bottom.y - top.y;
+      const int32_t num = static_cast<int32_t>(top.x) * dy + static_cast<int32_t>(y - top.y) * (bottom.x - top.x);
+      const int16_t x = num >= 0 ? (num + dy - 1) / dy : -(-num / dy);
+
+      uint8_t k = n++;
+      for (; k > 0 && crossings[k - 1] > x; --k)
+        crossings[k] = crossings[k - 1];
+      crossings[k] = x;
+    }
+    a = b;
+  }
+
+  for (uint8_t k = 0; k + 1 < n; k += 2)
+  {
+    if (crossings[k] < crossings[k + 1])
+      emit(crossings[k], crossings[k + 1] - 1);
+  }
+}
+
+// the display bounds of a polygon offset by (ox, oy)
+static Bounds polygon_bounds(const Vertex* const vertices, const uint8_t count, const bool progmem, const int16_t ox, const int16_t oy, const Display& epd)
+{
+  if (!count)
+    return {0, 0, -1, -1};
+
+  Bounds b = {INT16_MAX, INT16_MAX, INT16_MIN, INT16_MIN};
+  for (uint8_t i = 0; i < count; ++i)
+  {
+    const Vertex v = polygon_vertex(vertices, i, progmem, ox, oy, epd);
+    b.x0 = v.x < b.x0 ? v.x : b.x0;
+    b.y0 = v.y < b.y0 ? v.y : b.y0;
+    b.x1 = v.x > b.x1 ? v.x : b.x1;
+    b.y1 = v.y > b.y1 ? v.y : b.y1;
+  }
+  return b;
+}
+
+uint8_t PolygonCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd)
+{
+  PolygonCommand* pc = (PolygonCommand*)command;
+
+  bool inside = false;
+  polygon_spans(pc->points, pc->length, pc->pgm, pc->_x, pc->_y, y, epd, [&](const int16_t s0, const int16_t s1) {
+    inside |= s0 <= x && x <= s1;
+  });
+
+  if (inside)
+    return pc->style.apply(input, 1 << (7 - x % 8), y);
+  return input;
+}
+
+Bounds PolygonCommand::bounds(void* command, const Display& epd)
+{
+  PolygonCommand* pc = (PolygonCommand*)command;
+
+  return polygon_bounds(pc->points, pc->length, pc->pgm, pc->_x, pc->_y, epd);
+}
+
+void PolygonCommand::translate(void* command, const int16_t dx, const int16_t dy)
+{
+  PolygonCommand* pc = (PolygonCommand*)command;
+
+  pc->_x += dx;
+  pc->_y += dy;
+}
+
+void PolygonCommand::draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd)
+{
+  PolygonCommand* pc = (PolygonCommand*)command;
+
+  polygon_spans(pc->points, pc->length, pc->pgm, pc->_x, pc->_y, y, epd, [&](const int16_t s0, const int16_t s1) {
+    if (s1 >= x0 && s0 <= x1)
+      fill_span(row, s0 < x0 ? x0 : s0, s1 > x1 ? x1 : s1, y, pc->style);
+  });
+}
+
+uint8_t TriangleCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd)
+{
+  TriangleCommand* tc = (TriangleCommand*)command;
+
+  bool inside = false;
+  polygon_spans(tc->points, 3, false, 0, 0, y, epd, [&](const int16_t s0, const int16_t s1) {
+    inside |= s0 <= x && x <= s1;
+  });
+
+  if (inside)
+    return tc->style.apply(input, 1 << (7 - x % 8), y);
+  return input;
+}
+
+Bounds TriangleCommand::bounds(void* command, const Display& epd)
+{
+  TriangleCommand* tc = (TriangleCommand*)command;
+
+  return polygon_bounds(tc->points, 3, false, 0, 0, epd);
+}
+
+void TriangleCommand::translate(void* command, const int16_t dx, const int16_t dy)
+{
+  TriangleCommand* tc = (TriangleCommand*)command;
+
+  for (Vertex& p : tc->points)
+  {
+    p.x += dx;
+    p.y += dy;
+  }
+}
+
+void TriangleCommand::draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd)
+{
+  TriangleCommand* tc = (TriangleCommand*)command;
+
+  polygon_spans(tc->points, 3, false, 0, 0, y, epd, [&](const int16_t s0, const int16_t s1) {
+    if (s1 >= x0 && s0 <= x1)
+      fill_span(row, s0 < x0 ? x0 : s0, s1 > x1 ? x1 : s1, y, tc->style);
+  });
+}
+
+int16_t _index(const int16_t x, const int16_t y, const int16_t tx, const int16_t ty, const Display& epd)
+{
+  switch (epd.getOrientation())
+  {
+    case 0:
+      return x - tx;
+    case 1:
+      return y - ty;
+    case 2:
+      return abs(tx - x);
+    case 3:
+      return abs(ty - y);
+  }
+  return 0;
+}
+
+TextCommand::TextCommand(const int16_t x, const int16_t y, const char* const text, const PackedFont& font) :
+txt(text), fnt(nullptr), packed(&font), _x(x), _y(y), length(strlen(text)), fontsize(1), advance(font.width(text)), walk({0, 0})
+{
+}
+
+uint8_t TextCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd)
+{
+  TextCommand* tc = (TextCommand*)command;
+
+  if (tc->packed)
+  {
+    int16_t u, v;
+    text_position(x, y, tc->_x, tc->_y, epd, u, v);
+    if (packed_ink(*tc->packed, tc->txt, tc->txt, tc->txt + tc->length, u, v, tc->walk))
+      return input & ~(1 << (7 - x % 8));
+    return input;
+  }
+
+  const char* const text = tc->txt;
+  const Font& font = *tc->fnt;
+
+  const int16_t tx = orientate_x(tc->_x, tc->_y, epd);
+  const int16_t ty = orientate_y(tc->_x, tc->_y, epd);
+
+  if (tc->out_of_bounds(x, y, tx, ty, epd))
+    return input;
+  // return input & ~(1 << (7- x % 8));
+
+  const int16_t offset = epd.getOrientation() >= 2 ? (font.charwidth + 1) * tc->fontsize * tc->length : 0;
+  const int16_t index = _index(x, y, tx - offset, ty - offset, epd) / ((font.charwidth + 1) * tc->fontsize);
+  if (index >= tc->length)
+    return input;
+
+  const char c = epd.getOrientation() >= 2 ? text[tc->length - 1 - index] : text[index];
+
+  // column fonts only hold a single byte range, anything else (such as UTF-8) is drawn as a blank
+  const uint8_t code = static_cast<uint8_t>(c);
+  if (code < font.mapoffset || code >= font.mapoffset + font.maplength)
+    return input;
+
+  return tc->render_char(input, c, x, y, tx, ty, epd);
+}
+
+Bounds TextCommand::bounds(void* command, const Display& epd)
+{
+  TextCommand* tc = (TextCommand*)command;
+
+  if (tc->packed)
+    return text_bounds(tc->_x, tc->_y, tc->advance, tc->packed->height, epd);
+
+  const Font& font = *tc->fnt;
+
+  const int16_t tx = orientate_x(tc->_x, tc->_y, epd);
+  const int16_t ty = orientate_y(tc->_x, tc->_y, epd);
+
+  // must agree with out_of_bounds
+  const int16_t length = (font.charwidth + 1) * tc->fontsize * tc->length;
+  switch (epd.getOrientation())
+  {
+    case 1:
+      return {tx, ty, static_cast<int16_t>(tx + (font.charheight + 1) * tc->fontsize), static_cast<int16_t>(ty + length - 1)};
+    case 2:
+      return {static_cast<int16_t>(tx - length), ty, static_cast<int16_t>(tx - 1), static_cast<int16_t>(ty + font.charheight * tc->fontsize)};
+    case 3:
+      return {tx, static_cast<int16_t>(ty - length), static_cast<int16_t>(tx + font.charheight * tc->fontsize), static_cast<int16_t>(ty - 1)};
+  }
+  return {tx, ty, static_cast<int16_t>(tx + length - 1), static_cast<int16_t>(ty + font.charheight * tc->fontsize)};
+}
+
+void TextCommand::translate(void* command, const int16_t dx, const int16_t dy)
+{
+  TextCommand* tc = (TextCommand*)command;
+
+  tc->_x += dx;
+  tc->_y += dy;
+}
+
+bool TextCommand::out_of_bounds(const int16_t x, const int16_t y, const int16_t tx, const int16_t ty, const Display& epd)
+{
+  const Font& font = *this->fnt;
+
+  if (epd.getOrientation() == 0)
+  {
+    // out of x-bounds
+    if (x < tx || x >= tx + (font.charwidth + 1) * this->fontsize * this->length)
+      return true;
+
+    // out of y-bounds
+    if (y < ty || y > ty + font.charheight * this->fontsize)
+      return true;
+
+    // 1px letter spacing
+    if (((x - tx) / this->fontsize + 1) % (font.charwidth + 1) == 0)
+      return true;
+  }
+  else if (epd.getOrientation() == 1)
+  {
+    // out of x-bounds
+    if (x < tx || x > tx + (font.charheight + 1) * this->fontsize)
+      return true;
+
+    // out of y-bounds
+    if (y < ty || y >= ty + (font.charwidth + 1) * this->fontsize * this->length)
+      return true;
+
+    // 1px letter spacing
+    if (((y - ty) / this->fontsize + 1) % (font.charwidth + 1) == 0)
+      return true;
+  }
+  if (epd.getOrientation() == 2)
+  {
+    // out of x-bounds
+    if (x < tx - (font.charwidth + 1) * this->fontsize * this->length || x >= tx)
+      return true;
+
+    // out of y-bounds
+    if (y < ty || y > ty + font.charheight * this->fontsize)
+      return true;
+
+    // 1px letter spacing
+    if (((x - tx) / this->fontsize + 1) % (font.charwidth + 1) == 0)
+      return true;
+  }
+  else if (epd.getOrientation() == 3)
+  {
+    // out of x-bounds
+    if (x < tx || x > tx + font.charheight * this->fontsize)
+      return true;
+
+    // out of y-bounds
+    if (y < ty - (font.charwidth + 1) * this->fontsize * this->length || y >= ty)
+      return true;
+
+    // 1px letter spacing
+    if (((y - ty) / this->fontsize + 1) % (font.charwidth + 1) == 0)
+      return true;
+
+  }
+  return false;
+}
+
+uint8_t TextCommand::render_char(const uint8_t input, const char c, const int16_t x, const int16_t y, const int16_t tx, const int16_t ty, const Display& epd)
+{
+  const Font& font = *this->fnt;
+
+  const int16_t diff = epd.getOrientation() % 2 ? (y - ty) : (x - tx);
+  const int16_t d = abs((epd.getOrientation() >= 2 ? font.charwidth - 1 : 0) - modp(diff / this->fontsize, font.charwidth + 1));
+  const uint8_t glyph_slice = pgm_read_byte(&(font.charmap[(static_cast<uint8_t>(c) - font.mapoffset) * font.charwidth + d]));
+
+  if (epd.getOrientation() == 0)
+  {
+    if ((glyph_slice >> ((y - ty) / fontsize)) & 1)
+      return input & ~(1 << (7 - x % 8));
+  }
+  else if (epd.getOrientation() == 1)
+  {
+    if ((glyph_slice << ((x - tx) / fontsize)) & 0b10000000)
+      return input & ~(1 << (7 - x % 8));
+  }
+  else if (epd.getOrientation() == 2)
+  {
+    if ((glyph_slice << ((y - ty) / fontsize)) & 0b10000000)
+      return input & ~(1 << (7 - x % 8));
+  }
+  else if (epd.getOrientation() == 3)
+  {
+    if ((glyph_slice >> ((x - tx) / fontsize)) & 1)
+      return input & ~(1 << (7 - x % 8));
+  }
+  return input;
+}
+
+void TextCommand::draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd)
+{
+  TextCommand* tc = (TextCommand*)command;
+
+  if (!tc->packed)
+  {
+    for (int16_t x = x0; x <= x1; ++x)
+      row[x >> 3] = process(command, row[x >> 3], x, y, epd);
+    return;
+  }
+
+  const PackedFont& font = *tc->packed;
+  const char* const end = tc->txt + tc->length;
+  switch (epd.getOrientation())
+  {
+    case 0:
+      // the text runs along the row, so each glyph contributes one of its rows
+      packed_row(font, tc->txt, end, row, x0, x1, tc->_x, 1, y - tc->_y);
+      break;
+    case 1:
+      // the text runs down the display, so the row is a single column of the text
+      packed_column(font, tc->txt, end, row, x0, x1, y - tc->_x, epd.width - tc->_y, -1);
+      break;
+    case 2:
+      packed_row(font, tc->txt, end, row, x0, x1, epd.width - tc->_x, -1, epd.height - y - tc->_y);
+      break;
+    case 3:
+      packed_column(font, tc->txt, end, row, x0, x1, epd.height - y - tc->_x, tc->_y, 1);
+      break;
+  }
+}
+
+TextBlockCommand::TextBlockCommand(const int16_t x, const int16_t y, const int16_t width, const int16_t height, const char* const text, const PackedFont& font, TextLine* const lines, const uint8_t capacity, const TextAlign align, const int16_t spacing) :
+txt(text), fnt(&font), table(lines), _x(x), _y(y), w(width), h(height), walk({0, 0}), gap(spacing), count(0), whole(false)
+{
+  Glyph space;
+  const int16_t space_advance = font.glyph(' ', space) ? space.advance : 0;
+
+  const char* p = text;
+  while (*p && count < capacity && count * pitch() + font.height <= height)
+  {
+    const char* const start = p;
+    const char* end = nullptr;
+    const char* wrap = nullptr; // the last space on the line
+    int16_t line = 0;
+    int16_t wrap_width = 0;
+
+    while (*p && *p != '\n')
+    {
+      if (*p == ' ')
+      {
+        wrap = p;
+        wrap_width = line;
+      }
+
+      const char* next = p;
+      Glyph glyph;
+      const int16_t advance = font.next(next, glyph) ? glyph.advance : 0;
+      if (line + advance > width && p != start)
+      {
+        // wrap at the last space, or break a word wider than the block
+        end = wrap ? wrap : p;
+        line = wrap ? wrap_width : line;
+        p = end;
+        while (*p == ' ')
+          ++p;
+        break;
+      }
+      line += advance;
+      p = next;
+    }
+
+    if (!end)
+    {
+      end = p;
+      if (*p == '\n')
+        ++p;
+    }
+
+    // trailing spaces don't count towards alignment
+    while (end > start && end[-1] == ' ')
+    {
+      --end;
+      line -= space_advance;
+    }
+
+    // glyphs can be wider than their advance, so the last one doesn't always end the line
+    int16_t reach = 0;
+    int16_t pen = 0;
+    for (const char* q = start; q < end;)
+    {
+      Glyph glyph;
+      if (!font.next(q, glyph))
+        continue;
+      reach = pen + glyph.width > reach ? pen + glyph.width : reach;
+      pen += glyph.advance;
+    }
+
+    const int16_t offset = align == ALIGN_CENTER ? (width - line) / 2 : align == ALIGN_RIGHT ? width - line : 0;
+    lines[count++] = {static_cast<uint16_t>(start - text), static_cast<uint16_t>(end - text), offset, reach};
+  }
+
+  whole = !*p;
+}
+
+uint8_t TextBlockCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd)
+{
+  TextBlockCommand* tc = (TextBlockCommand*)command;
+
+  int16_t u, v;
+  text_position(x, y, tc->_x, tc->_y, epd, u, v);
+
+  const TextLine* const line = tc->line_at(v, v);
+  if (line && u - line->offset < line->width && packed_ink(*tc->fnt, tc->txt, tc->txt + line->start, tc->txt + line->end, u - line->offset, v, tc->walk))
+    return input & ~(1 << (7 - x % 8));
+  return input;
+}
+
+Bounds TextBlockCommand::bounds(void* command, const Display& epd)
+{
+  TextBlockCommand* tc = (TextBlockCommand*)command;
+
+  if (!tc->count)
+    return {0, 0, -1, -1};
+  return text_bounds(tc->_x, tc->_y, tc->w, tc->count * tc->pitch() - tc->gap, epd);
+}
+
+void TextBlockCommand::translate(void* command, const int16_t dx, const int16_t dy)
+{
+  TextBlockCommand* tc = (TextBlockCommand*)command;
+
+  tc->_x += dx;
+  tc->_y += dy;
+}
+
+bool TextBlockCommand::repeats(void* command, const int16_t y, const Display& epd)
+{
+  TextBlockCommand* tc = (TextBlockCommand*)command;
+
+  // rows between lines are blank
+  int16_t v0, v1;
+  switch (epd.getOrientation())
+  {
+    case 0:
+      v0 = y - tc->_y;
+      v1 = v0 - 1;
+      break;
+    case 2:
+      v0 = epd.height - y - tc->_y;
+      v1 = v0 + 1;
+      break;
+    default:
+      return false;
+  }
+  return !tc->line_at(v0, v0) && !tc->line_at(v1, v1);
+}
+
+void TextBlockCommand::draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd)
+{
+  TextBlockCommand* tc = (TextBlockCommand*)command;
+  const PackedFont& font = *tc->fnt;
+
+  switch (epd.getOrientation())
+  {
+    case 0:
+    case 2:
+    {
+      // the row crosses a single line of the block
+      const bool flipped = epd.getOrientation() == 2;
+      int16_t v = flipped ? epd.height - y - tc->_y : y - tc->_y;
+      const TextLine* const line = tc->line_at(v, v);
+      if (!line)
+        return;
+
+      // a chunk of the row past either end of the line has nothing to draw
+      const int16_t x = flipped ? epd.width - tc->_x - line->offset : tc->_x + line->offset;
+      if (flipped ? x - line->width >= x1 || x < x0 : x > x1 || x + line->width <= x0)
+        return;
+      packed_row(font, tc->txt + line->start, tc->txt + line->end, row, x0, x1, x, flipped ? -1 : 1, v);
+      break;
+    }
+    case 1:
+    case 3:
+    {
+      // the row is a column of the block, crossing every line
+      const bool flipped = epd.getOrientation() == 1;
+      const int16_t u = flipped ? y - tc->_x : epd.height - y - tc->_x;
+      for (uint8_t i = 0; i < tc->count; ++i)
+      {
+        const TextLine& line = tc->table[i];
+        if (u - line.offset >= line.width)
+          continue;
+        const int16_t top = i * tc->pitch();
+        const int16_t base = flipped ? epd.width - tc->_y - top : tc->_y + top;
+        packed_column(font, tc->txt + line.start, tc->txt + line.end, row, x0, x1, u - line.offset, base, flipped ? -1 : 1);
+      }
+      break;
+    }
+  }
+}
+
+int16_t TextBlockCommand::pitch() const
+{
+  return fnt->height + gap;
+}
+
+const TextLine* TextBlockCommand::line_at(const int16_t y, int16_t& v) const
+{
+  if (y < 0)
+    return nullptr;
+
+  const int16_t i = y / pitch();
+  v = y - i * pitch();
+  if (i >= count || v >= fnt->height)
+    return nullptr;
+  return &table[i];
+}
+
+StrokeTextCommand::StrokeTextCommand(const int16_t x, const int16_t y, const char* const text, const StrokeFont& font, const int16_t size, const int16_t weight, const int16_t angle) :
+_x(x), _y(y), txt(text), fnt(&font), length(font.width(text)), pen(weight * 8)
+{
+  int16_t sine, cosine;
+  sin_cos(angle, sine, cosine);
+
+  // y runs down the display, so anticlockwise text rises as it goes right
+  const int32_t scale = static_cast<int32_t>(size) * 256 / font.height;
+  ax = (cosine * scale + 8192) >> 14;
+  ay = (-sine * scale + 8192) >> 14;
+  dx = (sine * scale + 8192) >> 14;
+  dy = (cosine * scale + 8192) >> 14;
+}
+
+StrokeTextCommand::Frame StrokeTextCommand::frame(const Display& epd) const
+{
+  // the centre of pixel (_x, _y), rotated with the display like orientate_x and orientate_y
+  const int32_t lx = static_cast<int32_t>(_x) * 16 + 8;
+  const int32_t ly = static_cast<int32_t>(_y) * 16 + 8;
+  const int32_t w = (static_cast<int32_t>(epd.width) + 1) * 16;
+  const int32_t h = (static_cast<int32_t>(epd.height) + 1) * 16;
+  switch (epd.getOrientation())
+  {
+    case 1:
+      return {w - ly, lx, static_cast<int16_t>(-ay), ax, static_cast<int16_t>(-dy), dx};
+    case 2:
+      return {w - lx, h - ly, static_cast<int16_t>(-ax), static_cast<int16_t>(-ay), static_cast<int16_t>(-dx), static_cast<int16_t>(-dy)};
+    case 3:
+      return {ly, h - lx, ay, static_cast<int16_t>(-ax), dy, static_cast<int16_t>(-dx)};
+  }
+  return {lx, ly, ax, ay, dx, dy};
+}
+
+template <typename F>
+void StrokeTextCommand::spans(const int16_t y, const Display& epd, F emit) const
+{
+  const Frame f = frame(epd);
+  const int16_t depth = fnt->height + fnt->descent;
+
+  // lines are drawn on the row where they pass within the pen of its centre
+  const int32_t lo = static_cast<int32_t>(y) * 16 + 8 - pen;
+  const int32_t hi = lo + 2 * pen;
+
+  int16_t u = 0;
+  for (const char* p = txt; *p;)
+  {
+    StrokeGlyph glyph;
+    if (!fnt->glyph(utf8_next(p), glyph))
+      continue;
+
+    const int16_t u0 = u;
+    u += glyph.advance;
+
+    // skip glyphs whose box doesn't reach the row
+    const int32_t c0 = f.y(u0, 0), c1 = f.y(u, 0), c2 = f.y(u0, depth), c3 = f.y(u, depth);
+    const int32_t top = c0 < c1 ? (c0 < c2 ? (c0 < c3 ? c0 : c3) : (c2 < c3 ? c2 : c3)) : (c1 < c2 ? (c1 < c3 ? c1 : c3) : (c2 < c3 ? c2 : c3));
+    const int32_t bottom = c0 > c1 ? (c0 > c2 ? (c0 > c3 ? c0 : c3) : (c2 > c3 ? c2 : c3)) : (c1 > c2 ? (c1 > c3 ? c1 : c3) : (c2 > c3 ? c2 : c3));
+    if (bottom <= lo || top > hi)
+      continue;
+
+    bool down = false;
+    int32_t px = 0, py = 0;
+    for (uint8_t i = 0; i < glyph.length; ++i)
+    {
+      const uint8_t point = pgm_read_byte(&fnt->points[glyph.offset + i]);
+      if (point == STROKE_PEN_UP)
+      {
+        down = false;
+        continue;
+      }
+
+      const int16_t gu = u0 + (point >> 4);
+      const int16_t gv = point & 0x0f;
+      int32_t x0 = px, y0 = py;
+      int32_t x1 = px = f.x(gu, gv);
+      int32_t y1 = py = f.y(gu, gv);
+      if (!down)
+      {
+        down = true;
+        continue;
+      }
+
+      // the part of the line within the pen of the row's centre
+      if (y0 > y1)
+      {
+        int32_t t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+      }
+      if (y0 == y1 ? (y0 <= lo || y0 > hi) : (y1 <= lo || y0 > hi))
+        continue;
+
+      int32_t xa = x0, xb = x1;
+      if (y0 != y1)
+      {
+        const int32_t ya = y0 > lo ? y0 : lo;
+        const int32_t yb = y1 < hi ? y1 : hi;
+        xa = x0 + (ya - y0) * (x1 - x0) / (y1 - y0);
+        xb = x0 + (yb - y0) * (x1 - x0) / (y1 - y0);
+      }
+      const int32_t left = (xa < xb ? xa : xb) - pen;
+      const int32_t right = (xa < xb ? xb : xa) + pen;
+
+      // pixels whose centres are within the pen, at least one so thin lines don't break up
+      int32_t s0 = (left + 7) >> 4;
+      int32_t s1 = ((right + 7) >> 4) - 1;
+      if (s0 > s1)
+        s0 = s1 = (left + right) / 2 >> 4;
+      emit(s0, s1);
+    }
+  }
+}
+
+uint8_t StrokeTextCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd)
+{
+  StrokeTextCommand* sc = (StrokeTextCommand*)command;
+
+  bool ink = false;
+  sc->spans(y, epd, [&](const int32_t s0, const int32_t s1) {
+    ink |= s0 <= x && x <= s1;
+  });
+
+  if (ink)
+    return input & ~(1 << (7 - x % 8));
+  return input;
+}
+
+Bounds StrokeTextCommand::bounds(void* command, const Display& epd)
+{
+  StrokeTextCommand* sc = (StrokeTextCommand*)command;
+
+  const Frame f = sc->frame(epd);
+  const int16_t depth = sc->fnt->height + sc->fnt->descent;
+  const int32_t xs[] = {f.x(0, 0), f.x(sc->length, 0), f.x(0, depth), f.x(sc->length, depth)};
+  const int32_t ys[] = {f.y(0, 0), f.y(sc->length, 0), f.y(0, depth), f.y(sc->length, depth)};
+
+  int32_t x0 = xs[0], x1 = xs[0], y0 = ys[0], y1 = ys[0];
+  for (uint8_t i = 1; i < 4; ++i)
+  {
+    x0 = xs[i] < x0 ? xs[i] : x0;
+    x1 = xs[i] > x1 ? xs[i] : x1;
+    y0 = ys[i] < y0 ? ys[i] : y0;
+    y1 = ys[i] > y1 ? ys[i] : y1;
+  }
+
+  const auto clamp = [](const int32_t v) -> int16_t { return v < INT16_MIN ? INT16_MIN : v > INT16_MAX ? INT16_MAX : v; };
+  return {clamp((x0 - sc->pen) >> 4), clamp((y0 - sc->pen) >> 4), clamp((x1 + sc->pen) >> 4), clamp((y1 + sc->pen) >> 4)};
+}
+
+void StrokeTextCommand::translate(void* command, const int16_t dx, const int16_t dy)
+{
+  StrokeTextCommand* sc = (StrokeTextCommand*)command;
+
+  sc->_x += dx;
+  sc->_y += dy;
+}
+
+void StrokeTextCommand::draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd)
+{
+  StrokeTextCommand* sc = (StrokeTextCommand*)command;
+
+  sc->spans(y, epd, [&](const int32_t s0, const int32_t s1) {
+    if (s1 >= x0 && s0 <= x1)
+      fill_span(row, s0 < x0 ? x0 : s0, s1 > x1 ? x1 : s1);
+  });
+}
+
+uint8_t BufferCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd)
+{
+  BufferCommand* bc = (BufferCommand*)command;
+
+  (void)epd;
+  (void)input;
+
+  const size_t index = static_cast<size_t>(y) * bc->stride + (static_cast<uint16_t>(x) >> 3);
+  if (bc->mem)
+    return pgm_read_byte(&(bc->buf[index]));
+  return bc->buf[index];
+}
+
+void BufferCommand::draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd)
+{
+  BufferCommand* bc = (BufferCommand*)command;
+
+  (void)epd;
+
+  // the buffer is placed at the origin, so its bytes line up with the row's and are copied a lane at a time
+  copy_span(row, x0, x1, &bc->buf[static_cast<size_t>(y) * bc->stride], bc->mem);
+}
+
+bool BufferCommand::opaque(void* command, const int16_t x, const int16_t y, const Display& epd)
+{
+  (void)command;
+  (void)x;
+  (void)y;
+  (void)epd;
+
+  // the buffer replaces the input entirely
+  return true;
+}
+
+Bounds BufferCommand::bounds(void* command, const Display& epd)
+{
+  BufferCommand* bc = (BufferCommand*)command;
+
+  // a full screen buffer covers every row, prepare clips it to the display
+  (void)epd;
+
+  return {0, 0, static_cast<int16_t>(bc->stride * 8 - 1), static_cast<int16_t>(bc->rows - 1)};
+}
+
+uint8_t CompressedBufferCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd)
+{
+  CompressedBufferCommand* cc = (CompressedBufferCommand*)command;
+
+  (void)epd;
+  (void)input;
+
+  return cc->decode(y)[static_cast<uint16_t>(x) >> 3];
+}
+
+void CompressedBufferCommand::draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd)
+{
+  CompressedBufferCommand* cc = (CompressedBufferCommand*)command;
+
+  (void)epd;
+
+  copy_span(row, x0, x1, cc->decode(y), false);
+}
+
+const uint8_t* CompressedBufferCommand::decode(const int16_t y)
+{
+  // a new render has started, decode from the beginning again
+  if (y < current)
+  {
+    decoder = ImageDecoder(img->data, decoder.progmem());
+    current = -1;
+  }
+
+  while (current < y)
+  {
+    decoder.next(buf, img->stride());
+    ++current;
+  }
+  return buf;
+}
+
+bool CompressedBufferCommand::opaque(void* command, const int16_t x, const int16_t y, const Display& epd)
+{
+  (void)command;
+  (void)x;
+  (void)y;
+  (void)epd;
+
+  // the image replaces the input entirely
+  return true;
+}
+
+Bounds CompressedBufferCommand::bounds(void* command, const Display& epd)
+{
+  CompressedBufferCommand* cc = (CompressedBufferCommand*)command;
+
+  (void)epd;
+
+  return {0, 0, static_cast<int16_t>(cc->img->stride() * 8 - 1), static_cast<int16_t>(cc->img->height - 1)};
+}
+
+bool CompressedBufferCommand::concurrent(void* command, const Display& epd)
+{
+  (void)command;
+  (void)epd;
+
+  return false;
+}
+
+uint8_t ClipCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd)
+{
+  (void)command;
+  (void)x;
+  (void)y;
+  (void)epd;
+
+  return input;
+}
+
+Bounds ClipCommand::bounds(void* command, const Display& epd)
+{
+  ClipCommand* cc = (ClipCommand*)command;
+
+  if (cc->w <= 0 || cc->h <= 0)
+    return {0, 0, -1, -1};
+
+  // opposite corners, rotated with the display
+  const int16_t x0 = orientate_x(cc->_x, cc->_y, epd);
+  const int16_t y0 = orientate_y(cc->_x, cc->_y, epd);
+  const int16_t x1 = orientate_x(cc->_x + cc->w - 1, cc->_y + cc->h - 1, epd);
+  const int16_t y1 = orientate_y(cc->_x + cc->w - 1, cc->_y + cc->h - 1, epd);
+
+  return {x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1, x0 < x1 ? x1 : x0, y0 < y1 ? y1 : y0};
+}
+
+void ClipCommand::translate(void* command, const int16_t dx, const int16_t dy)
+{
+  ClipCommand* cc = (ClipCommand*)command;
+
+  cc->_x += dx;
+  cc->_y += dy;
+}
+
+Display GroupCommand::view(const Display& epd) const
+{
+  return Display(epd.width, epd.height, (epd.getOrientation() + quarter) % 4);
+}
+
+void GroupCommand::placement(const Display& epd, Vertex& move, Vertex& shift) const
+{
+  // the fragment's origin is drawn where the group's position is, rather than where the turned display puts it
+  const Display turned = view(epd);
+  const int16_t sx = orientate_x(_x, _y, epd) - orientate_x(0, 0, turned);
+  const int16_t sy = orientate_y(_x, _y, epd) - orientate_y(0, 0, turned);
+  shift = {sx, sy};
+
+  // the shift back in the fragment's coordinates, undoing the turned display's rotation
+  move = unturn(shift, turned.getOrientation());
+}
+
+Vertex GroupCommand::unturn(const Vertex& v, const uint8_t quarters)
+{
+  switch (quarters % 4)
+  {
+    case 1:
+      return {v.y, static_cast<int16_t>(-v.x)};
+    case 2:
+      return {static_cast<int16_t>(-v.x), static_cast<int16_t>(-v.y)};
+    case 3:
+      return {static_cast<int16_t>(-v.y), v.x};
+  }
+  return v;
+}
+
+void GroupCommand::prepare(const Display& epd)
+{
+  const Display turned = view(epd);
+  // not clipped to the display, as the bounds are shifted onto it by each group
+  frag->prepare_within(turned, {INT16_MIN, INT16_MIN, INT16_MAX, INT16_MAX});
+  frag->frame = turned.getOrientation();
+
+  // the fragment stays where this group draws it, until another group drawing it moves it
+  Vertex move, shift;
+  placement(epd, move, shift);
+  frag->move_to(move);
+}
+
+bool GroupCommand::ready(const Display& view, const Vertex& move) const
+{
+  // a fragment has one orientation, a group turning it another way draws nothing
+  if (frag->frame != view.getOrientation())
+    return false;
+
+  if (frag->moved.x != move.x || frag->moved.y != move.y)
+    frag->move_to(move);
+  return true;
+}
+
+Bounds GroupCommand::placed(const size_t at, const Vertex& shift, const Display& view) const
+{
+  const Bounds b = frag->bounds(at, view);
+  // commands which don't move are drawn where they are
+  if (b.empty() || frag->ops(at).translate == &Command::translate)
+    return b;
+
+  // bounds which aren't kept are measured where the fragment is now, rather than where it was pushed
+  Vertex by = shift;
+  if (!frag->kept)
+  {
+    const Vertex now = unturn(frag->moved, 4 - view.getOrientation());
+    by = {static_cast<int16_t>(shift.x - now.x), static_cast<int16_t>(shift.y - now.y)};
+  }
+
+  const auto clamp = [](const int32_t v) -> int16_t { return v < INT16_MIN ? INT16_MIN : v > INT16_MAX ? INT16_MAX : v; };
+  return {clamp(static_cast<int32_t>(b.x0) + by.x), clamp(static_cast<int32_t>(b.y0) + by.y), clamp(static_cast<int32_t>(b.x1) + by.x), clamp(static_cast<int32_t>(b.y1) + by.y)};
+}
+
+uint8_t GroupCommand::process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd)
+{
+  GroupCommand* gc = (GroupCommand*)command;
+
+  const Display turned = gc->view(epd);
+  Vertex move, shift;
+  gc->placement(epd, move, shift);
+  if (!gc->ready(turned, move))
+    return input;
+
+  const uint8_t bit = 1 << (7 - x % 8);
+  uint8_t data = input;
+  for (size_t i = 0; i < gc->frag->size(); ++i)
+  {
+    const Bounds b = gc->placed(i, shift, turned);
+    if (!b.contains_row(y) || x < b.x0 || x > b.x1)
+      continue;
+
+    // commands which produce whole bytes may change the other pixels
+    const uint8_t drawn = gc->frag->process(i, data, x, y, turned);
+    data = (drawn & bit) | (data & ~bit);
+  }
+  return data;
+}
+
+Bounds GroupCommand::bounds(void* command, const Display& epd)
+{
+  GroupCommand* gc = (GroupCommand*)command;
+
+  const Display turned = gc->view(epd);
+  Vertex move, shift;
+  gc->placement(epd, move, shift);
+
+  Bounds all = {INT16_MAX, INT16_MAX, INT16_MIN, INT16_MIN};
+  for (size_t i = 0; i < gc->frag->size(); ++i)
+  {
+    const Bounds b = gc->placed(i, shift, turned);
+    if (b.empty())
+      continue;
+
+    all.x0 = b.x0 < all.x0 ? b.x0 : all.x0;
+    all.y0 = b.y0 < all.y0 ? b.y0 : all.y0;
+    all.x1 = b.x1 > all.x1 ? b.x1 : all.x1;
+    all.y1 = b.y1 > all.y1 ? b.y1 : all.y1;
+  }
+  return all;
+}
+
+bool GroupCommand::repeats(void* command, const int16_t y, const Display& epd)
+{
+  GroupCommand* gc = (GroupCommand*)command;
+
+  const Display turned = gc->view(epd);
+  Vertex move, shift;
+  gc->placement(epd, move, shift);
+  if (!gc->ready(turned, move))
+    return false;
+
+  for (size_t i = 0; i < gc->frag->size(); ++i)
+  {
+    const Bounds b = gc->placed(i, shift, turned);
+    const bool here = b.contains_row(y);
+    if (here != b.contains_row(y - 1))
+      return false;
+    if (here && !gc->frag->ops(i).repeats(gc->frag->command(i), y, turned))
+      return false;
+  }
+  return true;
+}
+
+void GroupCommand::draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd)
+{
+  GroupCommand* gc = (GroupCommand*)command;
+
+  const Display turned = gc->view(epd);
+  Vertex move, shift;
+  gc->placement(epd, move, shift);
+  if (!gc->ready(turned, move))
+    return;
+
+  for (size_t i = 0; i < gc->frag->size(); ++i)
+  {
+    const Bounds b = gc->placed(i, shift, turned);
+    if (!b.contains_row(y))
+      continue;
+
+    const int16_t s0 = b.x0 > x0 ? b.x0 : x0;
+    const int16_t s1 = b.x1 < x1 ? b.x1 : x1;
+    if (s0 > s1)
+      continue;
+
+    const CommandOps& op = gc->frag->ops(i);
+    void* const c = gc->frag->command(i);
+    if (op.draw)
+    {
+      op.draw(c, row, s0, s1, y, turned);
+      continue;
+    }
+
+    for (int16_t xb = s0 >> 3; xb <= s1 >> 3; ++xb)
+    {
+      const int16_t start = s0 > xb * 8 ? s0 : xb * 8;
+      const int16_t stop = s1 < xb * 8 + 7 ? s1 : xb * 8 + 7;
+      uint8_t data = row[xb];
+      for (int16_t x = start; x <= stop; ++x)
+        data = op.process(c, data, x, y, turned);
+      row[xb] = CommandBufferInterface::keep(row[xb], data, start - xb * 8, stop - xb * 8);
+    }
+  }
+}
+
+void GroupCommand::translate(void* command, const int16_t dx, const int16_t dy)
+{
+  GroupCommand* gc = (GroupCommand*)command;
+
+  gc->_x += dx;
+  gc->_y += dy;
+}
+
+bool GroupCommand::concurrent(void* command, const Display& epd)
+{
+  GroupCommand* gc = (GroupCommand*)command;
+
+  const Display turned = gc->view(epd);
+  Vertex move, shift;
+  gc->placement(epd, move, shift);
+  // another group drawing the fragment elsewhere moves it back and forth as the rows are drawn
+  return gc->frag->frame == turned.getOrientation() && gc->frag->moved.x == move.x && gc->frag->moved.y == move.y && gc->frag->concurrent(turned);
 }
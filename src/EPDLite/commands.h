@@ -12,18 +12,172 @@
 #include <string.h>
 #include <stdint.h>
 
-class EPDLite;
+#include "bitmap.h"
+#include "compressed.h"
+#include "display.h"
+#include "packedfont.h"
+#include "style.h"
+
+class CommandBufferInterface;
 class Font;
+struct StrokeFont;
+
+int16_t orientate_x(const int16_t x, const int16_t y, const Display& epd);
+
+int16_t orientate_y(const int16_t x, const int16_t y, const Display& epd);
+
+/**
+ * @brief An inclusive rectangle in display coordinates
+ */
+struct Bounds
+{
+  int16_t x0, y0, x1, y1;
+
+  bool empty() const { return x1 < x0 || y1 < y0; }
 
-int16_t orientate_x(const int16_t x, const int16_t y, const EPDLite& epd);
+  bool contains_row(const int16_t y) const { return y0 <= y && y <= y1; }
+
+  /**
+   * @brief Shrinks the bounds to the region also inside other
+   */
+  void intersect(const Bounds& other)
+  {
+    x0 = other.x0 > x0 ? other.x0 : x0;
+    y0 = other.y0 > y0 ? other.y0 : y0;
+    x1 = other.x1 < x1 ? other.x1 : x1;
+    y1 = other.y1 < y1 ? other.y1 : y1;
+  }
+};
 
-int16_t orientate_y(const int16_t x, const int16_t y, const EPDLite& epd);
+/**
+ * @brief A point of a polygon, @see PolygonCommand
+ */
+struct Vertex
+{
+  int16_t x, y;
+};
+
+/**
+ * @brief The most vertices a polygon can have
+ * @details Bounds the crossings held on the stack while rendering a row.
+ */
+const uint8_t POLYGON_MAX_VERTICES = 32;
+
+/**
+ * @brief Draws a command onto a span of a row at once, @see Command::draw
+ */
+typedef void (*DrawSpan)(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd);
+
+/**
+ * @brief Default behaviour shared by all commands
+ * @details Commands can hide any of these static functions with their own to do better than the default.
+ */
+class Command
+{
+public:
+  /**
+   * @brief Whether the command overwrites all 8 pixels of a byte
+   * @details When true, commands beneath this one in the buffer can't affect the byte and are not evaluated.
+   *
+   * @param x The x position of the first pixel in the byte
+   * @param y The y position of the byte
+   */
+  static bool opaque(void* command, const int16_t x, const int16_t y, const Display& epd)
+  {
+    (void)command;
+    (void)x;
+    (void)y;
+    (void)epd;
+    return false;
+  }
+
+  /**
+   * @brief The region of the display the command can draw on
+   * @details Used to skip the command for rows and bytes it can't affect. Defaults to the entire display.
+   */
+  static Bounds bounds(void* command, const Display& epd);
+
+  /**
+   * @brief Whether the command draws the same on row y as it did on row y - 1
+   * @details Only asked when both rows are within the command's bounds. When every command repeats, the renderer sends the previous row again without evaluating it.
+   *
+   * @param y The row being rendered
+   */
+  static bool repeats(void* command, const int16_t y, const Display& epd)
+  {
+    (void)command;
+    (void)y;
+    (void)epd;
+    return false;
+  }
+
+  /**
+   * @brief Draws the command onto pixels x0 to x1 of row y
+   * @details Commands which can produce whole bytes at a time, such as spans or rows of a bitmap, define a static function with the signature of DrawSpan.
+   * The span is already clipped to the command's bounds, and `row` holds everything beneath the command so far, indexed by `x / 8`. By default there is none and `process` is called for each pixel.
+   */
+  static constexpr DrawSpan draw = nullptr;
+
+  /**
+   * @brief Moves the command by (dx, dy)
+   * @details Called as the command is pushed into a buffer with a translation, @see CommandBuffer::push_translate. By default the command doesn't move, which suits commands placed at the origin such as buffers.
+   */
+  static void translate(void* command, const int16_t dx, const int16_t dy)
+  {
+    (void)command;
+    (void)dx;
+    (void)dy;
+  }
+
+  /**
+   * @brief Whether rows of the command can be rendered on several threads at once
+   * @details Asked after the buffer is prepared. Commands which change while rendering, such as a decoder working down an image, return false and the buffer is then rendered a row at a time on one thread. By default commands only read their own data while rendering.
+   */
+  static bool concurrent(void* command, const Display& epd)
+  {
+    (void)command;
+    (void)epd;
+    return true;
+  }
+};
+
+/**
+ * @brief Dispatch table for a command type
+ * @details One instance exists for each command type pushed into a CommandBuffer, @see CommandTraits
+ */
+struct CommandOps
+{
+  uint8_t (*process)(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd);
+  bool (*opaque)(void* command, const int16_t x, const int16_t y, const Display& epd);
+  Bounds (*bounds)(void* command, const Display& epd);
+  bool (*repeats)(void* command, const int16_t y, const Display& epd);
+  DrawSpan draw;
+  void (*translate)(void* command, const int16_t dx, const int16_t dy);
+  bool (*concurrent)(void* command, const Display& epd);
+};
+
+template <typename TCommand>
+struct CommandTraits
+{
+  static const CommandOps ops;
+};
+
+template <typename TCommand>
+const CommandOps CommandTraits<TCommand>::ops = {
+  &TCommand::process,
+  &TCommand::opaque,
+  &TCommand::bounds,
+  &TCommand::repeats,
+  TCommand::draw,
+  &TCommand::translate,
+  &TCommand::concurrent
+};
 
 /**
  * @brief Draws a single pixel onto the display
  *
  */
-class PixelCommand
+class PixelCommand : public Command
 {
 public:
   /**
@@ -31,21 +185,27 @@ public:
    *
    * @param x X position of the pixel
    * @param y Y position of the pixel
+   * @param style How the pixel is drawn
    */
-  PixelCommand(const int16_t x, const int16_t y) :
-  _x(x), _y(y) {}
+  PixelCommand(const int16_t x, const int16_t y, const Style& style = Style()) :
+  _x(x), _y(y), style(style) {}
+
+  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd);
 
-  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const EPDLite& epd);
+  static Bounds bounds(void* command, const Display& epd);
+
+  static void translate(void* command, const int16_t dx, const int16_t dy);
 
 private:
-  const int16_t _x, _y;
+  int16_t _x, _y;
+  const Style style;
 };
 
 /**
  * @brief Draws a one width line
  * @details Only horizontal and vertical lines are currently supported
  */
-class LineCommand
+class LineCommand : public Command
 {
 public:
   /**
@@ -56,20 +216,30 @@ public:
    * @param y0 Y position of the start of the line
    * @param x1 X position of the end of the line
    * @param y1 Y position of the end of the line
+   * @param style How the line is drawn
    */
-  LineCommand(const int16_t x0, const int16_t y0, const int16_t x1, const int16_t y1) :
-  _x0(x0), _y0(y0), _x1(x1), _y1(y1) {}
+  LineCommand(const int16_t x0, const int16_t y0, const int16_t x1, const int16_t y1, const Style& style = Style()) :
+  _x0(x0), _y0(y0), _x1(x1), _y1(y1), style(style) {}
+
+  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd);
+
+  static Bounds bounds(void* command, const Display& epd);
+
+  static void translate(void* command, const int16_t dx, const int16_t dy);
+
+  static bool repeats(void* command, const int16_t y, const Display& epd);
 
-  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const EPDLite& epd);
+  static void draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd);
 
 private:
-  const int16_t _x0, _y0, _x1, _y1;
+  int16_t _x0, _y0, _x1, _y1;
+  const Style style;
 };
 
 /**
  * @brief Draws a rectangle
  */
-class RectCommand
+class RectCommand : public Command
 {
 public:
   /**
@@ -79,25 +249,38 @@ public:
    * @param y Y position of the top left corner
    * @param width Width of the rectangle
    * @param height Height of the rectangle
+   * @param fill True to fill the rectangle, otherwise only the outline is drawn
+   * @param style How the rectangle is drawn
    */
-  RectCommand(const int16_t x, const int16_t y, const int16_t width, const int16_t height, const bool fill)
-  : _x(x), _y(y), _w(width), _h(height), f(fill)
+  RectCommand(const int16_t x, const int16_t y, const int16_t width, const int16_t height, const bool fill, const Style& style = Style())
+  : _x(x), _y(y), _w(width), _h(height), f(fill), style(style)
   {}
 
-  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const EPDLite& epd);
+  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd);
+
+  static bool opaque(void* command, const int16_t x, const int16_t y, const Display& epd);
+
+  static Bounds bounds(void* command, const Display& epd);
+
+  static void translate(void* command, const int16_t dx, const int16_t dy);
+
+  static bool repeats(void* command, const int16_t y, const Display& epd);
+
+  static void draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd);
 
 private:
-  const int16_t _x;
-  const int16_t _y;
+  int16_t _x;
+  int16_t _y;
   const int16_t _w;
   const int16_t _h;
   const bool f;
+  const Style style;
 };
 
 /**
  * @brief Draws a circle
  */
-class CircleCommand
+class CircleCommand : public Command
 {
 public:
   /**
@@ -106,16 +289,143 @@ public:
    * @param x X position of the circle's origin
    * @param y Y position of the circle's origin
    * @param r Radius of the circle
+   * @param fill True to fill the circle, otherwise only the outline is drawn
+   * @param style How the circle is drawn
    */
-  CircleCommand(const int16_t x, const int16_t y, const int16_t r, const bool fill) :
-  _x(x), _y(y), radius(r), f(fill) {}
+  CircleCommand(const int16_t x, const int16_t y, const int16_t r, const bool fill, const Style& style = Style()) :
+  _x(x), _y(y), radius(r), f(fill), style(style) {}
+
+  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd);
+
+  static Bounds bounds(void* command, const Display& epd);
 
-  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const EPDLite& epd);
+  static void translate(void* command, const int16_t dx, const int16_t dy);
+
+  static void draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd);
 
 private:
-  const int16_t _x, _y;
+  // calls emit(x0, x1) for each span of row y drawn by the circle
+  template <typename F>
+  void spans(const int16_t y, const Display& epd, F emit) const;
+
+  int16_t _x, _y;
   const int16_t radius;
   const bool f;
+  const Style style;
+};
+/**
+ * @brief Draws an arc of a ring, such as the band of a gauge
+ * @details The angles are turned into directions once when the command is created, then each row is filled as at most four spans with integer math, no floating point or libm.
+ */
+class ArcCommand : public Command
+{
+public:
+  /**
+   * @brief Draws an arc of a ring
+   * @details Angles are in degrees anticlockwise from the right (3 o'clock), and the arc runs anticlockwise from start to end. The whole ring is drawn if end is 360 or more past start.
+   *
+   * @param x X position of the centre
+   * @param y Y position of the centre
+   * @param inner Inner radius, 0 for a sector of a disc
+   * @param outer Outer radius
+   * @param start Angle of the start of the arc
+   * @param end Angle of the end of the arc
+   * @param style How the arc is drawn
+   */
+  ArcCommand(const int16_t x, const int16_t y, const int16_t inner, const int16_t outer, const int16_t start, const int16_t end, const Style& style = Style());
+
+  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd);
+
+  static Bounds bounds(void* command, const Display& epd);
+
+  static void translate(void* command, const int16_t dx, const int16_t dy);
+
+  static void draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd);
+
+private:
+  // calls emit(x0, x1) for each span of row y inside the arc
+  template <typename F>
+  void spans(const int16_t y, const Display& epd, F emit) const;
+
+  int16_t _x, _y;
+  const int16_t r0, r1;
+  int16_t sx, sy; // direction of the start, 16384 is 1
+  int16_t ex, ey; // direction of the end
+  uint8_t sweep;  // ARC_NARROW, ARC_WIDE (more than half a turn) or ARC_FULL
+  const Style style;
+};
+
+/**
+ * @brief Draws a filled polygon
+ * @details Each row is filled between the crossings of the polygon's edges with the centre of the row, using the even-odd rule, so each row costs one step per edge whatever the size of the polygon.
+ * A pixel is filled when its centre is inside the polygon, so polygons sharing an edge don't overlap. Vertices can be stored in memory or in PROGMEM, and the vertex data must stay valid until rendered.
+ */
+class PolygonCommand : public Command
+{
+public:
+  /**
+   * @brief Draws a filled polygon
+   *
+   * @param x X offset added to every vertex
+   * @param y Y offset added to every vertex
+   * @param vertices The vertices, in order around the polygon
+   * @param count The number of vertices, at most POLYGON_MAX_VERTICES
+   * @param progmem True if the vertices are stored in PROGMEM
+   * @param style How the polygon is drawn
+   */
+  PolygonCommand(const int16_t x, const int16_t y, const Vertex* const vertices, const uint8_t count, const bool progmem, const Style& style = Style()) :
+  _x(x), _y(y), points(vertices), length(count < POLYGON_MAX_VERTICES ? count : POLYGON_MAX_VERTICES), pgm(progmem), style(style) {}
+
+  /**
+   * @brief Draws a filled polygon, with the number of vertices taken from the array
+   */
+  template <size_t TCount>
+  PolygonCommand(const int16_t x, const int16_t y, const Vertex (&vertices)[TCount], const bool progmem, const Style& style = Style()) :
+  PolygonCommand(x, y, vertices, TCount, progmem, style)
+  {
+    static_assert(TCount <= POLYGON_MAX_VERTICES, "Polygon has too many vertices.");
+  }
+
+  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd);
+
+  static Bounds bounds(void* command, const Display& epd);
+
+  static void translate(void* command, const int16_t dx, const int16_t dy);
+
+  static void draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd);
+
+private:
+  int16_t _x, _y;
+  const Vertex* const points;
+  const uint8_t length;
+  const bool pgm;
+  const Style style;
+};
+
+/**
+ * @brief Draws a filled triangle
+ * @details The vertices are held in the command, otherwise drawn as PolygonCommand.
+ */
+class TriangleCommand : public Command
+{
+public:
+  /**
+   * @brief Draws a filled triangle
+   */
+  TriangleCommand(const int16_t x0, const int16_t y0, const int16_t x1, const int16_t y1, const int16_t x2, const int16_t y2, const Style& style = Style()) :
+  points{{x0, y0}, {x1, y1}, {x2, y2}}, style(style) {}
+
+  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd);
+
+  static Bounds bounds(void* command, const Display& epd);
+
+  static void translate(void* command, const int16_t dx, const int16_t dy);
+
+  static void draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd);
+
+private:
+  Vertex points[3];
+  const Style style;
 };
 
 
@@ -128,7 +438,7 @@ T modp(const T a, const T b)
 /**
  * @brief Draws some text
  */
-class TextCommand
+class TextCommand : public Command
 {
 public:
   /**
@@ -140,22 +450,195 @@ public:
    * @param font The font to use
    */
   TextCommand(const int16_t x, const int16_t y, const char* const text, const Font& font, int16_t size) :
-  _x(x), _y(y), txt(text), length(strlen(text)), fnt(font), fontsize(size)
+  txt(text), fnt(&font), packed(nullptr), _x(x), _y(y), length(strlen(text)), fontsize(size), advance(0), walk({0, 0})
   {
   }
 
-  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const EPDLite& epd);
+  /**
+   * @brief Draws some text with a packed font
+   * @details Rows of glyphs are copied a byte at a time when the text runs along the rows of the display (orientation 0), @see PackedFont
+   * The text is measured once here, rows are drawn by walking the text and looking up each glyph, never per pixel. Pixels drawn one at a time with process resume the walk from the last glyph found, so process changes the command, while draw only reads it.
+   *
+   * @param x X position of the start of the text
+   * @param y Y position of the top of the text
+   * @param text The UTF-8 text to draw
+   * @param font The font to use
+   */
+  TextCommand(const int16_t x, const int16_t y, const char* const text, const PackedFont& font);
+
+  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd);
+
+  static Bounds bounds(void* command, const Display& epd);
+
+  static void translate(void* command, const int16_t dx, const int16_t dy);
+
+  static void draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd);
 
 private:
-  bool out_of_bounds(const int16_t x, const int16_t y, const int16_t tx, const int16_t ty, const EPDLite& epd);
+  bool out_of_bounds(const int16_t x, const int16_t y, const int16_t tx, const int16_t ty, const Display& epd);
 
-  uint8_t render_char(const uint8_t input, const char c, const int16_t x, const int16_t y, const int16_t tx, const int16_t ty, const EPDLite& epd);
+  uint8_t render_char(const uint8_t input, const char c, const int16_t x, const int16_t y, const int16_t tx, const int16_t ty, const Display& epd);
 
-  const int16_t _x, _y;
+  // pointers first, so there is no padding between the members on 32 and 64 bit cores
   const char* const txt;
+  const Font* const fnt;
+  const PackedFont* const packed;
+  int16_t _x, _y;
   const int16_t length;
-  const Font& fnt;
   const int16_t fontsize;
+  const int16_t advance; // width of the text in pixels with a packed font
+  TextWalk walk; // where process last found a glyph with a packed font
+};
+
+/**
+ * @brief Horizontal alignment of the lines of a TextBlockCommand
+ */
+enum TextAlign
+{
+  ALIGN_LEFT,
+  ALIGN_CENTER,
+  ALIGN_RIGHT
+};
+
+/**
+ * @brief A line of a TextBlockCommand, as laid out when the command is created
+ */
+struct TextLine
+{
+  uint16_t start; ///< Offset in the text of the first byte of the line
+  uint16_t end;   ///< Offset in the text of the byte after the line
+  int16_t offset; ///< Distance in pixels from the left of the block to the start of the line
+  int16_t width;  ///< Distance in pixels from the start of the line to the right of its glyphs, rows and columns past it don't decode the line
+};
+
+/**
+ * @brief Draws text wrapped into a box
+ * @details Text is broken into lines at spaces, at newlines, and within words wider than the box. Lines are laid out once when the command is created, into a table provided by the caller, so rendering a row only looks up its line.
+ * Lines which don't fit in the box are dropped, @see complete.
+ */
+class TextBlockCommand : public Command
+{
+public:
+  /**
+   * @brief Draws text wrapped into a box
+   *
+   * @param x X position of the left of the box
+   * @param y Y position of the top of the box
+   * @param width Width of the box in pixels
+   * @param height Height of the box in pixels
+   * @param text The UTF-8 text to draw, must stay valid until rendered
+   * @param font The font to use
+   * @param lines Table filled with the lines of the block, must stay valid until rendered
+   * @param capacity The number of lines the table can hold
+   * @param align Alignment of each line within the box
+   * @param spacing Pixels between lines
+   */
+  TextBlockCommand(const int16_t x, const int16_t y, const int16_t width, const int16_t height, const char* const text, const PackedFont& font, TextLine* const lines, const uint8_t capacity, const TextAlign align = ALIGN_LEFT, const int16_t spacing = 0);
+
+  /**
+   * @brief Draws text wrapped into a box, with a table of lines sized by its type
+   */
+  template <size_t TLines>
+  TextBlockCommand(const int16_t x, const int16_t y, const int16_t width, const int16_t height, const char* const text, const PackedFont& font, TextLine (&lines)[TLines], const TextAlign align = ALIGN_LEFT, const int16_t spacing = 0) :
+  TextBlockCommand(x, y, width, height, text, font, lines, TLines, align, spacing)
+  {
+  }
+
+  /**
+   * @brief The number of lines laid out
+   */
+  uint8_t lines() const { return count; }
+
+  /**
+   * @brief True if all of the text fit in the box and the table of lines
+   */
+  bool complete() const { return whole; }
+
+  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd);
+
+  static Bounds bounds(void* command, const Display& epd);
+
+  static void translate(void* command, const int16_t dx, const int16_t dy);
+
+  static bool repeats(void* command, const int16_t y, const Display& epd);
+
+  static void draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd);
+
+private:
+  // distance in pixels from the top of one line to the top of the next
+  int16_t pitch() const;
+
+  // the line at y pixels down the block, and v pixels down its glyphs, nullptr between lines and past the last one
+  const TextLine* line_at(const int16_t y, int16_t& v) const;
+
+  // pointers first, so there is no padding between the members on 32 and 64 bit cores
+  const char* const txt;
+  const PackedFont* const fnt;
+  TextLine* const table;
+  int16_t _x, _y;
+  const int16_t w, h;
+  TextWalk walk; // where process last found a glyph
+  const int16_t gap;
+  uint8_t count;
+  bool whole;
+};
+
+/**
+ * @brief Draws text with a stroke font at any size and angle
+ * @details Each line of each glyph is drawn with a square pen, a row at a time as a span per line, so large text stays sharp and needs no more memory than small text, @see StrokeFont
+ */
+class StrokeTextCommand : public Command
+{
+public:
+  /**
+   * @brief Draws text with a stroke font
+   *
+   * @param x X position of the top left of the text
+   * @param y Y position of the top left of the text
+   * @param text The UTF-8 text to draw, must stay valid until rendered
+   * @param font The font to use
+   * @param size Height of the capitals in pixels
+   * @param weight Width of the lines in pixels
+   * @param angle Angle of the text in degrees anticlockwise, turning around (x, y)
+   */
+  StrokeTextCommand(const int16_t x, const int16_t y, const char* const text, const StrokeFont& font, const int16_t size, const int16_t weight = 1, const int16_t angle = 0);
+
+  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd);
+
+  static Bounds bounds(void* command, const Display& epd);
+
+  static void translate(void* command, const int16_t dx, const int16_t dy);
+
+  static void draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd);
+
+private:
+  /**
+   * @brief Where the text is on the display, grid point (u, v) is at `origin + u * along + v * down`
+   * @details Positions are in 1/16 pixels with pixel centres at 8, steps are in 1/256 pixels per grid unit.
+   */
+  struct Frame
+  {
+    int32_t ox, oy;
+    int16_t ax, ay;
+    int16_t dx, dy;
+
+    int32_t x(const int16_t u, const int16_t v) const { return ox + ((static_cast<int32_t>(u) * ax + static_cast<int32_t>(v) * dx) >> 4); }
+    int32_t y(const int16_t u, const int16_t v) const { return oy + ((static_cast<int32_t>(u) * ay + static_cast<int32_t>(v) * dy) >> 4); }
+  };
+
+  Frame frame(const Display& epd) const;
+
+  // calls emit(x0, x1) with the pixels of row y drawn by each line of the text
+  template <typename F>
+  void spans(const int16_t y, const Display& epd, F emit) const;
+
+  int16_t _x, _y;
+  const char* const txt;
+  const StrokeFont* const fnt;
+  int16_t length; // width of the text in grid units
+  int16_t ax, ay; // a grid unit along the text, in 1/256 pixels
+  int16_t dx, dy; // a grid unit down the glyphs, in 1/256 pixels
+  const int16_t pen; // half the width of the lines, in 1/16 pixels
 };
 
 
@@ -163,7 +646,7 @@ private:
  * @brief Draws the contents of a buffer
  * @details Using a memory or PROGMEM buffer, the contents is placed onto the screen.
  */
-class BufferCommand
+class BufferCommand : public Command
 {
 public:
   /**
@@ -175,17 +658,214 @@ public:
    * @param progmem True if the buffer is in progmem and needs to be read, false otherwise
    */
   BufferCommand(const uint8_t* const buffer, const int16_t width, const bool progmem) :
-  buf(buffer), w(width), mem(progmem)
+  buf(buffer), stride((width + 7) / 8), rows(INT16_MAX), mem(progmem)
+  {}
+
+  /**
+   * @brief Draws a bitmap
+   * @details The bitmap is placed at the origin of the screen, anything outside of it is left as it is.
+   *
+   * @param bitmap The bitmap to draw, @see Bitmap
+   * @param progmem True if the bitmap is in progmem and needs to be read, false otherwise
+   */
+  BufferCommand(const Bitmap& bitmap, const bool progmem) :
+  buf(bitmap.data), stride(bitmap.stride()), rows(bitmap.height), mem(progmem)
   {}
 
-  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const EPDLite& epd);
+  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd);
+
+  static bool opaque(void* command, const int16_t x, const int16_t y, const Display& epd);
+
+  static Bounds bounds(void* command, const Display& epd);
+
+  static void draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd);
 
 private:
   const uint8_t* const buf;
-  const int16_t w;
+  const int16_t stride; // bytes per row, computed once so process only needs a multiply and a shift
+  const int16_t rows;
   const bool mem;
 };
 
+
+/**
+ * @brief Draws a compressed image
+ * @details The image is decoded a row at a time as the display is rendered, so only a single row of the image is held in memory. Like BufferCommand, the image is placed at the origin of the display.
+ */
+class CompressedBufferCommand : public Command
+{
+public:
+  /**
+   * @brief Draws a compressed image
+   *
+   * @param image The image to draw, kept by pointer so it must stay valid until rendered, such as a static
+   * @param row Buffer to decode rows into, at least `image.stride()` bytes. Must not be used for anything else until the render is complete
+   * @param progmem True if the image data is in progmem and needs to be read, false otherwise
+   */
+  CompressedBufferCommand(const CompressedImage& image, uint8_t* const row, const bool progmem) :
+  img(&image), buf(row), decoder(image.data, progmem), current(-1)
+  {}
+
+  /**
+   * @brief A temporary image would be gone before the command is rendered
+   */
+  CompressedBufferCommand(const CompressedImage&& image, uint8_t* const row, const bool progmem) = delete;
+
+  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd);
+
+  static bool opaque(void* command, const int16_t x, const int16_t y, const Display& epd);
+
+  static Bounds bounds(void* command, const Display& epd);
+
+  /**
+   * @brief The image is decoded down the rows as they are rendered, so only a row at a time
+   */
+  static bool concurrent(void* command, const Display& epd);
+
+  static void draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd);
+
+private:
+  /**
+   * @brief Decodes the image down to row y
+   * @return The row, held in buf
+   */
+  const uint8_t* decode(const int16_t y);
+
+  const CompressedImage* const img;
+  uint8_t* const buf;
+  ImageDecoder decoder;
+  int16_t current; // the row held in buf
+};
+
+
+/**
+ * @brief Starts or ends a clip rectangle, @see CommandBuffer::push_clip
+ * @details Draws nothing. When the buffer is prepared, the bounds of each command between the start and the end are intersected with the rectangle, so commands outside of it are skipped entirely and the pixels of the rest outside of it are left as they are.
+ */
+class ClipCommand : public Command
+{
+public:
+  /**
+   * @brief Starts a clip rectangle
+   * @details Nested clips are intersected with the clips they are within.
+   *
+   * @param x X position of the top left of the rectangle
+   * @param y Y position of the top left of the rectangle
+   * @param width Width of the rectangle
+   * @param height Height of the rectangle
+   */
+  ClipCommand(const int16_t x, const int16_t y, const int16_t width, const int16_t height) :
+  _x(x), _y(y), w(width), h(height), opened(0), closing(false), outer({0, 0, -1, -1})
+  {}
+
+  /**
+   * @brief Ends a clip rectangle
+   *
+   * @param start The position in the buffer of the command which started the clip
+   */
+  explicit ClipCommand(const size_t start) :
+  _x(0), _y(0), w(0), h(0), opened(start), closing(true), outer({0, 0, -1, -1})
+  {}
+
+  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd);
+
+  /**
+   * @brief The clip rectangle on the display
+   * @details Used by prepare to clip the following commands, the command itself draws nothing.
+   */
+  static Bounds bounds(void* command, const Display& epd);
+
+  static void translate(void* command, const int16_t dx, const int16_t dy);
+
+private:
+  friend class CommandBufferInterface;
+
+  int16_t _x, _y;
+  const int16_t w, h;
+  const size_t opened; // for the end of a clip, the position of its start
+  const bool closing;
+  Bounds outer; // for the start of a clip, the clip it is within, set by prepare
+};
+
+
+/**
+ * @brief Draws the commands of another buffer, moved and turned
+ * @details A fragment of a screen, such as a gauge with its ticks and label, is pushed once into a buffer of its own in its own coordinates, then drawn wherever it appears by pushing a GroupCommand for each place.
+ * The group's bounds cover everything in it, so rows and columns outside of them skip the whole group, and on each row only the commands of the group which reach it are evaluated.
+ */
+class GroupCommand : public Command
+{
+public:
+  /**
+   * @brief Draws the commands of another buffer
+   * @details The fragment is drawn as if the display were turned by a number of quarter turns, about the fragment's origin, so text and shapes turn with it. Commands which don't move, such as buffers, are drawn where they are.
+   *
+   * @param fragment The commands to draw in the group's own coordinates. Must stay valid, and not be changed, until the buffer the group is pushed into is rendered. Groups sharing a fragment must turn it the same way, otherwise only those turned as the last one pushed are drawn
+   * @param x X position of the fragment's origin
+   * @param y Y position of the fragment's origin
+   * @param turns Quarter turns clockwise, 0 to 3
+   */
+  GroupCommand(CommandBufferInterface& fragment, const int16_t x, const int16_t y, const uint8_t turns = 0) :
+  frag(&fragment), _x(x), _y(y), quarter(turns % 4)
+  {}
+
+  static uint8_t process(void* command, const uint8_t input, const int16_t x, const int16_t y, const Display& epd);
+
+  static Bounds bounds(void* command, const Display& epd);
+
+  static bool repeats(void* command, const int16_t y, const Display& epd);
+
+  static void draw(void* command, uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Display& epd);
+
+  static void translate(void* command, const int16_t dx, const int16_t dy);
+
+  /**
+   * @brief Whether every command of the fragment is concurrent, and the fragment stays where this group draws it
+   * @details A fragment drawn by several groups is moved to each as it is drawn, so only a row at a time.
+   */
+  static bool concurrent(void* command, const Display& epd);
+
+private:
+  friend class CommandBufferInterface;
+
+  /**
+   * @brief Prepares the fragment for the turned display, and moves it to where this group draws it
+   * @details Called as the buffer holding the group is prepared. A fragment has one orientation, that of the last group to prepare it, so a group sharing the fragment with a later group turned another way draws nothing.
+   */
+  void prepare(const Display& epd);
+
+  /**
+   * @brief The display as the fragment sees it, turned with the group
+   */
+  Display view(const Display& epd) const;
+
+  /**
+   * @brief Where the fragment is drawn
+   * @details The fragment is prepared where its commands were pushed, then they are moved by `move` to draw them, which moves them by `shift` on the display.
+   */
+  void placement(const Display& epd, Vertex& move, Vertex& shift) const;
+
+  /**
+   * @brief Turns v back by a number of quarter turns, from display coordinates into the fragment's
+   */
+  static Vertex unturn(const Vertex& v, const uint8_t quarters);
+
+  /**
+   * @brief Moves the fragment to where this group draws it
+   * @return false if the fragment was prepared for another orientation, by a group turned another way or on its own, and the group draws nothing
+   */
+  bool ready(const Display& view, const Vertex& move) const;
+
+  /**
+   * @brief The bounds of command at of the fragment on the display
+   */
+  Bounds placed(const size_t at, const Vertex& shift, const Display& view) const;
+
+  CommandBufferInterface* const frag;
+  int16_t _x, _y;
+  const uint8_t quarter;
+};
+
 #endif
 
 /* \} */
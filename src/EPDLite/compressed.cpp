@@ -0,0 +1,50 @@
+#include "compressed.h"
+
+#ifdef TEST
+#include "../../extra/stub.h"
+#else
+#include "EPDLite.h"
+#endif
+
+static const uint8_t LITERAL = 0;
+static const uint8_t WHITE = 1;
+static const uint8_t BLACK = 2;
+static const uint8_t COPY = 3;
+
+uint8_t ImageDecoder::pgm_read(const uint8_t* p)
+{
+  return pgm_read_byte(p);
+}
+
+void ImageDecoder::next(uint8_t* const row, const int16_t stride)
+{
+  for (int16_t i = 0; i < stride; ++i)
+  {
+    if (remaining == 0)
+    {
+      const uint8_t token = read();
+      type = token >> 6;
+      remaining = (token & 0x3f) + 1;
+      if (type == COPY)
+        distance = read();
+    }
+    --remaining;
+
+    switch (type)
+    {
+      case LITERAL:
+        row[i] = read();
+        break;
+      case WHITE:
+        row[i] = 0xff;
+        break;
+      case BLACK:
+        row[i] = 0x00;
+        break;
+      case COPY:
+        // positions before the start of this row still hold the previous row
+        row[i] = row[i >= distance ? i - distance : i - distance + stride];
+        break;
+    }
+  }
+}
@@ -0,0 +1,97 @@
+/**
+ * @file compressed.h
+ * @brief ePaper Display Interface compressed images
+ * @ingroup  EPDLite
+ * @addtogroup  EPDLite
+ * \{
+ *
+ * Compressed images hold the same data as a full screen buffer (row major, MSB first, 0 is black), encoded as a sequence of tokens.
+ * Each token starts with a byte whose top two bits give the type and bottom six bits give the number of bytes it produces, minus one.
+ *
+ * | Type | Produces                                                                       |
+ * |------|--------------------------------------------------------------------------------|
+ * | 00   | The following n + 1 bytes as they are                                          |
+ * | 01   | n + 1 white (0xff) bytes                                                       |
+ * | 10   | n + 1 black (0x00) bytes                                                       |
+ * | 11   | n + 1 bytes copied from d bytes back, where d (1 to one row) is the next byte  |
+ *
+ * Back references never reach further than one row, so a decoder only ever needs a single row of memory.
+ * Images can be created with the `imgconv` tool in `extra/`, or from raw display data with the `compress` tool.
+ */
+
+#ifndef EPDLITE_COMPRESSED_H_INCLUDE
+#define EPDLITE_COMPRESSED_H_INCLUDE
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief A compressed image
+ */
+struct CompressedImage
+{
+  /**
+   * @brief The compressed data
+   */
+  const uint8_t* data;
+  /**
+   * @brief Width of the image in pixels, at most 2040 (255 bytes)
+   */
+  int16_t width;
+  /**
+   * @brief Height of the image in pixels
+   */
+  int16_t height;
+
+  /**
+   * @brief The number of bytes in a row of the decoded image
+   */
+  int16_t stride() const { return (width + 7) / 8; }
+};
+
+/**
+ * @brief Decodes a compressed image a row at a time
+ */
+class ImageDecoder
+{
+public:
+  /**
+   * @brief Starts decoding an image
+   *
+   * @param data The compressed data
+   * @param progmem True if the data is stored in PROGMEM
+   */
+  ImageDecoder(const uint8_t* const data, const bool progmem)
+  : src(data), mem(progmem), type(0), remaining(0), distance(0)
+  {}
+
+  /**
+   * @brief Decodes the next row
+   *
+   * @param row The row buffer, must hold the previously decoded row as it's used for back references
+   * @param stride The number of bytes in a row of the image
+   */
+  void next(uint8_t* const row, const int16_t stride);
+
+  /**
+   * @brief True if the data is stored in PROGMEM
+   */
+  bool progmem() const { return mem; }
+
+private:
+  uint8_t read() { return mem ? pgm_read(src++) : *src++; }
+
+  static uint8_t pgm_read(const uint8_t* p);
+
+  const uint8_t* src;
+  bool mem;
+
+  // the current token, which can span rows
+  uint8_t type;
+  uint8_t remaining;
+  uint8_t distance;
+};
+
+#endif
+
+/* \} */
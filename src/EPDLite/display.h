@@ -0,0 +1,51 @@
+/**
+ * @file display.h
+ * @brief ePaper Display Interface display size and orientation
+ * @ingroup  EPDLite
+ * @addtogroup  EPDLite
+ * \{
+ */
+
+#ifndef EPDLITE_DISPLAY_H_INCLUDE
+#define EPDLITE_DISPLAY_H_INCLUDE
+
+#include <stdint.h>
+
+/**
+ * @brief The size and orientation of a display, all that commands need to know to draw on it
+ * @details EPDLite is a Display. A GroupCommand draws its fragment on a turned view of the display, which is small enough to make for every pixel.
+ */
+class Display
+{
+public:
+  /**
+   * @brief A display
+   *
+   * @param w Width of the display in pixels
+   * @param h Height of the display in pixels
+   * @param o Orientation, quarter turns 0 to 3
+   */
+  Display(const int16_t w, const int16_t h, const uint8_t o = 0)
+  : width(w)
+  , height(h)
+  , orientation(o)
+  {}
+
+  uint8_t getOrientation() const { return orientation; }
+
+  /**
+   * @brief The width of the display in pixels
+   */
+  const int16_t width;
+  /**
+   * @brief The height of the display in pixels
+   */
+  const int16_t height;
+
+protected:
+  uint8_t orientation;
+};
+
+#endif
+
+/* \} */
@@ -9,6 +9,7 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 /**
  * @brief Datatype for rendering text
@@ -36,6 +37,7 @@ struct Font
 
   static int16_t height(const char* const text, const Font& font, const int16_t fontsize)
   {
+    (void)text;
     return font.charheight * fontsize;
   }
 
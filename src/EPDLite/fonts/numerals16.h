@@ -0,0 +1,70 @@
+// generated by fontc from fonts/numerals16.txt
+
+#ifndef EPDLITE_FONT_NUMERALS16_H_INCLUDE
+#define EPDLITE_FONT_NUMERALS16_H_INCLUDE
+
+#ifndef PROGMEM
+#include <avr/pgmspace.h>
+#endif
+
+#include "../packedfont.h"
+
+const uint8_t numerals16_bitmap[496] PROGMEM = {
+  0x9f, 0x3f, 0x6e, 0x7f, 0x6e, 0x7f, 0x9c, 0xff, 0xfc, 0xff, 0xf9, 0xff, 0xf9, 0xff, 0xf3, 0xff, 0xf3, 0xff, 0xe7, 0xff, 0xe7, 0xff, 0xcf, 0xff, 0xce, 0x7f, 0x9d, 0xbf, 0x9d, 0xbf, 0x3e, 0x7f, // '%'
+  0xff, 0xff, 0xff, 0xff, 0xe7, 0xe7, 0xe7, 0x00, 0x00, 0xe7, 0xe7, 0xe7, 0xff, 0xff, 0xff, 0xff, // '+'
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x03, 0x03, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // '-'
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3f, 0x3f, // '.'
+  0xe1, 0xff, 0xc0, 0xff, 0x9e, 0x7f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3e, 0x3f, 0x3c, 0x3f, 0x39, 0x3f, 0x33, 0x3f, 0x27, 0x3f, 0x0f, 0x3f, 0x1f, 0x3f, 0x3f, 0x3f, 0x9e, 0x7f, 0xc0, 0xff, 0xe1, 0xff, // '0'
+  0xf3, 0xff, 0xe3, 0xff, 0xc3, 0xff, 0x93, 0xff, 0xf3, 0xff, 0xf3, 0xff, 0xf3, 0xff, 0xf3, 0xff, 0xf3, 0xff, 0xf3, 0xff, 0xf3, 0xff, 0xf3, 0xff, 0xf3, 0xff, 0xf3, 0xff, 0x80, 0x7f, 0x80, 0x7f, // '1'
+  0xc0, 0xff, 0x9e, 0x7f, 0x3f, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xfe, 0x7f, 0xfc, 0xff, 0xf9, 0xff, 0xf3, 0xff, 0xe7, 0xff, 0xcf, 0xff, 0x9f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x00, 0x3f, 0x00, 0x3f, // '2'
+  0xc0, 0xff, 0x9e, 0x7f, 0x3f, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xfe, 0x7f, 0xe0, 0xff, 0xe0, 0xff, 0xfe, 0x7f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0x3f, 0x3f, 0x9e, 0x7f, 0xc0, 0xff, 0xe1, 0xff, // '3'
+  0xfc, 0xff, 0xf8, 0xff, 0xf0, 0xff, 0xe4, 0xff, 0xcc, 0xff, 0x9c, 0xff, 0x3c, 0xff, 0x3c, 0xff, 0x00, 0x3f, 0x00, 0x3f, 0xfc, 0xff, 0xfc, 0xff, 0xfc, 0xff, 0xfc, 0xff, 0xfc, 0xff, 0xfc, 0xff, // '4'
+  0x00, 0x3f, 0x00, 0x3f, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x20, 0xff, 0x00, 0xff, 0x3e, 0x7f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0x3f, 0x3f, 0x9e, 0x7f, 0xc0, 0xff, 0xe1, 0xff, // '5'
+  0xe0, 0xff, 0xce, 0x7f, 0x9f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x20, 0xff, 0x00, 0xff, 0x1e, 0x7f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x9e, 0x7f, 0xc0, 0xff, 0xe1, 0xff, // '6'
+  0x00, 0x3f, 0x00, 0x3f, 0xff, 0x3f, 0xfe, 0x7f, 0xfe, 0x7f, 0xfc, 0xff, 0xfc, 0xff, 0xf9, 0xff, 0xf9, 0xff, 0xf3, 0xff, 0xf3, 0xff, 0xe7, 0xff, 0xe7, 0xff, 0xe7, 0xff, 0xe7, 0xff, 0xe7, 0xff, // '7'
+  0xc0, 0xff, 0x9e, 0x7f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x9e, 0x7f, 0xc0, 0xff, 0xc0, 0xff, 0x9e, 0x7f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x9e, 0x7f, 0xc0, 0xff, 0xe1, 0xff, // '8'
+  0xc0, 0xff, 0x9e, 0x7f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3f, 0x3e, 0x3f, 0x9e, 0x3f, 0xc1, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xfe, 0x7f, 0x3c, 0xff, 0x81, 0xff, 0xc3, 0xff, // '9'
+  0xff, 0xff, 0xff, 0xff, 0x3f, 0x3f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3f, 0x3f, 0xff, 0xff, // ':'
+  0xe1, 0xff, 0xc0, 0xff, 0x9e, 0x7f, 0x3f, 0x3f, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0x3f, 0x9e, 0x7f, 0xc0, 0xff, 0xe1, 0xff, // 'C'
+  0x00, 0x3f, 0x00, 0x3f, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x00, 0xff, 0x00, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xff, 0x3f, 0xff, // 'F'
+  0x87, 0x33, 0x33, 0x87, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, // U+00B0
+};
+
+const Glyph numerals16_glyphs[19] PROGMEM = {
+  {0, 0, 6}, // ' '
+  {0, 10, 12}, // '%'
+  {32, 8, 10}, // '+'
+  {48, 6, 8}, // '-'
+  {64, 2, 4}, // '.'
+  {80, 10, 12}, // '0'
+  {112, 9, 12}, // '1'
+  {144, 10, 12}, // '2'
+  {176, 10, 12}, // '3'
+  {208, 10, 12}, // '4'
+  {240, 10, 12}, // '5'
+  {272, 10, 12}, // '6'
+  {304, 10, 12}, // '7'
+  {336, 10, 12}, // '8'
+  {368, 10, 12}, // '9'
+  {400, 2, 4}, // ':'
+  {416, 10, 12}, // 'C'
+  {448, 10, 12}, // 'F'
+  {480, 6, 8}, // U+00B0
+};
+
+const uint16_t numerals16_codepoints[19] PROGMEM = {
+  0x0020, 0x0025, 0x002b, 0x002d, 0x002e, 0x0030, 0x0031, 0x0032,
+  0x0033, 0x0034, 0x0035, 0x0036, 0x0037, 0x0038, 0x0039, 0x003a,
+  0x0043, 0x0046, 0x00b0,
+};
+
+static const PackedFont numerals16 = {
+  numerals16_bitmap,
+  numerals16_glyphs,
+  32,
+  19,
+  16,
+  numerals16_codepoints
+};
+
+#endif
@@ -0,0 +1,164 @@
+/**
+ * @file stroke.h
+ * @brief ePaper Display Interface vector stroke font
+ * @ingroup Fonts
+ * @addtogroup Fonts
+ * \{
+ *
+ * Capitals, digits and punctuation (ASCII 32 to 95) on a 9 by 16 grid, capitals are 12 units high. Lower case letters are drawn as capitals.
+ */
+
+#ifndef EPDLITE_FONT_STROKE_H_INCLUDE
+#define EPDLITE_FONT_STROKE_H_INCLUDE
+
+#ifdef TEST
+#include "../../../extra/stub.h"
+#else
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#endif
+
+#include "../strokefont.h"
+
+const uint8_t stroke_points[423] PROGMEM = {
+  0x10, 0x18, 0xff, 0x1b, 0x1c, // !
+  0x10, 0x13, 0xff, 0x40, 0x43, // "
+  0x31, 0x2b, 0xff, 0x61, 0x5b, 0xff, 0x04, 0x84, 0xff, 0x08, 0x88, // #
+  0x83, 0x61, 0x21, 0x03, 0x04, 0x26, 0x66, 0x88, 0x89, 0x6b, 0x2b, 0x09, 0xff, 0x40, 0x4c, // $
+  0x80, 0x0c, 0xff, 0x00, 0x30, 0x33, 0x03, 0x00, 0xff, 0x59, 0x89, 0x8c, 0x5c, 0x59, // %
+  0x8c, 0x24, 0x22, 0x30, 0x50, 0x62, 0x63, 0x08, 0x0a, 0x2c, 0x4c, 0x87, // &
+  0x10, 0x13, // '
+  0x30, 0x13, 0x19, 0x3c, // (
+  0x00, 0x23, 0x29, 0x0c, // )
+  0x42, 0x4a, 0xff, 0x04, 0x88, 0xff, 0x84, 0x08, // *
+  0x43, 0x4b, 0xff, 0x07, 0x87, // +
+  0x1b, 0x1c, 0x0e, // ,
+  0x07, 0x67, // -
+  0x1b, 0x1c, // .
+  0x80, 0x0c, // /
+  0x20, 0x60, 0x82, 0x8a, 0x6c, 0x2c, 0x0a, 0x02, 0x20, // 0
+  0x12, 0x40, 0x4c, 0xff, 0x1c, 0x7c, // 1
+  0x02, 0x20, 0x60, 0x82, 0x84, 0x0c, 0x8c, // 2
+  0x00, 0x80, 0x45, 0x65, 0x87, 0x8a, 0x6c, 0x2c, 0x0a, // 3
+  0x6c, 0x60, 0x08, 0x88, // 4
+  0x80, 0x00, 0x05, 0x65, 0x87, 0x8a, 0x6c, 0x2c, 0x0a, // 5
+  0x70, 0x30, 0x04, 0x0a, 0x2c, 0x6c, 0x8a, 0x87, 0x65, 0x05, // 6
+  0x00, 0x80, 0x3c, // 7
+  0x20, 0x60, 0x82, 0x84, 0x66, 0x26, 0x04, 0x02, 0x20, 0xff, 0x26, 0x08, 0x0a, 0x2c, 0x6c, 0x8a, 0x88, 0x66, // 8
+  0x87, 0x27, 0x05, 0x02, 0x20, 0x60, 0x82, 0x88, 0x5c, 0x1c, // 9
+  0x13, 0x14, 0xff, 0x1b, 0x1c, // :
+  0x13, 0x14, 0xff, 0x1b, 0x1c, 0x0e, // ;
+  0x82, 0x07, 0x8c, // <
+  0x05, 0x85, 0xff, 0x09, 0x89, // =
+  0x02, 0x87, 0x0c, // >
+  0x02, 0x20, 0x60, 0x82, 0x84, 0x47, 0x48, 0xff, 0x4b, 0x4c, // ?
+  0x68, 0x64, 0x34, 0x26, 0x38, 0x88, 0x82, 0x60, 0x20, 0x02, 0x0a, 0x2c, 0x7c, // @
+  0x0c, 0x04, 0x40, 0x84, 0x8c, 0xff, 0x07, 0x87, // A
+  0x00, 0x60, 0x82, 0x84, 0x66, 0x06, 0xff, 0x66, 0x88, 0x8a, 0x6c, 0x0c, 0x00, // B
+  0x82, 0x60, 0x20, 0x02, 0x0a, 0x2c, 0x6c, 0x8a, // C
+  0x00, 0x50, 0x83, 0x89, 0x5c, 0x0c, 0x00, // D
+  0x80, 0x00, 0x0c, 0x8c, 0xff, 0x06, 0x66, // E
+  0x80, 0x00, 0x0c, 0xff, 0x06, 0x66, // F
+  0x82, 0x60, 0x20, 0x02, 0x0a, 0x2c, 0x6c, 0x8a, 0x87, 0x57, // G
+  0x00, 0x0c, 0xff, 0x80, 0x8c, 0xff, 0x06, 0x86, // H
+  0x00, 0x40, 0xff, 0x20, 0x2c, 0xff, 0x0c, 0x4c, // I
+  0x80, 0x8a, 0x6c, 0x2c, 0x0a, // J
+  0x00, 0x0c, 0xff, 0x80, 0x08, 0xff, 0x35, 0x8c, // K
+  0x00, 0x0c, 0x8c, // L
+  0x0c, 0x00, 0x46, 0x80, 0x8c, // M
+  0x0c, 0x00, 0x8c, 0x80, // N
+  0x20, 0x60, 0x82, 0x8a, 0x6c, 0x2c, 0x0a, 0x02, 0x20, // O
+  0x0c, 0x00, 0x60, 0x82, 0x84, 0x66, 0x06, // P
+  0x20, 0x60, 0x82, 0x8a, 0x6c, 0x2c, 0x0a, 0x02, 0x20, 0xff, 0x59, 0x8c, // Q
+  0x0c, 0x00, 0x60, 0x82, 0x84, 0x66, 0x06, 0xff, 0x46, 0x8c, // R
+  0x82, 0x60, 0x20, 0x02, 0x04, 0x26, 0x66, 0x88, 0x8a, 0x6c, 0x2c, 0x0a, // S
+  0x00, 0x80, 0xff, 0x40, 0x4c, // T
+  0x00, 0x0a, 0x2c, 0x6c, 0x8a, 0x80, // U
+  0x00, 0x4c, 0x80, // V
+  0x00, 0x2c, 0x46, 0x6c, 0x80, // W
+  0x00, 0x8c, 0xff, 0x80, 0x0c, // X
+  0x00, 0x46, 0x80, 0xff, 0x46, 0x4c, // Y
+  0x00, 0x80, 0x0c, 0x8c, // Z
+  0x30, 0x00, 0x0c, 0x3c, // [
+  0x00, 0x8c, // backslash
+  0x00, 0x30, 0x3c, 0x0c, // ]
+  0x04, 0x40, 0x84, // ^
+  0x0e, 0x8e, // _
+};
+
+const StrokeGlyph stroke_glyphs[64] PROGMEM = {
+  {0, 0, 6}, // space
+  {0, 5, 4}, // !
+  {5, 5, 7}, // "
+  {10, 11, 11}, // #
+  {21, 15, 11}, // $
+  {36, 14, 11}, // %
+  {50, 12, 11}, // &
+  {62, 2, 4}, // '
+  {64, 4, 6}, // (
+  {68, 4, 5}, // )
+  {72, 8, 11}, // *
+  {80, 5, 11}, // +
+  {85, 3, 4}, // ,
+  {88, 2, 9}, // -
+  {90, 2, 4}, // .
+  {92, 2, 11}, // /
+  {94, 9, 11}, // 0
+  {103, 6, 10}, // 1
+  {109, 7, 11}, // 2
+  {116, 9, 11}, // 3
+  {125, 4, 11}, // 4
+  {129, 9, 11}, // 5
+  {138, 10, 11}, // 6
+  {148, 3, 11}, // 7
+  {151, 18, 11}, // 8
+  {169, 10, 11}, // 9
+  {179, 5, 4}, // :
+  {184, 6, 4}, // ;
+  {190, 3, 11}, // <
+  {193, 5, 11}, // =
+  {198, 3, 11}, // >
+  {201, 10, 11}, // ?
+  {211, 13, 11}, // @
+  {224, 8, 11}, // A
+  {232, 13, 11}, // B
+  {245, 8, 11}, // C
+  {253, 7, 11}, // D
+  {260, 7, 11}, // E
+  {267, 6, 11}, // F
+  {273, 10, 11}, // G
+  {283, 8, 11}, // H
+  {291, 8, 7}, // I
+  {299, 5, 11}, // J
+  {304, 8, 11}, // K
+  {312, 3, 11}, // L
+  {315, 5, 11}, // M
+  {320, 4, 11}, // N
+  {324, 9, 11}, // O
+  {333, 7, 11}, // P
+  {340, 12, 11}, // Q
+  {352, 10, 11}, // R
+  {362, 12, 11}, // S
+  {374, 5, 11}, // T
+  {379, 6, 11}, // U
+  {385, 3, 11}, // V
+  {388, 5, 11}, // W
+  {393, 5, 11}, // X
+  {398, 6, 11}, // Y
+  {404, 4, 11}, // Z
+  {408, 4, 6}, // [
+  {412, 2, 11}, // backslash
+  {414, 4, 6}, // ]
+  {418, 3, 11}, // ^
+  {421, 2, 11}, // _
+};
+
+
+/**
+ * @var Stroke font of capitals, digits and punctuation
+ */
+static const StrokeFont stroke = {stroke_points, stroke_glyphs, 32, 64, 12, 3};
+
+#endif
+
+/* \} */
@@ -0,0 +1,103 @@
+/**
+ * @file geometry.h
+ * @brief ePaper Display Interface panel geometry
+ * @ingroup  EPDLite
+ * @addtogroup  EPDLite
+ * \{
+ */
+
+#ifndef EPDLITE_GEOMETRY_H_INCLUDE
+#define EPDLITE_GEOMETRY_H_INCLUDE
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief The widest row the controller can address, in bytes
+ * @details The controller's x address is 5 bits, so rows can't be wider than 32 bytes (256 pixels)
+ */
+static const int16_t MAX_STRIDE = 32;
+
+/**
+ * @brief Panel dimensions known at compile time
+ * @details Used by FixedEPDLite so that loop bounds are constants and byte addressing reduces to shifts.
+ *
+ * @tparam TWidth Width of the display in pixels
+ * @tparam THeight Height of the display in pixels
+ */
+template <int16_t TWidth, int16_t THeight>
+struct PanelGeometry
+{
+  static_assert(TWidth > 0 && THeight > 0, "Panel dimensions must be positive.");
+  static_assert((TWidth + 7) / 8 <= MAX_STRIDE, "Panels wider than 256 pixels can't be addressed.");
+
+  /**
+   * @brief The width of the display in pixels
+   */
+  static constexpr int16_t width() { return TWidth; }
+  /**
+   * @brief The height of the display in pixels
+   */
+  static constexpr int16_t height() { return THeight; }
+  /**
+   * @brief The number of bytes in a single row of the display
+   */
+  static constexpr int16_t stride() { return (TWidth + 7) / 8; }
+  /**
+   * @brief The largest stride possible, used to size row buffers
+   */
+  static constexpr int16_t max_stride() { return stride(); }
+  /**
+   * @brief Whether the controller can address every row, checked at compile time
+   */
+  static constexpr bool fits() { return true; }
+  /**
+   * @brief The number of bytes required to hold the entire display
+   */
+  static constexpr size_t size() { return static_cast<size_t>(stride()) * THeight; }
+
+  /**
+   * @brief Offset of the byte holding pixel (x, y) in a full screen buffer
+   */
+  static constexpr size_t index(const int16_t x, const int16_t y)
+  {
+    return static_cast<size_t>(y) * stride() + (static_cast<uint16_t>(x) >> 3);
+  }
+};
+
+/**
+ * @brief Panel dimensions known at runtime
+ * @details Same interface as PanelGeometry, used by EPDLite when the size is only known at construction.
+ */
+struct RuntimeGeometry
+{
+  RuntimeGeometry(const int16_t w, const int16_t h) : w(w), h(h), s((w + 7) / 8) {}
+
+  int16_t width() const { return w; }
+  int16_t height() const { return h; }
+  int16_t stride() const { return s; }
+  size_t size() const { return static_cast<size_t>(s) * h; }
+
+  /**
+   * @brief The largest stride possible, used to size row buffers
+   */
+  static constexpr int16_t max_stride() { return MAX_STRIDE; }
+  /**
+   * @brief Whether the controller can address every row, nothing is rendered to a panel which it can't
+   */
+  bool fits() const { return s <= MAX_STRIDE; }
+
+  size_t index(const int16_t x, const int16_t y) const
+  {
+    return static_cast<size_t>(y) * s + (static_cast<uint16_t>(x) >> 3);
+  }
+
+private:
+  const int16_t w;
+  const int16_t h;
+  const int16_t s;
+};
+
+#endif
+
+/* \} */
@@ -0,0 +1,109 @@
+#include "packedfont.h"
+
+#ifdef TEST
+#include "../../extra/stub.h"
+#else
+#include "EPDLite.h"
+#endif
+
+uint16_t utf8_next(const char*& text)
+{
+  const uint8_t lead = static_cast<uint8_t>(*text++);
+  if (lead < 0x80)
+    return lead;
+
+  // the first continuation byte is narrowed for some leads, so no character has two encodings and none is a UTF-16 surrogate
+  uint8_t continuation;
+  uint8_t low = 0x80, high = 0xbf;
+  uint32_t c;
+  if (lead >= 0xc2 && lead <= 0xdf)
+  {
+    continuation = 1;
+    c = lead & 0x1f;
+  }
+  else if ((lead & 0xf0) == 0xe0)
+  {
+    continuation = 2;
+    c = lead & 0x0f;
+    if (lead == 0xe0)
+      low = 0xa0; // overlong
+    else if (lead == 0xed)
+      high = 0x9f; // surrogates
+  }
+  else if (lead >= 0xf0 && lead <= 0xf4)
+  {
+    continuation = 3;
+    c = lead & 0x07;
+    if (lead == 0xf0)
+      low = 0x90; // overlong
+    else if (lead == 0xf4)
+      high = 0x8f; // past U+10FFFF
+  }
+  else
+    return UTF8_REPLACEMENT;
+
+  for (; continuation; --continuation)
+  {
+    // a missing continuation byte (including the terminator) is left for the next call
+    const uint8_t b = static_cast<uint8_t>(*text);
+    if (b < low || b > high)
+      return UTF8_REPLACEMENT;
+    c = (c << 6) | (b & 0x3f);
+    ++text;
+    low = 0x80;
+    high = 0xbf;
+  }
+  return c > 0xffff ? UTF8_REPLACEMENT : static_cast<uint16_t>(c);
+}
+
+bool PackedFont::glyph(const uint16_t c, Glyph& glyph) const
+{
+  uint16_t index;
+  if (codepoints)
+  {
+    uint16_t low = 0;
+    uint16_t high = count;
+    while (low < high)
+    {
+      const uint16_t middle = low + (high - low) / 2;
+      if (pgm_read_word(&codepoints[middle]) < c)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+    if (low == count || pgm_read_word(&codepoints[low]) != c)
+      return false;
+    index = low;
+  }
+  else
+  {
+    // unsigned, so characters before first wrap around and fail the same test
+    index = c - first;
+    if (index >= count)
+      return false;
+  }
+
+  const Glyph* const g = &glyphs[index];
+  glyph.offset = pgm_read_word(&g->offset);
+  glyph.width = pgm_read_byte(&g->width);
+  glyph.advance = pgm_read_byte(&g->advance);
+  return true;
+}
+
+bool PackedFont::ink(const Glyph& glyph, const int16_t row, const int16_t column) const
+{
+  // glyphs are stored in the display's format, 0 is black
+  return !(pgm_read_byte(&this->row(glyph, row)[column >> 3]) & (0x80 >> (column & 7)));
+}
+
+int16_t PackedFont::width(const char* const text) const
+{
+  int16_t w = 0;
+  for (const char* c = text; *c;)
+  {
+    Glyph g;
+    if (next(c, g))
+      w += g.advance;
+  }
+  return w;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file packedfont.h
+ * @brief ePaper Display Interface row major fonts
+ * @ingroup Fonts
+ * @addtogroup Fonts
+ * \{
+ *
+ * Packed fonts store each glyph as a small bitmap in the same format as the display (row major, MSB first, 0 is black, each row padded to a whole byte), so a row of a glyph can be copied into a row of the display a byte at a time rather than a pixel at a time.
+ * Glyphs can be any height and each has its own width and advance. Packed fonts are generated from BDF or text glyph files with the `fontc` tool in `extra/`.
+ *
+ * Text is UTF-8. Fonts hold either every character in a range, found by indexing the glyph table, or a sorted table of the characters they hold, found by a binary search, which suits sparse sets such as ASCII plus a few symbols and accented letters.
+ */
+
+#ifndef EPDLITE_PACKEDFONT_H_INCLUDE
+#define EPDLITE_PACKEDFONT_H_INCLUDE
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Returned by utf8_next for invalid UTF-8 and characters outside the basic multilingual plane
+ */
+const uint16_t UTF8_REPLACEMENT = 0xfffd;
+
+/**
+ * @brief Decodes the next character of some UTF-8 text
+ * @details Invalid sequences, including overlong encodings and UTF-16 surrogates, decode as UTF8_REPLACEMENT. Each consumes its lead byte and the continuation bytes which could still have been part of a character, as Unicode recommends, so decoding always moves forwards and never passes the terminator.
+ *
+ * @param text The text, moved past the character
+ * @return The character
+ */
+uint16_t utf8_next(const char*& text);
+
+/**
+ * @brief A glyph of a packed font
+ */
+struct Glyph
+{
+  /**
+   * @brief Offset of the glyph's bitmap in the font's bitmap data
+   */
+  uint16_t offset;
+  /**
+   * @brief Width of the glyph's bitmap in pixels, 0 for glyphs with nothing to draw such as space
+   */
+  uint8_t width;
+  /**
+   * @brief Distance in pixels from the start of this glyph to the start of the next
+   */
+  uint8_t advance;
+
+  /**
+   * @brief The number of bytes in a row of the glyph's bitmap
+   */
+  int16_t stride() const { return (width + 7) / 8; }
+};
+
+/**
+ * @brief Where a walk along some text to the glyph under a pixel can resume
+ * @details Kept by commands drawn a pixel at a time, so pixels further along the text don't walk it from the start again.
+ */
+struct TextWalk
+{
+  /**
+   * @brief Offset in bytes from the start of the text of a glyph, every glyph before it ends by its pen position
+   */
+  int16_t at;
+  /**
+   * @brief Pen position of the glyph in pixels, from the start of its line
+   */
+  int16_t pen;
+};
+
+/**
+ * @brief A row major font with glyphs of any height and width
+ */
+struct PackedFont
+{
+  /**
+   * @brief The glyph bitmaps, stored in PROGMEM
+   */
+  const uint8_t* bitmap;
+  /**
+   * @brief The glyph table, stored in PROGMEM, one entry for each character
+   */
+  const Glyph* glyphs;
+  /**
+   * @brief The first character in the font
+   */
+  uint16_t first;
+  /**
+   * @brief The number of characters in the font
+   */
+  uint16_t count;
+  /**
+   * @brief Height of every glyph in pixels
+   */
+  int16_t height;
+  /**
+   * @brief The character of each glyph in ascending order, stored in PROGMEM, or nullptr if the font holds every character from `first` to `first + count - 1`
+   */
+  const uint16_t* codepoints;
+
+  /**
+   * @brief Looks up a glyph
+   *
+   * @param c The character to look up
+   * @param glyph Set to the glyph, left as it is if the character isn't in the font
+   * @return false if the character isn't in the font
+   */
+  bool glyph(const uint16_t c, Glyph& glyph) const;
+
+  /**
+   * @brief Decodes the next character of some UTF-8 text and looks up its glyph
+   *
+   * @param text The text, moved past the character
+   * @param glyph Set to the glyph, left as it is if the character isn't in the font
+   * @return false if the character isn't in the font
+   */
+  bool next(const char*& text, Glyph& glyph) const { return this->glyph(utf8_next(text), glyph); }
+
+  /**
+   * @brief The bitmap for a row of a glyph, stored in PROGMEM
+   *
+   * @param glyph The glyph
+   * @param row The row of the glyph, from 0 to `height - 1`
+   */
+  const uint8_t* row(const Glyph& glyph, const int16_t row) const
+  {
+    return &bitmap[glyph.offset + static_cast<size_t>(row) * glyph.stride()];
+  }
+
+  /**
+   * @brief Whether a pixel of a glyph is drawn
+   *
+   * @param glyph The glyph
+   * @param row The row of the glyph, from 0 to `height - 1`
+   * @param column The column of the glyph, from 0 to `glyph.width - 1`
+   */
+  bool ink(const Glyph& glyph, const int16_t row, const int16_t column) const;
+
+  /**
+   * @brief The width of some text in pixels
+   * @details The sum of the advance of each character, characters that aren't in the font are skipped.
+   *
+   * @param text The UTF-8 text to measure
+   */
+  int16_t width(const char* const text) const;
+};
+
+#endif
+
+/* \} */
@@ -0,0 +1,396 @@
+#include "raster.h"
+
+#include <string.h>
+
+#ifdef TEST
+#include "../../extra/stub.h"
+#else
+#include "EPDLite.h"
+#endif
+
+uint16_t isqrt(uint32_t n)
+{
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+
+  while (bit > n)
+    bit >>= 2;
+
+  while (bit != 0)
+  {
+    if (n >= root + bit)
+    {
+      n -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+      root >>= 1;
+    bit >>= 2;
+  }
+  return static_cast<uint16_t>(root);
+}
+
+// atan(2^-i) in 1/256 degrees
+static const int16_t CORDIC_ANGLES[] PROGMEM = {11520, 6801, 3593, 1824, 916, 458, 229, 115, 57, 29, 14, 7, 4, 2, 1};
+
+void sin_cos(const int16_t degrees, int16_t& sine, int16_t& cosine)
+{
+  // bring the angle to -90..90 degrees, flipping the cosine for the other half of the circle
+  int16_t a = degrees % 360;
+  if (a > 180)
+    a -= 360;
+  else if (a < -180)
+    a += 360;
+  bool flip = false;
+  if (a > 90)
+  {
+    a = 180 - a;
+    flip = true;
+  }
+  else if (a < -90)
+  {
+    a = -180 - a;
+    flip = true;
+  }
+
+  // rotate (1 / gain, 0) towards the angle, the gain of the rotations brings it back to unit length
+  int32_t x = 9949;
+  int32_t y = 0;
+  int32_t z = static_cast<int32_t>(a) * 256;
+  for (uint8_t i = 0; i < sizeof(CORDIC_ANGLES) / sizeof(CORDIC_ANGLES[0]); ++i)
+  {
+    const int32_t step = static_cast<int16_t>(pgm_read_word(reinterpret_cast<const uint16_t*>(&CORDIC_ANGLES[i])));
+    const int32_t dx = y >> i;
+    const int32_t dy = x >> i;
+    if (z >= 0)
+    {
+      x -= dx;
+      y += dy;
+      z -= step;
+    }
+    else
+    {
+      x += dx;
+      y -= dy;
+      z += step;
+    }
+  }
+
+  sine = static_cast<int16_t>(y);
+  cosine = static_cast<int16_t>(flip ? -x : x);
+}
+
+#if defined(__i386__) || defined(__x86_64__) || defined(__aarch64__) || defined(__ARM_FEATURE_UNALIGNED)
+// words can be read from and written to any byte
+static const bool UNALIGNED_LANES = true;
+#else
+static const bool UNALIGNED_LANES = false;
+#endif
+
+// Lanes hold pixels MSB first, as the display does, the byte order of a lane in memory is swapped on little endian targets
+static uint8_t memory_order(const uint8_t v)
+{
+  return v;
+}
+
+#ifdef EPDLITE_LANES_32
+static uint32_t memory_order(const uint32_t v)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  return __builtin_bswap32(v);
+#else
+  return v;
+#endif
+}
+#endif
+
+#ifdef EPDLITE_LANES_64
+static uint64_t memory_order(const uint64_t v)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  return __builtin_bswap64(v);
+#else
+  return v;
+#endif
+}
+#endif
+
+// whether a whole lane starting at byte b of row fits within the span's last byte
+template <typename TLane>
+static bool whole(const uint8_t* const row, const int16_t b, const int16_t last)
+{
+  return sizeof(TLane) > 1 && b + static_cast<int16_t>(sizeof(TLane)) - 1 <= last && (UNALIGNED_LANES || reinterpret_cast<uintptr_t>(row + b) % sizeof(TLane) == 0);
+}
+
+// the pixels from x0 to x1 of the lane starting at byte b, MSB first
+template <typename TLane>
+static TLane span_mask(const int16_t b, const int16_t x0, const int16_t x1)
+{
+  const int16_t left = b * 8;
+  const int16_t right = left + sizeof(TLane) * 8 - 1;
+  TLane mask = static_cast<TLane>(~static_cast<TLane>(0));
+  if (x0 > left)
+    mask = static_cast<TLane>(mask >> (x0 - left));
+  if (x1 < right)
+    mask = static_cast<TLane>(mask & static_cast<TLane>(static_cast<TLane>(~static_cast<TLane>(0)) << (right - x1)));
+  return mask;
+}
+
+template <typename TLane>
+static TLane load(const uint8_t* const p)
+{
+  TLane v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+template <typename TLane>
+static void store(uint8_t* const p, const TLane v)
+{
+  memcpy(p, &v, sizeof(v));
+}
+
+// Operations of the draw modes, on a byte or a lane at a time
+struct SetBits
+{
+  template <typename T>
+  static T apply(const T v, const T bits) { return static_cast<T>(v & ~bits); }
+};
+
+struct ClearBits
+{
+  template <typename T>
+  static T apply(const T v, const T bits) { return static_cast<T>(v | bits); }
+};
+
+struct FlipBits
+{
+  template <typename T>
+  static T apply(const T v, const T bits) { return static_cast<T>(v ^ bits); }
+};
+
+// draws the pattern onto every pixel of bytes p to end (exclusive), a lane at a time with bytes either side
+template <typename TLane, typename TOp>
+static void fill_run(uint8_t* p, uint8_t* const end, const uint8_t pattern)
+{
+  // the pattern in every byte of a lane, the same in either byte order
+  const TLane repeated = static_cast<TLane>(static_cast<TLane>(~static_cast<TLane>(0)) / 0xff * pattern);
+
+  if (!UNALIGNED_LANES)
+  {
+    for (; p < end && reinterpret_cast<uintptr_t>(p) % sizeof(TLane); ++p)
+      *p = TOp::apply(*p, pattern);
+  }
+  for (; end - p >= static_cast<ptrdiff_t>(sizeof(TLane)); p += sizeof(TLane))
+    store<TLane>(p, TOp::apply(load<TLane>(p), repeated));
+  for (; p < end; ++p)
+    *p = TOp::apply(*p, pattern);
+}
+
+void fill_span(uint8_t* const row, const int16_t x0, const int16_t x1)
+{
+  const int16_t b0 = x0 >> 3;
+  const int16_t b1 = x1 >> 3;
+  const uint8_t left = 0xff >> (x0 & 7);
+  const uint8_t right = 0xff << (7 - (x1 & 7));
+
+  if (b0 == b1)
+  {
+    row[b0] &= ~(left & right);
+    return;
+  }
+
+  row[b0] &= ~left;
+  // already as wide as the target can write
+  if (b1 > b0 + 1)
+    memset(row + b0 + 1, 0x00, b1 - b0 - 1);
+  row[b1] &= ~right;
+}
+
+void fill_span(uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Style& style)
+{
+  fill_span<Lane>(row, x0, x1, y, style);
+}
+
+template <typename TLane>
+void fill_span(uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Style& style)
+{
+  if (style.mode == DRAW_SET && !style.pattern)
+  {
+    fill_span(row, x0, x1);
+    return;
+  }
+
+  const int16_t b0 = x0 >> 3;
+  const int16_t b1 = x1 >> 3;
+  const uint8_t pattern = style.mask(y);
+  const uint8_t left = (0xff >> (x0 & 7)) & pattern;
+  const uint8_t right = (0xff << (7 - (x1 & 7))) & pattern;
+
+  if (b0 == b1)
+  {
+    row[b0] = style.put(row[b0], left & right);
+    return;
+  }
+
+  row[b0] = style.put(row[b0], left);
+  switch (style.mode)
+  {
+    case DRAW_CLEAR:
+      fill_run<TLane, ClearBits>(row + b0 + 1, row + b1, pattern);
+      break;
+    case DRAW_XOR:
+    case DRAW_INVERT:
+      fill_run<TLane, FlipBits>(row + b0 + 1, row + b1, pattern);
+      break;
+    default:
+      fill_run<TLane, SetBits>(row + b0 + 1, row + b1, pattern);
+      break;
+  }
+  row[b1] = style.put(row[b1], right);
+}
+
+// ANDs value into byte b of the row, leaving pixels outside x0 to x1 as they are
+static void put(uint8_t* const row, const int16_t b, const uint8_t value, const int16_t x0, const int16_t x1)
+{
+  const int16_t left = b * 8;
+  const int16_t right = left + 7;
+  if (right < x0 || left > x1)
+    return;
+
+  uint8_t keep = 0;
+  if (left < x0)
+    keep |= static_cast<uint8_t>(~(0xff >> (x0 - left)));
+  if (right > x1)
+    keep |= static_cast<uint8_t>(~(0xff << (right - x1)));
+  row[b] &= value | keep;
+}
+
+void blit_span(uint8_t* const row, const int16_t width, const int16_t x, const uint8_t* const src, const int16_t w, const bool progmem)
+{
+  blit_span<Lane>(row, 0, width - 1, x, src, w, progmem);
+}
+
+void blit_span(uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t x, const uint8_t* const src, const int16_t w, const bool progmem)
+{
+  blit_span<Lane>(row, x0, x1, x, src, w, progmem);
+}
+
+// a byte of the bitmap at a time, each is split over the two bytes of the row it lands on
+static void blit_bytes(uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t x, const uint8_t* const src, const int16_t w, const bool progmem)
+{
+  const int16_t bytes = (w + 7) / 8;
+  const uint8_t shift = x & 7;
+  const int16_t first = x >> 3; // arithmetic shift, rounds towards negative infinity
+
+  // only the bitmap bytes which land on bytes from x0 to x1
+  const int16_t start = (x0 >> 3) - first - 1 > 0 ? (x0 >> 3) - first - 1 : 0;
+  const int16_t end = (x1 >> 3) - first + 1 < bytes ? (x1 >> 3) - first + 1 : bytes;
+
+  for (int16_t i = start; i < end; ++i)
+  {
+    uint8_t s = progmem ? pgm_read_byte(&src[i]) : src[i];
+    // pixels past the end of the bitmap are transparent
+    if (i == bytes - 1 && (w & 7))
+      s |= 0xff >> (w & 7);
+
+    put(row, first + i, (s >> shift) | ~(0xff >> shift), x0, x1);
+    if (shift)
+      put(row, first + i + 1, (s << (8 - shift)) | (0xff >> shift), x0, x1);
+  }
+}
+
+// byte i of the bitmap, white outside of it
+static uint8_t bitmap_byte(const uint8_t* const src, const int16_t bytes, const int16_t i, const bool progmem)
+{
+  if (i < 0 || i >= bytes)
+    return 0xff;
+  return progmem ? pgm_read_byte(&src[i]) : src[i];
+}
+
+// the pixels of the bitmap which land on the lane starting at byte b of the row, MSB first
+template <typename TLane>
+static TLane bitmap_lane(const uint8_t* const src, const int16_t bytes, const int16_t b, const int16_t x, const bool progmem)
+{
+  const uint8_t shift = x & 7;
+  const int16_t i = b - (x >> 3);
+
+  TLane v = 0;
+  for (uint8_t k = 0; k < sizeof(TLane); ++k)
+    v = static_cast<TLane>(v << 8) | bitmap_byte(src, bytes, i + k, progmem);
+  if (shift)
+    v = static_cast<TLane>(v >> shift) | static_cast<TLane>(static_cast<TLane>(bitmap_byte(src, bytes, i - 1, progmem)) << (sizeof(TLane) * 8 - shift));
+  return v;
+}
+
+template <typename TLane>
+void blit_span(uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t x, const uint8_t* const src, const int16_t w, const bool progmem)
+{
+  if (sizeof(TLane) == 1)
+  {
+    blit_bytes(row, x0, x1, x, src, w, progmem);
+    return;
+  }
+
+  // only the pixels of the row the bitmap covers, which also leaves off the padding of its last byte
+  const int16_t first = x > x0 ? x : x0;
+  const int16_t last = x + w - 1 < x1 ? x + w - 1 : x1;
+  if (first > last)
+    return;
+
+  const int16_t bytes = (w + 7) / 8;
+  for (int16_t b = first >> 3; b <= last >> 3;)
+  {
+    // black pixels are drawn, so white pixels and those outside of the span AND as 1
+    if (whole<TLane>(row, b, last >> 3))
+    {
+      const TLane drawn = bitmap_lane<TLane>(src, bytes, b, x, progmem) | static_cast<TLane>(~span_mask<TLane>(b, first, last));
+      store<TLane>(row + b, load<TLane>(row + b) & memory_order(drawn));
+      b += sizeof(TLane);
+    }
+    else
+    {
+      row[b] &= bitmap_lane<uint8_t>(src, bytes, b, x, progmem) | static_cast<uint8_t>(~span_mask<uint8_t>(b, first, last));
+      ++b;
+    }
+  }
+}
+
+void copy_span(uint8_t* const row, const int16_t x0, const int16_t x1, const uint8_t* const src, const bool progmem)
+{
+  const int16_t b0 = x0 >> 3;
+  const int16_t b1 = x1 >> 3;
+  uint8_t left = 0xff >> (x0 & 7);
+  const uint8_t right = 0xff << (7 - (x1 & 7));
+  if (b0 == b1)
+    left &= right;
+
+  const uint8_t first = progmem ? pgm_read_byte(&src[b0]) : src[b0];
+  row[b0] = (first & left) | (row[b0] & ~left);
+  if (b0 == b1)
+    return;
+
+  // bytes in between are copied whole, by memcpy as wide as the target can
+  if (progmem)
+  {
+    for (int16_t b = b0 + 1; b < b1; ++b)
+      row[b] = pgm_read_byte(&src[b]);
+  }
+  else if (b1 > b0 + 1)
+    memcpy(row + b0 + 1, src + b0 + 1, b1 - b0 - 1);
+
+  const uint8_t last = progmem ? pgm_read_byte(&src[b1]) : src[b1];
+  row[b1] = (last & right) | (row[b1] & ~right);
+}
+
+// the lanes up to the target's word, and every lane on the host so they can be measured against each other
+template void fill_span<uint8_t>(uint8_t* const, const int16_t, const int16_t, const int16_t, const Style&);
+template void blit_span<uint8_t>(uint8_t* const, const int16_t, const int16_t, const int16_t, const uint8_t* const, const int16_t, const bool);
+#ifdef EPDLITE_LANES_32
+template void fill_span<uint32_t>(uint8_t* const, const int16_t, const int16_t, const int16_t, const Style&);
+template void blit_span<uint32_t>(uint8_t* const, const int16_t, const int16_t, const int16_t, const uint8_t* const, const int16_t, const bool);
+#endif
+#ifdef EPDLITE_LANES_64
+template void fill_span<uint64_t>(uint8_t* const, const int16_t, const int16_t, const int16_t, const Style&);
+template void blit_span<uint64_t>(uint8_t* const, const int16_t, const int16_t, const int16_t, const uint8_t* const, const int16_t, const bool);
+#endif
@@ -0,0 +1,141 @@
+/**
+ * @file raster.h
+ * @brief ePaper Display Interface row rasterization helpers
+ * @ingroup  EPDLite
+ * @addtogroup  EPDLite
+ * \{
+ */
+
+#ifndef EPDLITE_RASTER_H_INCLUDE
+#define EPDLITE_RASTER_H_INCLUDE
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "style.h"
+
+/**
+ * @brief Integer square root
+ *
+ * @param n
+ * @return The square root of n, rounded down
+ */
+uint16_t isqrt(uint32_t n);
+
+/**
+ * @brief Sine and cosine of an angle, without floating point
+ * @details Calculated with CORDIC, accurate to about 1/2000.
+ *
+ * @param degrees The angle in degrees, any value
+ * @param sine Set to the sine of the angle, 16384 is 1
+ * @param cosine Set to the cosine of the angle, 16384 is 1
+ */
+void sin_cos(const int16_t degrees, int16_t& sine, int16_t& cosine);
+
+/**
+ * @brief The word the span rasterizers draw in, the widest the target handles natively
+ * @details Patterned spans and bitmaps are drawn a lane at a time, with partial bytes at the ends drawn singly. AVR draws a byte at a time, 32 bit boards a 32 bit word at a time, and 64 bit hosts a 64 bit word.
+ */
+#if defined(__AVR__)
+typedef uint8_t Lane;
+#elif UINTPTR_MAX > 0xffffffffu
+typedef uint64_t Lane;
+#else
+typedef uint32_t Lane;
+#endif
+
+#if defined(TEST) || !defined(__AVR__)
+/**
+ * @brief Defined where spans are built for 32 bit lanes, on 32 and 64 bit targets and on the host
+ */
+#define EPDLITE_LANES_32
+#endif
+
+#if defined(TEST) || UINTPTR_MAX > 0xffffffffu
+/**
+ * @brief Defined where spans are built for 64 bit lanes, on 64 bit targets and on the host
+ */
+#define EPDLITE_LANES_64
+#endif
+
+/**
+ * @brief Draws a horizontal run of pixels into a row with a style, a lane at a time
+ * @details The functions without a lane draw with Lane. These are built for the lanes up to the target's word, and for every lane on the host so they can be measured against each other, @see extra/lanebench.cpp
+ *
+ * @tparam TLane uint8_t, uint32_t where EPDLITE_LANES_32 is defined or uint64_t where EPDLITE_LANES_64 is defined
+ */
+template <typename TLane>
+void fill_span(uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Style& style);
+
+/**
+ * @brief Draws a row of a bitmap into part of a row at any pixel offset, a lane at a time
+ *
+ * @tparam TLane uint8_t, uint32_t where EPDLITE_LANES_32 is defined or uint64_t where EPDLITE_LANES_64 is defined
+ */
+template <typename TLane>
+void blit_span(uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t x, const uint8_t* const src, const int16_t w, const bool progmem);
+
+/**
+ * @brief Draws a horizontal run of black pixels into a row
+ * @details Partial bytes at either end are masked, bytes in between are written whole.
+ *
+ * @param row The row buffer
+ * @param x0 The first pixel, must be within the row
+ * @param x1 The last pixel (inclusive), must be within the row
+ */
+void fill_span(uint8_t* const row, const int16_t x0, const int16_t x1);
+
+/**
+ * @brief Draws a horizontal run of pixels into a row with a style
+ * @details As `fill_span(uint8_t* const, const int16_t, const int16_t)`, with the pattern and draw mode applied a byte at a time.
+ *
+ * @param row The row buffer
+ * @param x0 The first pixel, must be within the row
+ * @param x1 The last pixel (inclusive), must be within the row
+ * @param y The row of the display, to pick the row of the pattern
+ * @param style The style to draw with
+ */
+void fill_span(uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t y, const Style& style);
+
+/**
+ * @brief Draws a row of a bitmap into a row at any pixel offset
+ * @details The bitmap uses the same format as the display (MSB first, 0 is black). Black pixels are drawn, white pixels leave the row as it is.
+ *
+ * @param row The row buffer
+ * @param width The width of the row in pixels
+ * @param x The x position of the first pixel of the bitmap, can be outside the row
+ * @param src The bitmap row
+ * @param w The width of the bitmap row in pixels
+ * @param progmem True if the bitmap is stored in PROGMEM
+ */
+void blit_span(uint8_t* const row, const int16_t width, const int16_t x, const uint8_t* const src, const int16_t w, const bool progmem);
+
+/**
+ * @brief Draws a row of a bitmap into part of a row at any pixel offset
+ * @details As `blit_span(uint8_t* const, const int16_t, const int16_t, const uint8_t* const, const int16_t, const bool)`, but only pixels from x0 to x1 of the row are drawn.
+ *
+ * @param row The row buffer
+ * @param x0 The first pixel of the row that can be drawn, must be within the row
+ * @param x1 The last pixel of the row that can be drawn (inclusive), must be within the row
+ * @param x The x position of the first pixel of the bitmap, can be outside the row
+ * @param src The bitmap row
+ * @param w The width of the bitmap row in pixels
+ * @param progmem True if the bitmap is stored in PROGMEM
+ */
+void blit_span(uint8_t* const row, const int16_t x0, const int16_t x1, const int16_t x, const uint8_t* const src, const int16_t w, const bool progmem);
+
+/**
+ * @brief Copies pixels of a row from another row the same width
+ * @details Pixels from x0 to x1 are replaced, the rest of the row is left as it is. Bytes in between the ends are copied whole with memcpy.
+ *
+ * @param row The row buffer
+ * @param x0 The first pixel, must be within the row
+ * @param x1 The last pixel (inclusive), must be within the row
+ * @param src The row to copy from, in the same format as the display
+ * @param progmem True if the row is stored in PROGMEM
+ */
+void copy_span(uint8_t* const row, const int16_t x0, const int16_t x1, const uint8_t* const src, const bool progmem);
+
+#endif
+
+/* \} */
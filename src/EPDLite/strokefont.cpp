@@ -0,0 +1,36 @@
+#include "strokefont.h"
+#include "packedfont.h"
+
+#ifdef TEST
+#include "../../extra/stub.h"
+#else
+#include "EPDLite.h"
+#endif
+
+bool StrokeFont::glyph(uint16_t c, StrokeGlyph& glyph) const
+{
+  // unsigned, so characters before first wrap around and fail the same test
+  uint16_t index = c - first;
+  if (index >= count && c >= 'a' && c <= 'z')
+    index = c - ('a' - 'A') - first;
+  if (index >= count)
+    return false;
+
+  const StrokeGlyph* const g = &glyphs[index];
+  glyph.offset = pgm_read_word(&g->offset);
+  glyph.length = pgm_read_byte(&g->length);
+  glyph.advance = pgm_read_byte(&g->advance);
+  return true;
+}
+
+int16_t StrokeFont::width(const char* const text) const
+{
+  int16_t w = 0;
+  for (const char* c = text; *c;)
+  {
+    StrokeGlyph g;
+    if (glyph(utf8_next(c), g))
+      w += g.advance;
+  }
+  return w;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file strokefont.h
+ * @brief ePaper Display Interface vector stroke fonts
+ * @ingroup Fonts
+ * @addtogroup Fonts
+ * \{
+ *
+ * Stroke fonts store each glyph as polylines on a small grid rather than as pixels, in the style of the Hershey plotter fonts, so text can be drawn at any size and angle from the same few hundred bytes, @see StrokeTextCommand
+ * Each point is a byte in PROGMEM, the high nibble is x and the low nibble is y, with y 0 the top of the capitals and `height` the baseline. STROKE_PEN_UP between two points starts a new polyline.
+ */
+
+#ifndef EPDLITE_STROKEFONT_H_INCLUDE
+#define EPDLITE_STROKEFONT_H_INCLUDE
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Separates the polylines of a stroke glyph
+ */
+const uint8_t STROKE_PEN_UP = 0xff;
+
+/**
+ * @brief A glyph of a stroke font
+ */
+struct StrokeGlyph
+{
+  /**
+   * @brief Offset of the glyph's first point in the font's point data
+   */
+  uint16_t offset;
+  /**
+   * @brief Number of points in the glyph, including STROKE_PEN_UP markers
+   */
+  uint8_t length;
+  /**
+   * @brief Distance in grid units from the start of this glyph to the start of the next
+   */
+  uint8_t advance;
+};
+
+/**
+ * @brief A font of glyphs drawn as lines on a grid
+ */
+struct StrokeFont
+{
+  /**
+   * @brief The glyph points, stored in PROGMEM
+   */
+  const uint8_t* points;
+  /**
+   * @brief The glyph table, stored in PROGMEM, one entry for each character from `first` to `first + count - 1`
+   */
+  const StrokeGlyph* glyphs;
+  /**
+   * @brief The first character in the font
+   */
+  uint16_t first;
+  /**
+   * @brief The number of characters in the font
+   */
+  uint16_t count;
+  /**
+   * @brief Height of the capitals in grid units, the baseline is at y = height
+   */
+  uint8_t height;
+  /**
+   * @brief Grid units used below the baseline
+   */
+  uint8_t descent;
+
+  /**
+   * @brief Looks up a glyph
+   * @details Lower case letters which aren't in the font use the upper case glyph.
+   *
+   * @param c The character to look up
+   * @param glyph Set to the glyph, left as it is if the character isn't in the font
+   * @return false if the character isn't in the font
+   */
+  bool glyph(uint16_t c, StrokeGlyph& glyph) const;
+
+  /**
+   * @brief The width of some text in grid units
+   * @details The sum of the advance of each character, characters that aren't in the font are skipped.
+   *
+   * @param text The UTF-8 text to measure
+   */
+  int16_t width(const char* const text) const;
+};
+
+#endif
+
+/* \} */
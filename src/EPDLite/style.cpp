@@ -0,0 +1,9 @@
+#include "style.h"
+
+const uint8_t PATTERN_GRAY50[8] PROGMEM = {0xaa, 0x55, 0xaa, 0x55, 0xaa, 0x55, 0xaa, 0x55};
+const uint8_t PATTERN_GRAY25[8] PROGMEM = {0x88, 0x22, 0x88, 0x22, 0x88, 0x22, 0x88, 0x22};
+const uint8_t PATTERN_GRAY75[8] PROGMEM = {0x77, 0xdd, 0x77, 0xdd, 0x77, 0xdd, 0x77, 0xdd};
+const uint8_t PATTERN_DIAGONAL[8] PROGMEM = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+const uint8_t PATTERN_CROSSHATCH[8] PROGMEM = {0x81, 0x42, 0x24, 0x18, 0x18, 0x24, 0x42, 0x81};
+const uint8_t PATTERN_HORIZONTAL[8] PROGMEM = {0xff, 0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00};
+const uint8_t PATTERN_VERTICAL[8] PROGMEM = {0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88};
@@ -0,0 +1,144 @@
+/**
+ * @file style.h
+ * @brief ePaper Display Interface fill patterns and draw modes
+ * @ingroup  EPDLite
+ * @addtogroup  EPDLite
+ * \{
+ *
+ * Shapes are drawn with a Style, which combines an 8x8 pattern with a draw mode. Patterns are aligned to the display, so neighbouring shapes with the same pattern join up, and are applied a byte of a row at a time.
+ */
+
+#ifndef EPDLITE_STYLE_H_INCLUDE
+#define EPDLITE_STYLE_H_INCLUDE
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef TEST
+#include "../../extra/stub.h"
+#elif !defined(PROGMEM)
+#include <avr/pgmspace.h>
+#endif
+
+/**
+ * @brief How a shape changes the pixels beneath it
+ */
+enum DrawMode
+{
+  DRAW_SET,   ///< Pixels in the pattern are made black
+  DRAW_CLEAR, ///< Pixels in the pattern are made white
+  DRAW_XOR,   ///< Pixels in the pattern are inverted
+  DRAW_INVERT ///< Every pixel of the shape is inverted, the pattern is ignored
+};
+
+/**
+ * @brief The ink a command is drawn in, @see CommandBuffer::push
+ * @details Black and white panels draw every colour in black.
+ */
+enum Colour
+{
+  COLOUR_BLACK, ///< Drawn on the black plane, painting over red beneath it
+  COLOUR_RED    ///< Drawn on the red plane, the panel's second colour which may be yellow, showing over black beneath it
+};
+
+/**
+ * @brief Every other pixel, a 50% grey
+ */
+extern const uint8_t PATTERN_GRAY50[8] PROGMEM;
+/**
+ * @brief One pixel in four, a light grey
+ */
+extern const uint8_t PATTERN_GRAY25[8] PROGMEM;
+/**
+ * @brief Three pixels in four, a dark grey
+ */
+extern const uint8_t PATTERN_GRAY75[8] PROGMEM;
+/**
+ * @brief Diagonal lines rising to the right
+ */
+extern const uint8_t PATTERN_DIAGONAL[8] PROGMEM;
+/**
+ * @brief Crossed diagonal lines
+ */
+extern const uint8_t PATTERN_CROSSHATCH[8] PROGMEM;
+/**
+ * @brief Horizontal lines every 4 rows
+ */
+extern const uint8_t PATTERN_HORIZONTAL[8] PROGMEM;
+/**
+ * @brief Vertical lines every 4 columns
+ */
+extern const uint8_t PATTERN_VERTICAL[8] PROGMEM;
+
+/**
+ * @brief How a shape is drawn, a pattern and a draw mode
+ */
+struct Style
+{
+  /**
+   * @brief A style
+   *
+   * @param mode How the shape changes the pixels beneath it
+   * @param pattern 8 bytes in PROGMEM, one for each row of the pattern with the MSB on the left and set bits drawn, or nullptr for a solid shape
+   */
+  Style(const DrawMode mode = DRAW_SET, const uint8_t* const pattern = nullptr) : mode(mode), pattern(pattern) {}
+
+  DrawMode mode;
+  const uint8_t* pattern;
+
+  /**
+   * @brief The pixels of the pattern in the bytes of row y
+   */
+  uint8_t mask(const int16_t y) const
+  {
+    return pattern && mode != DRAW_INVERT ? pgm_read_byte(&pattern[y & 7]) : 0xff;
+  }
+
+  /**
+   * @brief Draws some pixels of a byte, already masked by the pattern
+   *
+   * @param input The byte beneath
+   * @param bits The pixels to draw, set bits are drawn
+   * @return The byte with the pixels drawn
+   */
+  uint8_t put(const uint8_t input, const uint8_t bits) const
+  {
+    switch (mode)
+    {
+      case DRAW_CLEAR:
+        return input | bits;
+      case DRAW_XOR:
+      case DRAW_INVERT:
+        return input ^ bits;
+      default:
+        return input & ~bits;
+    }
+  }
+
+  /**
+   * @brief Draws some pixels of a byte of row y
+   *
+   * @param input The byte beneath
+   * @param bits The pixels of the shape, set bits are drawn where the pattern is set
+   * @param y The row of the byte
+   * @return The byte with the pixels drawn
+   */
+  uint8_t apply(const uint8_t input, const uint8_t bits, const int16_t y) const
+  {
+    return put(input, bits & mask(y));
+  }
+
+  /**
+   * @brief Whether the style overwrites everything beneath it, regardless of what was there
+   */
+  bool opaque() const { return !pattern && (mode == DRAW_SET || mode == DRAW_CLEAR); }
+
+  /**
+   * @brief Whether the pattern is the same on row y as on row y - 1
+   */
+  bool repeats(const int16_t y) const { return mask(y) == mask(y - 1); }
+};
+
+#endif
+
+/* \} */